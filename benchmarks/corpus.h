@@ -0,0 +1,77 @@
+#ifndef INVERTED_INDEX_LIB_BENCHMARK_CORPUS_H
+#define INVERTED_INDEX_LIB_BENCHMARK_CORPUS_H
+
+#include "inverted_index.h"
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using std::string;
+using std::unordered_set;
+using std::vector;
+using std::wstring;
+
+// Deterministic synthetic text: words drawn from a Zipf-like vocabulary so a
+// few terms are frequent and most are rare, as in real reviews.
+struct synthetic_corpus {
+    vector<wstring> vocabulary;
+    vector<document> names;
+    vector<wstring> texts;
+    vector<term_frequencies> terms;
+    vector<unordered_set<word>> queries;
+};
+
+inline synthetic_corpus make_corpus(size_t documents_num, size_t words_per_document = 120, size_t queries_num = 1000) {
+    static const wstring syllables[] = {L"qu", L"ok", L"ka", L"wom", L"bat", L"din", L"go", L"nu", L"bil", L"by",
+                                        L"pos", L"sum", L"ech", L"id", L"na", L"wal", L"la", L"ru"};
+    synthetic_corpus corpus;
+    std::mt19937 random(42);
+
+    for (size_t i = 0; i < 5000; ++i) {
+        wstring w;
+
+        for (size_t n = i; w.size() < 4 || n > 0; n /= std::size(syllables)) {
+            w += syllables[n % std::size(syllables)];
+        }
+
+        corpus.vocabulary.push_back(w);
+    }
+
+    // rank r is drawn with weight about 1 / r
+    std::vector<double> weights;
+
+    for (size_t r = 1; r <= corpus.vocabulary.size(); ++r) {
+        weights.push_back(1.0 / static_cast<double>(r));
+    }
+
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+
+    for (size_t d = 0; d < documents_num; ++d) {
+        unordered_map<wstring, uint32_t> counts;
+        wstring text;
+
+        for (size_t w = 0; w < words_per_document; ++w) {
+            const auto& term = corpus.vocabulary[pick(random)];
+
+            text += term;
+            text += L' ';
+            ++counts[term];
+        }
+
+        corpus.names.push_back("doc" + std::to_string(d) + ".txt");
+        corpus.texts.push_back(std::move(text));
+        corpus.terms.emplace_back(counts.begin(), counts.end());
+    }
+
+    for (size_t q = 0; q < queries_num; ++q) {
+        corpus.queries.push_back({corpus.vocabulary[pick(random)], corpus.vocabulary[pick(random)],
+                                  corpus.vocabulary[pick(random)]});
+    }
+
+    return corpus;
+}
+
+#endif
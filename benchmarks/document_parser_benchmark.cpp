@@ -0,0 +1,137 @@
+#include <benchmark/benchmark.h>
+#include "corpus.h"
+#include "document_parser.h"
+#include "english_stem.h"
+#include "batch_file_reader.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static void BM_ParseWords(benchmark::State& state) {
+    auto corpus = make_corpus(static_cast<size_t>(state.range(0)));
+    document_parser parser;
+    size_t bytes = 0;
+
+    parser.add_default_stop_words();
+
+    for (const auto& text : corpus.texts) {
+        bytes += text.size() * sizeof(wchar_t);
+    }
+
+    for (auto _ : state) {
+        for (const auto& text : corpus.texts) {
+            benchmark::DoNotOptimize(parser.parse_words(text));
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus.texts.size()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+}
+
+BENCHMARK(BM_ParseWords)->Arg(100)->Arg(1000);
+
+// Arg: analyzer_type. The text mixes in non-ASCII letters, which go through
+// the UTF-8 locale instead of the ASCII fast path.
+static void BM_Analyzer(benchmark::State& state) {
+    auto type = static_cast<analyzer_type>(state.range(0));
+    document_parser parser;
+    wstring content;
+
+    for (int i = 0; i < 20000; ++i) {
+        content += L"The films were connecting generations of viewers, running endlessly, café naïve ";
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse_word_frequencies(content, type));
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * content.size() * sizeof(wchar_t)));
+}
+
+BENCHMARK(BM_Analyzer)->ArgName("analyzer")->Arg(ENGLISH)->Arg(PLAIN)->Unit(benchmark::kMillisecond);
+
+static void BM_EnglishStem(benchmark::State& state) {
+    static const vector<wstring> words = {L"running", L"generously", L"connections", L"happiness", L"relational",
+                                          L"conditional", L"hopefully", L"agreed", L"troubled", L"sizing"};
+    stemming::english_stem<> stem;
+
+    for (auto _ : state) {
+        for (auto w : words) {
+            stem(w);
+            benchmark::DoNotOptimize(w);
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * words.size()));
+}
+
+BENCHMARK(BM_EnglishStem);
+
+// Reads 5000 small review files in batches of 256, optionally after evicting them from the page cache.
+static void BM_BatchFileRead(benchmark::State& state) {
+    const bool use_io_uring = state.range(0) != 0;
+    const bool cold = state.range(1) != 0;
+    fs::path dir = fs::temp_directory_path() / "batch_file_reader_benchmark";
+    vector<string> paths;
+    size_t bytes = 0;
+
+    batch_file_reader reader(batch_file_reader::default_depth, batch_file_reader::default_buffer_size,
+                             use_io_uring);
+
+    if (use_io_uring && !reader.uses_io_uring()) {
+        state.SkipWithError("io_uring unavailable");
+
+        return;
+    }
+
+    fs::create_directories(dir);
+
+    for (int i = 0; i < 5000; ++i) {
+        paths.push_back((dir / ("review" + std::to_string(i) + ".txt")).string());
+
+        std::ofstream out(paths.back());
+
+        for (int j = 0; j < 40; ++j) {
+            out << "a film review sentence number " << j << " ";
+        }
+    }
+
+    for (auto _ : state) {
+        if (cold) {
+            state.PauseTiming();
+            sync();
+
+            for (const auto& path : paths) {
+                int fd = open(path.c_str(), O_RDONLY);
+
+                if (fd >= 0) {
+                    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                    close(fd);
+                }
+            }
+
+            state.ResumeTiming();
+        }
+
+        bytes = 0;
+
+        for (size_t begin = 0; begin < paths.size(); begin += 256) {
+            vector<string> batch(paths.begin() + begin, paths.begin() + std::min(begin + 256, paths.size()));
+
+            for (const auto& content : reader.read(batch)) {
+                bytes += content ? content->size() : 0;
+            }
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * paths.size()));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    fs::remove_all(dir);
+}
+
+BENCHMARK(BM_BatchFileRead)->ArgNames({"io_uring", "cold"})->ArgsProduct({{1, 0}, {1, 0}})
+        ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,160 @@
+#include <benchmark/benchmark.h>
+#include "corpus.h"
+#include "inverted_index.h"
+#include "durable_index.h"
+#include "thread_pool.h"
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// Built once per corpus size and shared by the query benchmarks.
+static const inverted_index& indexed(size_t documents_num) {
+    static std::map<size_t, std::unique_ptr<inverted_index>> indexes;
+    static std::mutex indexes_mutex;
+    std::lock_guard lock(indexes_mutex);
+    auto& index = indexes[documents_num];
+
+    if (!index) {
+        auto corpus = make_corpus(documents_num);
+
+        index = std::make_unique<inverted_index>();
+
+        for (size_t d = 0; d < corpus.names.size(); ++d) {
+            index->add(corpus.names[d], corpus.terms[d]);
+        }
+    }
+
+    return *index;
+}
+
+// Args: documents, threads adding them.
+static void BM_IndexAdd(benchmark::State& state) {
+    auto corpus = make_corpus(static_cast<size_t>(state.range(0)));
+    auto threads_num = static_cast<unsigned int>(state.range(1));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+
+        auto index = std::make_unique<inverted_index>();
+        auto pool = std::make_unique<thread_pool>(threads_num);
+
+        state.ResumeTiming();
+
+        for (unsigned int t = 0; t < threads_num; ++t) {
+            pool->add_task([&index, &corpus, t, threads_num] {
+                for (size_t d = t; d < corpus.names.size(); d += threads_num) {
+                    index->add(corpus.names[d], corpus.terms[d]);
+                }
+
+                return true;
+            });
+        }
+
+        pool->wait_all();
+
+        state.PauseTiming();
+        pool.reset();
+        index.reset();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus.names.size()));
+}
+
+BENCHMARK(BM_IndexAdd)->ArgsProduct({{1000, 10000}, {1, 2, 4, 8}})->UseRealTime();
+
+static void BM_IndexFind(benchmark::State& state) {
+    auto corpus = make_corpus(0, 0, 1000);
+    const auto& index = indexed(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        for (const auto& query : corpus.queries) {
+            benchmark::DoNotOptimize(index.find(*query.begin()));
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus.queries.size()));
+}
+
+BENCHMARK(BM_IndexFind)->Arg(1000)->Arg(10000);
+
+// Also run from 1 to 8 threads querying the same index at once.
+static void BM_IndexRead(benchmark::State& state) {
+    auto corpus = make_corpus(0, 0, 1000);
+    const auto& index = indexed(static_cast<size_t>(state.range(0)));
+
+    for (auto _ : state) {
+        for (const auto& query : corpus.queries) {
+            benchmark::DoNotOptimize(index.read(query));
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus.queries.size()));
+}
+
+BENCHMARK(BM_IndexRead)->Arg(1000)->Arg(10000)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_SaveAsJson(benchmark::State& state) {
+    const auto& index = indexed(static_cast<size_t>(state.range(0)));
+    auto output = std::filesystem::temp_directory_path() / "benchmark_index.json";
+
+    for (auto _ : state) {
+        index.save_as_json(output.string());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * std::filesystem::file_size(output)));
+    std::filesystem::remove(output);
+}
+
+BENCHMARK(BM_SaveAsJson)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+// Arg: group commit interval in microseconds, -1 adds without the write-ahead
+// log. 32 writers, enough for batches to form.
+static void BM_GroupCommit(benchmark::State& state) {
+    constexpr size_t threads_num = 32;
+    auto corpus = make_corpus(1600, 20, 0);
+    auto dir = std::filesystem::temp_directory_path() / "benchmark_wal";
+    uint64_t syncs = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::filesystem::remove_all(dir);
+
+        auto index = std::make_unique<inverted_index>();
+        auto durable = state.range(0) < 0 ? nullptr : std::make_unique<durable_index>(
+                index.get(), dir, wal_config{static_cast<uint32_t>(state.range(0))});
+        vector<std::thread> threads;
+
+        state.ResumeTiming();
+
+        for (size_t t = 0; t < threads_num; ++t) {
+            threads.emplace_back([&, t] {
+                for (size_t d = t; d < corpus.names.size(); d += threads_num) {
+                    if (durable) {
+                        durable->add(corpus.names[d], corpus.terms[d]);
+                    } else {
+                        index->add(corpus.names[d], corpus.terms[d]);
+                    }
+                }
+            });
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        state.PauseTiming();
+        syncs = durable ? durable->syncs() : 0;
+        durable.reset();
+        index.reset();
+        state.ResumeTiming();
+    }
+
+    state.counters["syncs"] = static_cast<double>(syncs);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus.names.size()));
+    std::filesystem::remove_all(dir);
+}
+
+BENCHMARK(BM_GroupCommit)->Arg(-1)->Arg(0)->Arg(200)->Arg(1000)->Arg(5000)->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
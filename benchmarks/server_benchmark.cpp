@@ -0,0 +1,272 @@
+#include <benchmark/benchmark.h>
+#include "corpus.h"
+#include "server.h"
+#include "load_generator.h"
+#include "shard_coordinator.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+using std::unique_ptr;
+
+namespace fs = std::filesystem;
+
+// Writes the corpus texts out as review files; the vocabulary is ASCII.
+static fs::path write_corpus(const synthetic_corpus& corpus, const string& name) {
+    fs::path dir = fs::temp_directory_path() / name;
+
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    for (size_t d = 0; d < corpus.texts.size(); ++d) {
+        std::ofstream(dir / (std::to_string(d) + ".txt")) << string(corpus.texts[d].begin(), corpus.texts[d].end());
+    }
+
+    return dir;
+}
+
+// The server owns the pool, index and parser it is given.
+static unique_ptr<server> make_server(processing_type type) {
+    auto* parser = new document_parser();
+
+    parser->add_default_stop_words();
+
+    return std::make_unique<server>(new thread_pool(4), new inverted_index(), parser, type);
+}
+
+static vector<string> query_strings(const synthetic_corpus& corpus) {
+    vector<string> queries;
+
+    for (const auto& query : corpus.queries) {
+        string content;
+
+        for (const auto& w : query) {
+            content += string(w.begin(), w.end()) + " ";
+        }
+
+        queries.push_back(content);
+    }
+
+    return queries;
+}
+
+// Args: processing_type, documents. Every mode indexes the same corpus, a
+// fresh server per iteration.
+static void BM_Ingest(benchmark::State& state) {
+    static const char* const mode_names[] = {"WORD_FILE", "INDEX", "WORD_FILES", "MAP_REDUCE", "PIPELINE"};
+    auto type = static_cast<processing_type>(state.range(0));
+    auto corpus = make_corpus(static_cast<size_t>(state.range(1)));
+    fs::path input_dir = write_corpus(corpus, "ingest_benchmark");
+    fs::path output_file = fs::temp_directory_path() / "ingest_benchmark.json";
+    unique_ptr<server> ingest_server;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        ingest_server = make_server(type);
+        state.ResumeTiming();
+
+        ingest_server->run(input_dir, output_file);
+    }
+
+    state.SetLabel(mode_names[type]);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus.texts.size()));
+    ingest_server.reset();
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+}
+
+BENCHMARK(BM_Ingest)->ArgNames({"mode", "docs"})
+        ->ArgsProduct({{WORD_FILE, WORD_FILES, INDEX, MAP_REDUCE}, {2000, 10000}})
+        ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_PipelineIngest(benchmark::State& state) {
+    auto corpus = make_corpus(static_cast<size_t>(state.range(0)));
+    fs::path input_dir = write_corpus(corpus, "pipeline_benchmark");
+    fs::path output_file = fs::temp_directory_path() / "pipeline_benchmark.json";
+    unique_ptr<server> pipeline_server;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        pipeline_server = make_server(PIPELINE);
+        pipeline_server->set_pipeline_config({1, 4, 1, 64});
+        state.ResumeTiming();
+
+        pipeline_server->run(input_dir, output_file);
+    }
+
+    for (const auto& stage : pipeline_server->pipeline_metrics()) {
+        state.counters[stage.name + "_docs_per_second"] = stage.items_per_second();
+        state.counters[stage.name + "_busy_ms"] = stage.busy_ms;
+        state.counters[stage.name + "_avg_queue_depth"] = stage.avg_queue_depth;
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * corpus.texts.size()));
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+}
+
+BENCHMARK(BM_PipelineIngest)->Arg(2000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Arg 1: queries answered with read_batch instead of one read per query.
+static void BM_ServerRead(benchmark::State& state) {
+    auto corpus = make_corpus(2000, 120, 5000);
+    fs::path input_dir = write_corpus(corpus, "server_read_benchmark");
+    fs::path output_file = fs::temp_directory_path() / "server_read_benchmark.json";
+    auto queries = query_strings(corpus);
+    auto indexed = make_server(WORD_FILES);
+
+    indexed->run(input_dir, output_file);
+
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            for (const auto& query : queries) {
+                benchmark::DoNotOptimize(indexed->read(query));
+            }
+        } else {
+            benchmark::DoNotOptimize(indexed->read_batch(queries));
+        }
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * queries.size()));
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+}
+
+BENCHMARK(BM_ServerRead)->ArgName("batched")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// A file written into a watched directory until it is searchable. Arg: the
+// batch window in milliseconds.
+static void BM_WatchFreshness(benchmark::State& state) {
+    fs::path input_dir = fs::temp_directory_path() / "watch_benchmark";
+    auto watching = make_server(WORD_FILE);
+    uint64_t written = 0;
+
+    fs::remove_all(input_dir);
+    fs::create_directories(input_dir);
+    watching->watch(input_dir, {static_cast<uint32_t>(state.range(0)), 1024});
+
+    for (auto _ : state) {
+        std::ofstream(input_dir / ("doc" + std::to_string(written++) + ".txt")) << "quokka wombat";
+
+        while (watching->watch_stats().documents_indexed < written) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    watching->stop_watch();
+
+    auto stats = watching->watch_stats();
+
+    state.counters["avg_freshness_ms"] = stats.avg_freshness_ms;
+    state.counters["max_freshness_ms"] = stats.max_freshness_ms;
+    watching.reset();
+    fs::remove_all(input_dir);
+}
+
+BENCHMARK(BM_WatchFreshness)->ArgName("window_ms")->Arg(10)->Arg(50)->Arg(200)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Reads over memory-mapped segments. Arg: posting cache budget in MiB, 0
+// decodes every list on every query.
+static void BM_SegmentedRead(benchmark::State& state) {
+    auto corpus = make_corpus(2000, 120, 5000);
+    fs::path input_dir = write_corpus(corpus, "segmented_read_benchmark");
+    fs::path segment_dir = fs::temp_directory_path() / "segmented_read_benchmark_segments";
+    auto queries = query_strings(corpus);
+    auto indexed = make_server(WORD_FILES);
+    segment_config config;
+
+    fs::remove_all(segment_dir);
+    config.directory = segment_dir;
+    config.posting_cache_bytes = static_cast<size_t>(state.range(0)) * 1024 * 1024;
+    indexed->enable_segments(config);
+    indexed->run(input_dir, {});
+
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            benchmark::DoNotOptimize(indexed->read(query));
+        }
+    }
+
+    auto cache = indexed->postings_cache_stats();
+
+    state.counters["hit_rate"] = cache.hits + cache.misses > 0
+            ? static_cast<double>(cache.hits) / static_cast<double>(cache.hits + cache.misses) : 0;
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * queries.size()));
+    indexed.reset();
+    fs::remove_all(input_dir);
+    fs::remove_all(segment_dir);
+}
+
+BENCHMARK(BM_SegmentedRead)->ArgName("cache_mib")->Arg(0)->Arg(64)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Args: connections, requests pipelined on each. Latency percentiles are
+// those of the last run.
+static void BM_HttpLoad(benchmark::State& state) {
+    auto corpus = make_corpus(2000, 120, 1000);
+    fs::path input_dir = write_corpus(corpus, "http_load_benchmark");
+    fs::path output_file = fs::temp_directory_path() / "http_load_benchmark.json";
+    auto connections = static_cast<unsigned int>(state.range(0));
+    auto depth = static_cast<unsigned int>(state.range(1));
+    auto indexed = make_server(WORD_FILES);
+    vector<string> targets;
+    load_report report;
+
+    for (const auto& query : corpus.queries) {
+        string target = "/search?q=";
+
+        for (const auto& w : query) {
+            target += string(w.begin(), w.end()) + "+";
+        }
+
+        targets.push_back(target);
+    }
+
+    indexed->run(input_dir, output_file);
+    indexed->serve();
+
+    load_generator generator("127.0.0.1", indexed->serving_port());
+
+    for (auto _ : state) {
+        report = generator.run(targets, connections, 2048 / connections, depth);
+    }
+
+    state.counters["p50_ms"] = report.p50_ms;
+    state.counters["p99_ms"] = report.p99_ms;
+    state.counters["p999_ms"] = report.p999_ms;
+    state.counters["errors"] = static_cast<double>(report.errors);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * report.requests));
+
+    indexed->stop_serving();
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+}
+
+BENCHMARK(BM_HttpLoad)->ArgNames({"connections", "pipeline"})->ArgsProduct({{1, 4, 16, 64}, {1}})
+        ->Args({4, 8})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Arg: shard processes the corpus is split across.
+static void BM_ShardedSearch(benchmark::State& state) {
+    auto corpus = make_corpus(2000, 120, 2000);
+    fs::path input_dir = write_corpus(corpus, "sharded_search_benchmark");
+    auto queries = query_strings(corpus);
+    thread_pool pool(2);
+    shard_config config;
+
+    config.shards = static_cast<size_t>(state.range(0));
+
+    shard_coordinator coordinator(config);
+
+    coordinator.index_dir(input_dir, &pool);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(coordinator.search_batch(queries, 10));
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * queries.size()));
+    fs::remove_all(input_dir);
+}
+
+BENCHMARK(BM_ShardedSearch)->ArgName("shards")->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+#include "term_dictionary.h"
+#include "trigram_index.h"
+#include "front_coded_dictionary.h"
+#include <random>
+
+// Random lowercase terms of 4 to 10 letters, interned into dictionary.
+static sorted_terms random_terms(term_dictionary& dictionary, size_t terms_num) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> letter(0, 25);
+    std::uniform_int_distribution<int> length(4, 10);
+    sorted_terms terms;
+
+    terms.reserve(terms_num);
+
+    for (size_t i = 0; i < terms_num; ++i) {
+        wstring term(length(rng), L'a');
+
+        for (auto& c : term) {
+            c = static_cast<wchar_t>(L'a' + letter(rng));
+        }
+
+        bool inserted;
+        term_id id = dictionary.intern(term, inserted);
+
+        if (inserted) {
+            terms.emplace_back(std::move(term), id);
+        }
+    }
+
+    return terms;
+}
+
+// Every query is a known term with its middle letter changed.
+static void BM_TrigramBestMatch(benchmark::State& state) {
+    term_dictionary dictionary;
+    trigram_index trigrams(&dictionary);
+    auto terms = random_terms(dictionary, static_cast<size_t>(state.range(0)));
+    size_t next = 0;
+
+    for (const auto& [term, id] : terms) {
+        trigrams.add(id, term);
+    }
+
+    for (auto _ : state) {
+        wstring query = terms[next++ * 997 % terms.size()].first;
+
+        query[query.size() / 2] = L'z' == query[query.size() / 2] ? L'y' : L'z';
+        benchmark::DoNotOptimize(trigrams.best_match(query, 1));
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_TrigramBestMatch)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+// Reports the dictionary's size before and after the sorted index is built
+// next to it: dictionary_bytes alone, total_bytes with the front-coded index.
+static void BM_FrontCodedBuild(benchmark::State& state) {
+    term_dictionary dictionary;
+    auto terms = random_terms(dictionary, static_cast<size_t>(state.range(0)));
+    size_t front_coded_bytes = 0;
+
+    for (auto _ : state) {
+        front_coded_dictionary sorted(terms);
+
+        front_coded_bytes = sorted.memory_usage();
+        benchmark::DoNotOptimize(front_coded_bytes);
+    }
+
+    state.counters["dictionary_bytes"] = static_cast<double>(dictionary.memory_usage());
+    state.counters["front_coded_bytes"] = static_cast<double>(front_coded_bytes);
+    state.counters["total_bytes"] = static_cast<double>(dictionary.memory_usage() + front_coded_bytes);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * terms.size()));
+}
+
+BENCHMARK(BM_FrontCodedBuild)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_FrontCodedPrefix(benchmark::State& state) {
+    term_dictionary dictionary;
+    auto terms = random_terms(dictionary, static_cast<size_t>(state.range(0)));
+    front_coded_dictionary sorted(terms);
+    size_t next = 0;
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sorted.prefix(terms[next++ * 997 % terms.size()].first.substr(0, 3)));
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_FrontCodedPrefix)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
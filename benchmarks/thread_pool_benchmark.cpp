@@ -0,0 +1,22 @@
+#include <benchmark/benchmark.h>
+#include "thread_pool.h"
+
+// Args: workers, tasks submitted per iteration.
+static void BM_ThreadPoolSubmit(benchmark::State& state) {
+    thread_pool pool(static_cast<unsigned int>(state.range(0)));
+    auto tasks_num = state.range(1);
+
+    for (auto _ : state) {
+        for (int64_t t = 0; t < tasks_num; ++t) {
+            pool.add_task([] {
+                return true;
+            });
+        }
+
+        pool.wait_all();
+    }
+
+    state.SetItemsProcessed(state.iterations() * tasks_num);
+}
+
+BENCHMARK(BM_ThreadPoolSubmit)->ArgsProduct({{1, 2, 4, 8}, {100, 10000}})->UseRealTime();
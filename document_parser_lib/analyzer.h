@@ -0,0 +1,113 @@
+#ifndef INVERTED_INDEX_LIB_ANALYZER_H
+#define INVERTED_INDEX_LIB_ANALYZER_H
+
+#include "english_stem.h"
+#include "english_exceptions.h"
+#include "../enums_lib/analyzer_type.h"
+
+#include <string>
+#include <locale.h>
+#include <wctype.h>
+
+using std::wstring;
+
+// Letter classification and lowercasing for any code point, independent of
+// the global locale: the program may never call setlocale, and then iswalpha
+// knows only ASCII. Everything else is asked of a private UTF-8 LC_CTYPE
+// locale through the _l functions. Without one non-ASCII text is not split
+// into words.
+struct unicode_ctype {
+    static bool is_alpha(wchar_t c) {
+        if (c < 0x80) {
+            return (c | 0x20) >= L'a' && (c | 0x20) <= L'z';
+        }
+
+        locale_t locale = utf8_locale();
+
+        return locale != nullptr && iswalpha_l(static_cast<wint_t>(c), locale);
+    }
+
+    static wchar_t to_lower(wchar_t c) {
+        if (c < 0x80) {
+            return c >= L'A' && c <= L'Z' ? static_cast<wchar_t>(c | 0x20) : c;
+        }
+
+        locale_t locale = utf8_locale();
+
+        return locale != nullptr ? static_cast<wchar_t>(towlower_l(static_cast<wint_t>(c), locale)) : c;
+    }
+
+    static locale_t utf8_locale() {
+        static const locale_t locale = [] {
+            for (const char* name : {"C.UTF-8", "C.utf8", "en_US.UTF-8"}) {
+                if (locale_t opened = newlocale(LC_CTYPE_MASK, name, nullptr)) {
+                    return opened;
+                }
+            }
+
+            return static_cast<locale_t>(nullptr);
+        }();
+
+        return locale;
+    }
+};
+
+// Per-language text analysis used by document_parser: which characters form
+// a token, how they are normalized, and how a token is stemmed. An analyzer
+// is picked once per document and the term loop is instantiated for it, so
+// nothing in the loop goes through a virtual call.
+//
+// Stop words are kept per analyzer, see document_parser::add_stop_words;
+// the embedded default list is English and only has_default_stop_words
+// analyzers use it.
+//
+// To support a new language, add a value to analyzer_type, specialize
+// analyzer for it and add a case to document_parser::for_each_term.
+template<analyzer_type type>
+struct analyzer;
+
+template<>
+struct analyzer<ENGLISH> {
+    using stemmer = stemming::english_stem<>;
+
+    static constexpr bool has_default_stop_words = true;
+
+    static bool is_token_char(wchar_t c) {
+        return unicode_ctype::is_alpha(c);
+    }
+
+    static wchar_t normalize(wchar_t c) {
+        return unicode_ctype::to_lower(c);
+    }
+
+    static void stem(stemmer& s, wstring& word) {
+        if (auto stem = english_exceptions.find(word)) {
+            word.assign(*stem);
+
+            return;
+        }
+
+        s(word);
+    }
+};
+
+// Tokenizes and lowercases without stemming, for corpora in languages that
+// have no stemmer here.
+template<>
+struct analyzer<PLAIN> {
+    using stemmer = stemming::no_op_stem<>;
+
+    static constexpr bool has_default_stop_words = false;
+
+    static bool is_token_char(wchar_t c) {
+        return unicode_ctype::is_alpha(c);
+    }
+
+    static wchar_t normalize(wchar_t c) {
+        return unicode_ctype::to_lower(c);
+    }
+
+    static void stem(stemmer&, wstring&) {}
+};
+
+#endif
@@ -0,0 +1,361 @@
+#include "batch_file_reader.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+struct batch_file_reader::ring {
+    int fd = -1;
+    unsigned int entries = 0;
+    bool fixed_buffers = false;
+
+    void* sq_memory = MAP_FAILED;
+    size_t sq_memory_size = 0;
+    void* cq_memory = MAP_FAILED;
+    size_t cq_memory_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned int* sq_head = nullptr;
+    unsigned int* sq_tail = nullptr;
+    unsigned int* sq_mask = nullptr;
+    unsigned int* sq_array = nullptr;
+    unsigned int* cq_head = nullptr;
+    unsigned int* cq_tail = nullptr;
+    unsigned int* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    unsigned int pending = 0;
+
+    bool open(unsigned int depth, vector<char>& buffers, size_t buffer_size) {
+        io_uring_params params{};
+
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+
+        if (fd < 0) {
+            return false;
+        }
+
+        entries = params.sq_entries;
+        sq_memory_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        cq_memory_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+
+        if (single_mmap) {
+            sq_memory_size = cq_memory_size = std::max(sq_memory_size, cq_memory_size);
+        }
+
+        sq_memory = mmap(nullptr, sq_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                         IORING_OFF_SQ_RING);
+        cq_memory = single_mmap ? sq_memory : mmap(nullptr, cq_memory_size, PROT_READ | PROT_WRITE,
+                                                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                               MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+
+        if (sq_memory == MAP_FAILED || cq_memory == MAP_FAILED || sqes == MAP_FAILED) {
+            return false;
+        }
+
+        auto* sq = static_cast<char*>(sq_memory);
+        auto* cq = static_cast<char*>(cq_memory);
+
+        sq_head = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+        sq_tail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        vector<iovec> iovecs(depth);
+
+        for (unsigned int i = 0; i < depth; ++i) {
+            iovecs[i] = {buffers.data() + i * buffer_size, buffer_size};
+        }
+
+        // registration can be refused (e.g. by RLIMIT_MEMLOCK), plain reads still work then
+        fixed_buffers = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iovecs.data(), depth) == 0;
+
+        return true;
+    }
+
+    ~ring() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqes_size);
+        }
+
+        if (cq_memory != MAP_FAILED && cq_memory != sq_memory) {
+            munmap(cq_memory, cq_memory_size);
+        }
+
+        if (sq_memory != MAP_FAILED) {
+            munmap(sq_memory, sq_memory_size);
+        }
+
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    // The caller keeps at most one operation per slot in flight, so with
+    // entries >= depth there is always a free SQE.
+    io_uring_sqe* next_sqe(uint64_t user_data) {
+        unsigned int tail = std::atomic_ref(*sq_tail).load(std::memory_order_relaxed);
+        unsigned int index = tail & *sq_mask;
+        io_uring_sqe* sqe = &sqes[index];
+
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = user_data;
+        sq_array[index] = index;
+        std::atomic_ref(*sq_tail).store(tail + 1, std::memory_order_release);
+        ++pending;
+
+        return sqe;
+    }
+
+    bool submit_and_wait() {
+        long result;
+
+        do {
+            result = syscall(__NR_io_uring_enter, fd, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        } while (result < 0 && errno == EINTR);
+
+        if (result < 0) {
+            return false;
+        }
+
+        pending -= std::min<unsigned int>(pending, static_cast<unsigned int>(result));
+
+        return true;
+    }
+
+    template<typename F>
+    void drain(F&& on_completion) {
+        unsigned int head = std::atomic_ref(*cq_head).load(std::memory_order_relaxed);
+        unsigned int tail = std::atomic_ref(*cq_tail).load(std::memory_order_acquire);
+
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes[head & *cq_mask];
+
+            on_completion(cqe.user_data, cqe.res);
+        }
+
+        std::atomic_ref(*cq_head).store(head, std::memory_order_release);
+    }
+};
+#else
+struct batch_file_reader::ring {};
+#endif
+
+batch_file_reader::batch_file_reader(unsigned int depth, size_t buffer_size, bool use_io_uring)
+        : depth_(std::max(1u, depth)),
+          buffer_size_(buffer_size > 0 ? buffer_size : default_buffer_size),
+          buffers_(depth_ * buffer_size_) {
+#ifdef HAS_IO_URING
+    if (use_io_uring) {
+        ring_ = std::make_unique<ring>();
+
+        if (!ring_->open(depth_, buffers_, buffer_size_) || ring_->entries < depth_) {
+            ring_.reset();
+        }
+    }
+#endif
+}
+
+batch_file_reader::~batch_file_reader() = default;
+
+bool batch_file_reader::uses_io_uring() const {
+    return ring_ != nullptr;
+}
+
+vector<optional<string>> batch_file_reader::read(const vector<string>& paths) {
+    return ring_ != nullptr ? read_with_ring(paths) : read_with_pread(paths);
+}
+
+#ifdef HAS_IO_URING
+// Every slot walks one file through OPENAT -> READ... -> CLOSE and then
+// takes the next file. A read shorter than the buffer means end of file,
+// which holds for regular files.
+vector<optional<string>> batch_file_reader::read_with_ring(const vector<string>& paths) {
+    enum stage { OPENING, READING, CLOSING };
+
+    struct slot {
+        size_t file = 0;
+        int fd = -1;
+        uint64_t offset = 0;
+        stage current = OPENING;
+    };
+
+    vector<optional<string>> results(paths.size());
+    vector<bool> done(paths.size());
+    vector<slot> slots(depth_);
+    size_t next_file = 0;
+    unsigned int active = 0;
+
+    auto start_file = [&](unsigned int s) {
+        if (next_file >= paths.size()) {
+            return;
+        }
+
+        slots[s] = {next_file++, -1, 0, OPENING};
+
+        io_uring_sqe* sqe = ring_->next_sqe(s);
+
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(paths[slots[s].file].c_str());
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        ++active;
+    };
+
+    auto submit_read = [&](unsigned int s) {
+        io_uring_sqe* sqe = ring_->next_sqe(s);
+
+        sqe->opcode = ring_->fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = slots[s].fd;
+        sqe->addr = reinterpret_cast<uint64_t>(buffers_.data() + s * buffer_size_);
+        sqe->len = static_cast<uint32_t>(buffer_size_);
+        sqe->off = slots[s].offset;
+        sqe->buf_index = ring_->fixed_buffers ? static_cast<uint16_t>(s) : 0;
+        slots[s].current = READING;
+    };
+
+    auto submit_close = [&](unsigned int s) {
+        io_uring_sqe* sqe = ring_->next_sqe(s);
+
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = slots[s].fd;
+        slots[s].current = CLOSING;
+    };
+
+    for (unsigned int s = 0; s < depth_; ++s) {
+        start_file(s);
+    }
+
+    while (active > 0) {
+        if (!ring_->submit_and_wait()) {
+            // the ring broke down mid-batch, finish the remaining files without it
+            vector<string> rest;
+            vector<size_t> indexes;
+
+            for (const auto& s : slots) {
+                if (s.fd >= 0 && !done[s.file]) {
+                    close(s.fd);
+                }
+            }
+
+            ring_.reset();
+
+            for (size_t i = 0; i < paths.size(); ++i) {
+                if (!done[i]) {
+                    rest.push_back(paths[i]);
+                    indexes.push_back(i);
+                }
+            }
+
+            auto read = read_with_pread(rest);
+
+            for (size_t i = 0; i < indexes.size(); ++i) {
+                results[indexes[i]] = std::move(read[i]);
+            }
+
+            return results;
+        }
+
+        ring_->drain([&](uint64_t user_data, int result) {
+            auto s = static_cast<unsigned int>(user_data);
+            slot& current = slots[s];
+
+            switch (current.current) {
+                case OPENING:
+                    if (result < 0) {
+                        done[current.file] = true;
+                        --active;
+                        start_file(s);
+
+                        return;
+                    }
+
+                    current.fd = result;
+                    results[current.file] = string();
+                    submit_read(s);
+                    break;
+
+                case READING:
+                    if (result < 0) {
+                        results[current.file].reset();
+                        submit_close(s);
+
+                        return;
+                    }
+
+                    results[current.file]->append(buffers_.data() + s * buffer_size_, result);
+                    current.offset += result;
+
+                    if (static_cast<size_t>(result) < buffer_size_) {
+                        submit_close(s);
+                    } else {
+                        submit_read(s);
+                    }
+
+                    break;
+
+                case CLOSING:
+                    done[current.file] = true;
+                    --active;
+                    start_file(s);
+                    break;
+            }
+        });
+    }
+
+    return results;
+}
+#else
+vector<optional<string>> batch_file_reader::read_with_ring(const vector<string>& paths) {
+    return read_with_pread(paths);
+}
+#endif
+
+vector<optional<string>> batch_file_reader::read_with_pread(const vector<string>& paths) {
+    vector<optional<string>> results(paths.size());
+    char* buffer = buffers_.data();
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        int fd = open(paths[i].c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0) {
+            continue;
+        }
+
+        string content;
+        uint64_t offset = 0;
+        ssize_t read;
+
+        while ((read = pread(fd, buffer, buffer_size_, static_cast<off_t>(offset))) > 0 ||
+               (read < 0 && errno == EINTR)) {
+            if (read > 0) {
+                content.append(buffer, read);
+                offset += read;
+            }
+        }
+
+        close(fd);
+
+        if (read == 0) {
+            results[i] = std::move(content);
+        }
+    }
+
+    return results;
+}
@@ -0,0 +1,337 @@
+#include "byte_source.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#ifdef HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAS_ZSTD
+#include <zstd.h>
+#endif
+
+using std::runtime_error;
+using std::unique_lock;
+
+bool byte_source::seek(uint64_t) {
+    return false;
+}
+
+plain_byte_source::plain_byte_source(const string& path) : file_(path, std::ios::binary) {}
+
+bool plain_byte_source::is_open() const {
+    return file_.is_open();
+}
+
+size_t plain_byte_source::read(char* buffer, size_t size) {
+    file_.read(buffer, static_cast<std::streamsize>(size));
+
+    return static_cast<size_t>(file_.gcount());
+}
+
+bool plain_byte_source::seek(uint64_t offset) {
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(offset));
+
+    return file_.good();
+}
+
+memory_byte_source::memory_byte_source(string_view bytes) : bytes_(bytes) {}
+
+size_t memory_byte_source::read(char* buffer, size_t size) {
+    size_t count = std::min(size, bytes_.size() - position_);
+
+    std::copy_n(bytes_.data() + position_, count, buffer);
+    position_ += count;
+
+    return count;
+}
+
+bool memory_byte_source::seek(uint64_t offset) {
+    if (offset > bytes_.size()) {
+        return false;
+    }
+
+    position_ = offset;
+
+    return true;
+}
+
+#ifdef HAS_ZLIB
+gzip_byte_source::gzip_byte_source(const string& path) {
+    gzFile file = gzopen(path.c_str(), "rb");
+
+    if (file != nullptr) {
+        gzbuffer(file, 128 * 1024);
+    }
+
+    file_ = file;
+}
+
+gzip_byte_source::~gzip_byte_source() {
+    if (file_ != nullptr) {
+        gzclose(static_cast<gzFile>(file_));
+    }
+}
+
+size_t gzip_byte_source::read(char* buffer, size_t size) {
+    int read = gzread(static_cast<gzFile>(file_), buffer, static_cast<unsigned>(size));
+
+    if (read < 0) {
+        int error;
+
+        throw runtime_error(string("Cannot decompress gzip stream: ") + gzerror(static_cast<gzFile>(file_), &error));
+    }
+
+    return static_cast<size_t>(read);
+}
+#else
+gzip_byte_source::gzip_byte_source(const string&) {
+    throw runtime_error("gzip support is not compiled in");
+}
+
+gzip_byte_source::~gzip_byte_source() = default;
+
+size_t gzip_byte_source::read(char*, size_t) {
+    return 0;
+}
+#endif
+
+bool gzip_byte_source::is_open() const {
+    return file_ != nullptr;
+}
+
+#ifdef HAS_ZSTD
+zstd_byte_source::zstd_byte_source(const string& path) : input_(ZSTD_DStreamInSize()) {
+    file_ = std::fopen(path.c_str(), "rb");
+
+    if (file_ != nullptr) {
+        stream_ = ZSTD_createDStream();
+        ZSTD_initDStream(static_cast<ZSTD_DStream*>(stream_));
+    }
+}
+
+zstd_byte_source::~zstd_byte_source() {
+    if (stream_ != nullptr) {
+        ZSTD_freeDStream(static_cast<ZSTD_DStream*>(stream_));
+    }
+
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+size_t zstd_byte_source::read(char* buffer, size_t size) {
+    ZSTD_outBuffer output = {buffer, size, 0};
+
+    while (output.pos == 0) {
+        if (input_offset_ == input_size_) {
+            if (input_done_) {
+                break;
+            }
+
+            input_size_ = std::fread(input_.data(), 1, input_.size(), file_);
+            input_offset_ = 0;
+            input_done_ = input_size_ < input_.size();
+
+            if (input_size_ == 0) {
+                break;
+            }
+        }
+
+        ZSTD_inBuffer input = {input_.data(), input_size_, input_offset_};
+        size_t result = ZSTD_decompressStream(static_cast<ZSTD_DStream*>(stream_), &output, &input);
+
+        if (ZSTD_isError(result)) {
+            throw runtime_error(string("Cannot decompress zstd stream: ") + ZSTD_getErrorName(result));
+        }
+
+        input_offset_ = input.pos;
+    }
+
+    return output.pos;
+}
+#else
+zstd_byte_source::zstd_byte_source(const string&) {
+    throw runtime_error("zstd support is not compiled in");
+}
+
+zstd_byte_source::~zstd_byte_source() = default;
+
+size_t zstd_byte_source::read(char*, size_t) {
+    return 0;
+}
+#endif
+
+bool zstd_byte_source::is_open() const {
+    return file_ != nullptr;
+}
+
+pipelined_byte_source::pipelined_byte_source(unique_ptr<byte_source> source, size_t block_size, size_t blocks_num)
+        : source_(std::move(source)),
+          block_size_(std::max<size_t>(block_size, 1)),
+          blocks_num_(std::max<size_t>(blocks_num, 1)) {
+    worker_ = thread(&pipelined_byte_source::produce, this);
+}
+
+pipelined_byte_source::~pipelined_byte_source() {
+    {
+        unique_lock lock(mutex_);
+
+        is_stopped_ = true;
+    }
+
+    blocks_cv_.notify_all();
+    worker_.join();
+}
+
+size_t pipelined_byte_source::read(char* buffer, size_t size) {
+    size_t copied = 0;
+
+    while (copied < size) {
+        if (current_offset_ == current_.size()) {
+            unique_lock lock(mutex_);
+
+            blocks_cv_.wait(lock, [this]() {
+                return !blocks_.empty() || is_finished_;
+            });
+
+            if (blocks_.empty()) {
+                if (error_) {
+                    std::rethrow_exception(std::exchange(error_, nullptr));
+                }
+
+                break;
+            }
+
+            current_ = std::move(blocks_.front());
+            current_offset_ = 0;
+            blocks_.pop();
+            blocks_cv_.notify_all();
+        }
+
+        size_t n = std::min(size - copied, current_.size() - current_offset_);
+
+        std::memcpy(buffer + copied, current_.data() + current_offset_, n);
+        copied += n;
+        current_offset_ += n;
+    }
+
+    return copied;
+}
+
+void pipelined_byte_source::produce() {
+    try {
+        while (true) {
+            vector<char> block(block_size_);
+            size_t size = source_->read(block.data(), block.size());
+
+            if (size == 0) {
+                break;
+            }
+
+            block.resize(size);
+
+            unique_lock lock(mutex_);
+
+            blocks_cv_.wait(lock, [this]() {
+                return blocks_.size() < blocks_num_ || is_stopped_;
+            });
+
+            if (is_stopped_) {
+                break;
+            }
+
+            blocks_.push(std::move(block));
+            blocks_cv_.notify_all();
+        }
+    } catch (...) {
+        unique_lock lock(mutex_);
+
+        error_ = std::current_exception();
+    }
+
+    unique_lock lock(mutex_);
+
+    is_finished_ = true;
+    blocks_cv_.notify_all();
+}
+
+bool is_compressed(const fs::path& path) {
+    auto extension = path.extension();
+
+    return extension == ".gz" || extension == ".zst";
+}
+
+bool is_compression_supported(const fs::path& path) {
+    auto extension = path.extension();
+
+    if (extension == ".gz") {
+#ifdef HAS_ZLIB
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    if (extension == ".zst") {
+#ifdef HAS_ZSTD
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    return true;
+}
+
+unique_ptr<byte_source> open_byte_source(const string& path) {
+    auto extension = fs::path(path).extension();
+
+    if (extension == ".gz") {
+        auto source = std::make_unique<gzip_byte_source>(path);
+
+        if (!source->is_open()) {
+            return nullptr;
+        }
+
+        return std::make_unique<pipelined_byte_source>(std::move(source));
+    }
+
+    if (extension == ".zst") {
+        auto source = std::make_unique<zstd_byte_source>(path);
+
+        if (!source->is_open()) {
+            return nullptr;
+        }
+
+        return std::make_unique<pipelined_byte_source>(std::move(source));
+    }
+
+    auto source = std::make_unique<plain_byte_source>(path);
+
+    if (!source->is_open()) {
+        return nullptr;
+    }
+
+    return source;
+}
+
+optional<string> read_document(const string& path) {
+    auto source = open_byte_source(path);
+
+    if (source == nullptr) {
+        return std::nullopt;
+    }
+
+    string bytes;
+    vector<char> buffer(256 * 1024);
+
+    while (size_t read = source->read(buffer.data(), buffer.size())) {
+        bytes.append(buffer.data(), read);
+    }
+
+    return bytes;
+}
@@ -0,0 +1,146 @@
+#ifndef INVERTED_INDEX_LIB_BYTE_SOURCE_H
+#define INVERTED_INDEX_LIB_BYTE_SOURCE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using std::condition_variable;
+using std::exception_ptr;
+using std::ifstream;
+using std::mutex;
+using std::optional;
+using std::queue;
+using std::string;
+using std::string_view;
+using std::thread;
+using std::unique_ptr;
+using std::vector;
+
+// Sequential source of raw document bytes. read() returns 0 at the end of
+// the stream. Only plain files can seek, which byte ranges rely on.
+class byte_source {
+public:
+    virtual ~byte_source() = default;
+
+    virtual size_t read(char* buffer, size_t size) = 0;
+    virtual bool seek(uint64_t offset);
+};
+
+class plain_byte_source final : public byte_source {
+public:
+    explicit plain_byte_source(const string& path);
+
+    [[nodiscard]] bool is_open() const;
+    size_t read(char* buffer, size_t size) override;
+    bool seek(uint64_t offset) override;
+
+private:
+    ifstream file_;
+};
+
+// Bytes that are already in memory, e.g. read ahead by another thread. The
+// buffer is not copied and must outlive the source.
+class memory_byte_source final : public byte_source {
+public:
+    explicit memory_byte_source(string_view bytes);
+
+    size_t read(char* buffer, size_t size) override;
+    bool seek(uint64_t offset) override;
+
+private:
+    string_view bytes_;
+    size_t position_ = 0;
+};
+
+class gzip_byte_source final : public byte_source {
+public:
+    explicit gzip_byte_source(const string& path);
+    ~gzip_byte_source() override;
+
+    [[nodiscard]] bool is_open() const;
+    size_t read(char* buffer, size_t size) override;
+
+private:
+    void* file_ = nullptr;
+};
+
+class zstd_byte_source final : public byte_source {
+public:
+    explicit zstd_byte_source(const string& path);
+    ~zstd_byte_source() override;
+
+    [[nodiscard]] bool is_open() const;
+    size_t read(char* buffer, size_t size) override;
+
+private:
+    std::FILE* file_ = nullptr;
+    void* stream_ = nullptr;
+    vector<char> input_;
+    size_t input_size_ = 0;
+    size_t input_offset_ = 0;
+    bool input_done_ = false;
+};
+
+// Runs another source on its own thread, a few blocks ahead of the reader,
+// so decompression overlaps with tokenizing instead of alternating with it.
+class pipelined_byte_source final : public byte_source {
+public:
+    static constexpr size_t default_block_size = 256 * 1024;
+    static constexpr size_t default_blocks_num = 4;
+
+    explicit pipelined_byte_source(
+            unique_ptr<byte_source> source,
+            size_t block_size = default_block_size,
+            size_t blocks_num = default_blocks_num
+    );
+    ~pipelined_byte_source() override;
+
+    size_t read(char* buffer, size_t size) override;
+
+private:
+    unique_ptr<byte_source> source_;
+    size_t block_size_;
+    size_t blocks_num_;
+
+    queue<vector<char>> blocks_;
+    vector<char> current_;
+    size_t current_offset_ = 0;
+
+    mutex mutex_;
+    condition_variable blocks_cv_;
+    bool is_finished_ = false;
+    bool is_stopped_ = false;
+    exception_ptr error_;
+
+    thread worker_;
+
+    void produce();
+};
+
+bool is_compressed(const fs::path& path);
+bool is_compression_supported(const fs::path& path);
+
+// Opens a plain, .gz or .zst document. Compressed documents are pipelined.
+// Returns nullptr when the file cannot be opened, and throws runtime_error
+// when the format is not compiled in.
+unique_ptr<byte_source> open_byte_source(const string& path);
+
+// The whole content of a document, decompressed, through open_byte_source.
+// std::nullopt when it cannot be opened.
+optional<string> read_document(const string& path);
+
+#endif
@@ -0,0 +1,89 @@
+#include "chunked_reader.h"
+#include <stdexcept>
+
+using std::runtime_error;
+
+chunked_reader::chunked_reader(const string& path, size_t chunk_size, uint64_t begin, uint64_t end)
+        : source_(open_byte_source(path)), buffer_(chunk_size > 0 ? chunk_size : default_chunk_size), end_(end) {
+    if (source_ == nullptr) {
+        done_ = true;
+
+        return;
+    }
+
+    if (begin > 0) {
+        seek_to_boundary(begin);
+    }
+
+    if (position_ >= end_) {
+        done_ = true;
+    }
+}
+
+chunked_reader::chunked_reader(unique_ptr<byte_source> source, size_t chunk_size)
+        : source_(std::move(source)), buffer_(chunk_size > 0 ? chunk_size : default_chunk_size) {
+    if (source_ == nullptr) {
+        done_ = true;
+    }
+}
+
+bool chunked_reader::is_open() const {
+    return source_ != nullptr;
+}
+
+bool chunked_reader::next(wstring& chunk) {
+    chunk.clear();
+
+    if (done_) {
+        return false;
+    }
+
+    size_t size = source_->read(buffer_.data(), buffer_.size());
+
+    if (size == 0) {
+        done_ = true;
+
+        return false;
+    }
+
+    if (end_ != npos) {
+        for (size_t i = 0; i < size; ++i) {
+            if (position_ + i + 1 >= end_ && is_boundary(buffer_[i])) {
+                size = i + 1;
+                done_ = true;
+
+                break;
+            }
+        }
+    }
+
+    chunk.reserve(size);
+    decoder_.decode(buffer_.data(), size, chunk);
+    position_ += size;
+
+    return true;
+}
+
+void chunked_reader::seek_to_boundary(uint64_t begin) {
+    if (!source_->seek(begin - 1)) {
+        throw runtime_error("Cannot seek in document, only plain files can be split");
+    }
+
+    position_ = begin - 1;
+
+    char c;
+
+    while (source_->read(&c, 1) == 1) {
+        ++position_;
+
+        if (is_boundary(c)) {
+            return;
+        }
+    }
+
+    done_ = true;
+}
+
+bool chunked_reader::is_boundary(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
@@ -0,0 +1,55 @@
+#ifndef INVERTED_INDEX_LIB_CHUNKED_READER_H
+#define INVERTED_INDEX_LIB_CHUNKED_READER_H
+
+#include "byte_source.h"
+#include "utf8_decoder.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using std::wstring;
+
+// Reads a file (plain or compressed, see open_byte_source) in fixed-size
+// chunks and decodes each chunk from UTF-8 to wide characters, carrying
+// incomplete sequences over to the next chunk. Memory use is bounded by the
+// chunk size whatever the file size is.
+//
+// A reader can also be limited to the byte range [begin, end) of a file so
+// one big file can be split across workers. Both ends are moved forward to
+// the next ASCII whitespace, so every token belongs to exactly one range and
+// adjacent ranges never overlap. Ranges need a seekable, i.e. plain, file.
+class chunked_reader {
+public:
+    static constexpr size_t default_chunk_size = 64 * 1024;
+    static constexpr uint64_t npos = std::numeric_limits<uint64_t>::max();
+
+    explicit chunked_reader(
+            const string& path,
+            size_t chunk_size = default_chunk_size,
+            uint64_t begin = 0,
+            uint64_t end = npos
+    );
+    explicit chunked_reader(unique_ptr<byte_source> source, size_t chunk_size = default_chunk_size);
+
+    [[nodiscard]] bool is_open() const;
+    bool next(wstring& chunk);
+
+private:
+    unique_ptr<byte_source> source_;
+    vector<char> buffer_;
+    utf8_decoder decoder_;
+    uint64_t position_ = 0;
+    uint64_t end_ = npos;
+    bool done_ = false;
+
+    void seek_to_boundary(uint64_t begin);
+    static bool is_boundary(char c);
+};
+
+#endif
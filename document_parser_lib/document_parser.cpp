@@ -1,67 +1,112 @@
 #include "document_parser.h"
+#include "analyzer.h"
+#include "chunked_reader.h"
+#include "utf8_decoder.h"
+#ifdef EMBEDDED_STOP_WORDS
+#include "default_stop_words.h"
+#endif
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
 
 using std::ifstream;
 using std::stringstream;
-using std::iswalpha;
-using std::towlower;
 using std::cerr;
 using std::endl;
 using std::runtime_error;
-using std::mbstowcs;
 
-document_parser::document_parser() {
-    stem_english = new stemming::english_stem<>();
-}
+document_parser::document_parser() = default;
 
-document_parser::~document_parser() {
-    delete stem_english;
-}
+document_parser::~document_parser() = default;
 
-words document_parser::parse_document(const document_path &path) {
-    try {
-        ifstream file(path);
+auto document_parser::file_source(const document_path &path, uint64_t begin, uint64_t end) const {
+    return [this, &path, begin, end](auto&& feed) {
+        chunked_reader reader(path, chunk_size_, begin, end);
 
-        if (!file.is_open()) {
+        if (!reader.is_open()) {
             throw runtime_error("Cannot open file" + path);
         }
 
-        stringstream buffer;
+        wstring chunk;
 
-        buffer << file.rdbuf();
+        while (reader.next(chunk)) {
+            feed(chunk);
+        }
+    };
+}
 
-        file.close();
+auto document_parser::bytes_source(string_view bytes) const {
+    return [this, bytes](auto&& feed) {
+        chunked_reader reader(std::make_unique<memory_byte_source>(bytes), chunk_size_);
+        wstring chunk;
 
-        wstring content = string_to_wstring(buffer.str());
+        while (reader.next(chunk)) {
+            feed(chunk);
+        }
+    };
+}
 
-        return parse_words(content);
+auto document_parser::content_source(const wstring &content) {
+    return [&content](auto&& feed) {
+        feed(content);
+    };
+}
+
+words document_parser::parse_document(const document_path &path) {
+    words result;
+
+    try {
+        for_each_term(file_source(path, 0, chunked_reader::npos), analyzer_, [&result](const wstring& term) {
+            result.insert(term);
+        });
     } catch (runtime_error& e) {
         cerr << e.what() << endl;
 
         return {};
     }
-}
 
-void document_parser::stem_word(wstring &word) {
-    stem_english->operator()(word);
+    return result;
 }
 
-basic_string<wchar_t> document_parser::string_to_wstring(const string &str) {
-    if (str.empty()) {
+term_frequencies document_parser::parse_document_frequencies(const document_path &path) {
+    try {
+        return count_terms(file_source(path, 0, chunked_reader::npos), analyzer_);
+    } catch (runtime_error& e) {
+        cerr << e.what() << endl;
+
         return {};
     }
+}
 
-    size_t size_needed = mbstowcs(nullptr, str.c_str(), 0) + 1;
-    wstring wstr_to(size_needed, 0);
+term_id_frequencies document_parser::parse_document_term_ids(const document_path &path) {
+    return parse_document_term_ids(path, 0, chunked_reader::npos);
+}
 
-    mbstowcs(&wstr_to[0], str.c_str(), size_needed);
+term_id_frequencies document_parser::parse_document_term_ids(const document_path &path, uint64_t begin, uint64_t end) {
+    try {
+        return to_term_ids(count_terms(file_source(path, begin, end), analyzer_));
+    } catch (runtime_error& e) {
+        cerr << e.what() << endl;
 
-    return wstr_to;
+        return {};
+    }
+}
+
+term_id_frequencies document_parser::parse_bytes_term_ids(string_view bytes) {
+    return to_term_ids(count_terms(bytes_source(bytes), analyzer_));
+}
+
+basic_string<wchar_t> document_parser::string_to_wstring(const string &str) {
+    return utf8_decoder::decode(str);
 }
 
 bool document_parser::add_stop_words(const fs::path &path) {
+    return add_stop_words(path, analyzer_);
+}
+
+// The words only apply to text analyzed with type.
+bool document_parser::add_stop_words(const fs::path &path, analyzer_type type) {
     try {
         ifstream file(path);
 
@@ -76,18 +121,21 @@ bool document_parser::add_stop_words(const fs::path &path) {
         file.close();
 
         wstring content = string_to_wstring(buffer.str());
+        auto& language_stop_words = stop_words_[type];
 
         wstring word;
 
+        content += L' ';
+
         for (auto& it : content) {
-            if (iswalpha(it)) {
-                word += towlower(it);
+            if (unicode_ctype::is_alpha(it)) {
+                word += unicode_ctype::to_lower(it);
 
                 continue;
             }
 
             if (!word.empty()) {
-                stop_words_.insert(word);
+                language_stop_words.insert(word);
                 word.clear();
             }
         }
@@ -100,29 +148,165 @@ bool document_parser::add_stop_words(const fs::path &path) {
     return true;
 }
 
-words document_parser::parse_words(const wstring &content) {
-    words result;
-    wstring word;
+bool document_parser::add_default_stop_words() {
+#ifdef EMBEDDED_STOP_WORDS
+    default_stop_words_ = true;
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+template<typename Source, typename F>
+void document_parser::for_each_term(Source&& source, analyzer_type type, F&& on_term) {
+    switch (type) {
+        case ENGLISH:
+            for_each_analyzed_term<ENGLISH>(source, on_term);
+            break;
+
+        case PLAIN:
+            for_each_analyzed_term<PLAIN>(source, on_term);
+            break;
+    }
+}
+
+template<analyzer_type type, typename Source, typename F>
+void document_parser::for_each_analyzed_term(Source&& source, F&& on_term) {
+    using text_analyzer = analyzer<type>;
 
-    for (auto& it : content) {
-        if (iswalpha(it)) {
-            word += towlower(it);
+    typename text_analyzer::stemmer stemmer;
+    auto added = stop_words_.find(type);
+    const stop_words* language_stop_words = added != stop_words_.end() ? &added->second : nullptr;
+    [[maybe_unused]] bool defaults = default_stop_words_ && text_analyzer::has_default_stop_words;
+    wstring word;
 
-            continue;
+    auto is_stop_word = [&](const wstring& w) {
+#ifdef EMBEDDED_STOP_WORDS
+        if (defaults && default_stop_words.contains(w)) {
+            return true;
         }
+#endif
+
+        return language_stop_words != nullptr && language_stop_words->contains(w);
+    };
 
+    auto flush_word = [&]() {
         if (word.empty()) {
-            continue;
+            return;
         }
 
-        stem_word(word);
+        if (!is_stop_word(word)) {
+            text_analyzer::stem(stemmer, word);
 
-        if (!stop_words_.contains(word)) {
-            result.insert(word);
+            if (!is_stop_word(word)) {
+                on_term(word);
+            }
         }
 
         word.clear();
+    };
+
+    source([&](const wstring& chunk) {
+        for (auto& it : chunk) {
+            if (text_analyzer::is_token_char(it)) {
+                word += text_analyzer::normalize(it);
+
+                continue;
+            }
+
+            flush_word();
+        }
+    });
+
+    flush_word();
+}
+
+template<typename Source>
+term_frequencies document_parser::count_terms(Source&& source, analyzer_type type) {
+    thread_local unordered_map<wstring, uint32_t> counts;
+
+    counts.clear();
+
+    for_each_term(source, type, [](const wstring& term) {
+        ++counts[term];
+    });
+
+    term_frequencies result(counts.begin(), counts.end());
+
+    counts.clear();
+    std::sort(result.begin(), result.end());
+
+    return result;
+}
+
+term_id_frequencies document_parser::to_term_ids(const term_frequencies &terms) {
+    if (dictionary_ == nullptr) {
+        throw runtime_error("Term dictionary is not set");
+    }
+
+    term_id_frequencies result;
+
+    result.reserve(terms.size());
+
+    for (const auto& [term, count] : terms) {
+        bool inserted;
+        term_id id = dictionary_->intern(term, inserted);
+
+        if (inserted && trigrams_ != nullptr) {
+            trigrams_->add(id, term);
+        }
+
+        result.emplace_back(id, count);
     }
 
+    std::sort(result.begin(), result.end());
+
     return result;
 }
+
+words document_parser::parse_words(const wstring &content) {
+    return parse_words(content, analyzer_);
+}
+
+words document_parser::parse_words(const wstring &content, analyzer_type type) {
+    words result;
+
+    for_each_term(content_source(content), type, [&result](const wstring& term) {
+        result.insert(term);
+    });
+
+    return result;
+}
+
+term_frequencies document_parser::parse_word_frequencies(const wstring &content) {
+    return parse_word_frequencies(content, analyzer_);
+}
+
+term_frequencies document_parser::parse_word_frequencies(const wstring &content, analyzer_type type) {
+    return count_terms(content_source(content), type);
+}
+
+term_id_frequencies document_parser::parse_word_term_ids(const wstring &content) {
+    return to_term_ids(parse_word_frequencies(content));
+}
+
+void document_parser::set_dictionary(term_dictionary *dictionary) {
+    dictionary_ = dictionary;
+}
+
+void document_parser::set_trigram_index(trigram_index *trigrams) {
+    trigrams_ = trigrams;
+}
+
+void document_parser::set_analyzer(analyzer_type type) {
+    analyzer_ = type;
+}
+
+analyzer_type document_parser::get_analyzer() const {
+    return analyzer_;
+}
+
+void document_parser::set_chunk_size(size_t chunk_size) {
+    chunk_size_ = chunk_size;
+}
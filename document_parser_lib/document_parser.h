@@ -1,24 +1,36 @@
 #ifndef INVERTED_INDEX_LIB_FILE_PARSER_H
 #define INVERTED_INDEX_LIB_FILE_PARSER_H
 
-#include "english_stem.h"
+#include "stop_word_set.h"
+#include "term_dictionary.h"
+#include "trigram_index.h"
+#include "../enums_lib/analyzer_type.h"
 #include <vector>
 #include <unordered_set>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <filesystem>
 
 namespace fs = std::filesystem;
 
 using std::vector;
 using std::unordered_set;
+using std::unordered_map;
+using std::pair;
 
 using std::string;
 using std::wstring;
 using std::basic_string;
+using std::string_view;
 
 using document_path = string;
 using words = unordered_set<wstring>;
-using stop_words = words;
+using stop_words = stop_word_set;
+using term_frequency = pair<wstring, uint32_t>;
+using term_frequencies = vector<term_frequency>;
 
 class document_parser {
 public:
@@ -26,15 +38,47 @@ public:
     ~document_parser();
 
     words parse_document(const document_path& path);
+    term_frequencies parse_document_frequencies(const document_path& path);
+    term_id_frequencies parse_document_term_ids(const document_path& path);
+    term_id_frequencies parse_document_term_ids(const document_path& path, uint64_t begin, uint64_t end);
+    term_id_frequencies parse_bytes_term_ids(string_view bytes);
     bool add_stop_words(const fs::path &path);
+    bool add_stop_words(const fs::path &path, analyzer_type type);
+    bool add_default_stop_words();
     words parse_words(const wstring& content);
+    words parse_words(const wstring& content, analyzer_type type);
+    term_frequencies parse_word_frequencies(const wstring& content);
+    term_frequencies parse_word_frequencies(const wstring& content, analyzer_type type);
+    term_id_frequencies parse_word_term_ids(const wstring& content);
+    void set_dictionary(term_dictionary* dictionary);
+    void set_trigram_index(trigram_index* trigrams);
+    void set_analyzer(analyzer_type type);
+    [[nodiscard]] analyzer_type get_analyzer() const;
+    void set_chunk_size(size_t chunk_size);
     static basic_string<wchar_t> string_to_wstring(const string& str);
 
 private:
-    stemming::english_stem<>* stem_english;
-    stop_words stop_words_{};
+    analyzer_type analyzer_ = ENGLISH;
+    unordered_map<analyzer_type, stop_words> stop_words_;
+    bool default_stop_words_ = false;
+    term_dictionary* dictionary_ = nullptr;
+    trigram_index* trigrams_ = nullptr;
+    size_t chunk_size_ = 64 * 1024;
 
-    void stem_word(wstring& word);
+    term_id_frequencies to_term_ids(const term_frequencies& terms);
+
+    auto file_source(const document_path& path, uint64_t begin, uint64_t end) const;
+    auto bytes_source(string_view bytes) const;
+    static auto content_source(const wstring& content);
+
+    template<typename Source, typename F>
+    void for_each_term(Source&& source, analyzer_type type, F&& on_term);
+
+    template<analyzer_type type, typename Source, typename F>
+    void for_each_analyzed_term(Source&& source, F&& on_term);
+
+    template<typename Source>
+    term_frequencies count_terms(Source&& source, analyzer_type type);
 
 };
 
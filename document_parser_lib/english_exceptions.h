@@ -0,0 +1,46 @@
+#ifndef INVERTED_INDEX_LIB_ENGLISH_EXCEPTIONS_H
+#define INVERTED_INDEX_LIB_ENGLISH_EXCEPTIONS_H
+
+#include "static_word_table.h"
+
+// Porter2 exceptional forms (lowercase), resolved before english_stem runs.
+// The post step 1a exceptions are listed together with the plurals that
+// step 1a reduces to them. Every entry must match what english_stem returns.
+inline constexpr static_word_table<34> english_exceptions({{
+        {L"skis", L"ski"},
+        {L"skies", L"sky"},
+        {L"dying", L"die"},
+        {L"lying", L"lie"},
+        {L"tying", L"tie"},
+        {L"idly", L"idl"},
+        {L"gently", L"gentl"},
+        {L"ugly", L"ugli"},
+        {L"early", L"earli"},
+        {L"only", L"onli"},
+        {L"singly", L"singl"},
+        {L"sky", L"sky"},
+        {L"news", L"news"},
+        {L"howe", L"howe"},
+        {L"atlas", L"atlas"},
+        {L"cosmos", L"cosmos"},
+        {L"bias", L"bias"},
+        {L"andes", L"andes"},
+        {L"inning", L"inning"},
+        {L"innings", L"inning"},
+        {L"outing", L"outing"},
+        {L"outings", L"outing"},
+        {L"canning", L"canning"},
+        {L"cannings", L"canning"},
+        {L"herring", L"herring"},
+        {L"herrings", L"herring"},
+        {L"earring", L"earring"},
+        {L"earrings", L"earring"},
+        {L"proceed", L"proceed"},
+        {L"proceeds", L"proceed"},
+        {L"exceed", L"exceed"},
+        {L"exceeds", L"exceed"},
+        {L"succeed", L"succeed"},
+        {L"succeeds", L"succeed"},
+}});
+
+#endif
@@ -0,0 +1,19 @@
+# Generates default_stop_words.h from a stop words list.
+# Words are split the same way document_parser::add_stop_words does it:
+# runs of latin letters, lowercased.
+#
+# Usage: cmake -DINPUT=<stop_words.txt> -DTEMPLATE=<default_stop_words.h.in> -DOUTPUT=<header> -P generate_stop_words.cmake
+
+file(READ "${INPUT}" content)
+string(TOLOWER "${content}" content)
+string(REGEX MATCHALL "[a-z]+" stop_words "${content}")
+list(REMOVE_DUPLICATES stop_words)
+list(LENGTH stop_words STOP_WORDS_COUNT)
+
+set(STOP_WORDS_ENTRIES "")
+
+foreach (stop_word IN LISTS stop_words)
+    string(APPEND STOP_WORDS_ENTRIES "        {L\"${stop_word}\", L\"\"},\n")
+endforeach ()
+
+configure_file("${TEMPLATE}" "${OUTPUT}" @ONLY)
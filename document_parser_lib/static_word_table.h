@@ -0,0 +1,126 @@
+#ifndef INVERTED_INDEX_LIB_STATIC_WORD_TABLE_H
+#define INVERTED_INDEX_LIB_STATIC_WORD_TABLE_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+using std::array;
+using std::wstring_view;
+
+struct static_word_entry {
+    wstring_view key;
+    wstring_view value;
+};
+
+// Perfect-hash word table built entirely at compile time (hash and displace):
+// keys are spread into buckets by a first hash, and every bucket gets a seed
+// that maps its keys into free slots. A lookup is two hashes and exactly one
+// key comparison, with no allocation at runtime.
+template<size_t N>
+class static_word_table {
+public:
+    consteval explicit static_word_table(const array<static_word_entry, N>& entries) {
+        array<array<size_t, N>, buckets_num> buckets{};
+        array<size_t, buckets_num> bucket_sizes{};
+        array<size_t, buckets_num> order{};
+        array<bool, slots_num> taken{};
+
+        for (size_t i = 0; i < N; ++i) {
+            size_t b = hash(entries[i].key, 0) % buckets_num;
+
+            buckets[b][bucket_sizes[b]++] = i;
+        }
+
+        for (size_t b = 0; b < buckets_num; ++b) {
+            order[b] = b;
+        }
+
+        std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+            return bucket_sizes[lhs] > bucket_sizes[rhs];
+        });
+
+        for (size_t b : order) {
+            if (bucket_sizes[b] == 0) {
+                break;
+            }
+
+            uint32_t seed = 1;
+
+            for (;; ++seed) {
+                if (seed > max_seed) {
+                    throw std::logic_error("static_word_table: cannot place keys");
+                }
+
+                array<size_t, N> slots{};
+                bool fits = true;
+
+                for (size_t k = 0; k < bucket_sizes[b] && fits; ++k) {
+                    slots[k] = hash(entries[buckets[b][k]].key, seed) % slots_num;
+                    fits = !taken[slots[k]];
+
+                    for (size_t j = 0; j < k && fits; ++j) {
+                        fits = slots[j] != slots[k];
+                    }
+                }
+
+                if (!fits) {
+                    continue;
+                }
+
+                for (size_t k = 0; k < bucket_sizes[b]; ++k) {
+                    taken[slots[k]] = true;
+                    slots_[slots[k]] = entries[buckets[b][k]];
+                }
+
+                break;
+            }
+
+            seeds_[b] = seed;
+        }
+    }
+
+    [[nodiscard]] constexpr const wstring_view* find(wstring_view word) const {
+        uint32_t seed = seeds_[hash(word, 0) % buckets_num];
+        const auto& slot = slots_[hash(word, seed) % slots_num];
+
+        if (slot.key.empty() || slot.key != word) {
+            return nullptr;
+        }
+
+        return &slot.value;
+    }
+
+    [[nodiscard]] constexpr bool contains(wstring_view word) const {
+        return find(word) != nullptr;
+    }
+
+    [[nodiscard]] static constexpr size_t size() {
+        return N;
+    }
+
+    static constexpr uint64_t hash(wstring_view word, uint32_t seed) {
+        uint64_t h = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+
+        for (auto c : word) {
+            h ^= static_cast<uint64_t>(c);
+            h *= 1099511628211ULL;
+        }
+
+        h ^= h >> 31;
+
+        return h;
+    }
+
+private:
+    static constexpr size_t buckets_num = N / 4 + 1;
+    static constexpr size_t slots_num = N + N / 4 + 1;
+    static constexpr uint32_t max_seed = 1u << 20;
+
+    array<static_word_entry, slots_num> slots_{};
+    array<uint32_t, buckets_num> seeds_{};
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include "stop_word_set.h"
+
+static constexpr size_t initial_capacity = 256;
+
+stop_word_set::stop_word_set() = default;
+
+uint64_t stop_word_set::hash(wstring_view word) {
+    uint64_t h = 14695981039346656037ULL;
+
+    for (auto c : word) {
+        h ^= static_cast<uint64_t>(c);
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+void stop_word_set::insert(wstring_view word) {
+    if (word.empty() || contains(word)) {
+        return;
+    }
+
+    if ((size_ + 1) * 2 > slots_.size()) {
+        grow();
+    }
+
+    uint64_t h = hash(word);
+    size_t i = h & mask_;
+
+    while (slots_[i].used) {
+        i = (i + 1) & mask_;
+    }
+
+    slots_[i] = {
+        h,
+        static_cast<uint32_t>(storage_.size()),
+        static_cast<uint32_t>(word.size()),
+        true
+    };
+    storage_.append(word);
+    ++size_;
+}
+
+bool stop_word_set::contains(wstring_view word) const {
+    if (size_ == 0) {
+        return false;
+    }
+
+    uint64_t h = hash(word);
+
+    for (size_t i = h & mask_; slots_[i].used; i = (i + 1) & mask_) {
+        const auto& s = slots_[i];
+
+        if (s.hash == h && s.length == word.size() && view(s) == word) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t stop_word_set::size() const {
+    return size_;
+}
+
+bool stop_word_set::empty() const {
+    return size_ == 0;
+}
+
+void stop_word_set::clear() {
+    slots_.clear();
+    mask_ = 0;
+    storage_.clear();
+    size_ = 0;
+}
+
+wstring_view stop_word_set::view(const slot& s) const {
+    return wstring_view(storage_).substr(s.offset, s.length);
+}
+
+void stop_word_set::grow() {
+    vector<slot> old = std::move(slots_);
+
+    slots_.assign(old.empty() ? initial_capacity : old.size() * 2, slot{});
+    mask_ = slots_.size() - 1;
+
+    for (const auto& s : old) {
+        if (!s.used) {
+            continue;
+        }
+
+        size_t i = s.hash & mask_;
+
+        while (slots_[i].used) {
+            i = (i + 1) & mask_;
+        }
+
+        slots_[i] = s;
+    }
+}
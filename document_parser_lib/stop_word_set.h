@@ -0,0 +1,45 @@
+#ifndef INVERTED_INDEX_LIB_STOP_WORD_SET_H
+#define INVERTED_INDEX_LIB_STOP_WORD_SET_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using std::vector;
+using std::wstring;
+using std::wstring_view;
+
+// Open-addressing set of stop words. Hashes are computed once on insert and
+// kept next to the slot, so a lookup costs one hash of the probe word plus
+// (almost always) a single slot comparison. All words share one buffer.
+class stop_word_set {
+public:
+    stop_word_set();
+
+    void insert(wstring_view word);
+    [[nodiscard]] bool contains(wstring_view word) const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] bool empty() const;
+    void clear();
+
+    static uint64_t hash(wstring_view word);
+
+private:
+    struct slot {
+        uint64_t hash = 0;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        bool used = false;
+    };
+
+    vector<slot> slots_;
+    wstring storage_;
+    size_t size_ = 0;
+    size_t mask_ = 0;
+
+    [[nodiscard]] wstring_view view(const slot& s) const;
+    void grow();
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef INVERTED_INDEX_LIB_UTF8_DECODER_H
+#define INVERTED_INDEX_LIB_UTF8_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using std::wstring;
+
+// Decodes UTF-8 to wide characters without going through the C locale, so
+// text decodes the same whatever setlocale the program did or did not call.
+// A sequence cut by the end of the input is kept and finished by the next
+// decode call. Malformed, overlong and surrogate sequences and NUL bytes
+// become a space, which the analyzers treat as a separator.
+class utf8_decoder {
+public:
+    void decode(const char* bytes, size_t size, wstring& out) {
+        for (size_t i = 0; i < size; ++i) {
+            auto byte = static_cast<unsigned char>(bytes[i]);
+
+            if (remaining_ > 0) {
+                if ((byte & 0xC0) == 0x80) {
+                    code_point_ = code_point_ << 6 | (byte & 0x3F);
+
+                    if (--remaining_ == 0) {
+                        out += is_valid(code_point_, minimum_) ? static_cast<wchar_t>(code_point_) : L' ';
+                    }
+
+                    continue;
+                }
+
+                // the sequence ended early, the byte starts something new
+                remaining_ = 0;
+                out += L' ';
+            }
+
+            if (byte < 0x80) {
+                out += byte == 0 ? L' ' : static_cast<wchar_t>(byte);
+            } else if ((byte & 0xE0) == 0xC0) {
+                start(byte & 0x1F, 1, 0x80);
+            } else if ((byte & 0xF0) == 0xE0) {
+                start(byte & 0x0F, 2, 0x800);
+            } else if ((byte & 0xF8) == 0xF0) {
+                start(byte & 0x07, 3, 0x10000);
+            } else {
+                out += L' ';
+            }
+        }
+    }
+
+    static wstring decode(const std::string& bytes) {
+        utf8_decoder decoder;
+        wstring out;
+
+        out.reserve(bytes.size());
+        decoder.decode(bytes.data(), bytes.size(), out);
+
+        if (decoder.remaining_ > 0) {
+            out += L' ';
+        }
+
+        return out;
+    }
+
+private:
+    uint32_t code_point_ = 0;
+    uint32_t minimum_ = 0;
+    int remaining_ = 0;
+
+    void start(uint32_t bits, int continuation_bytes, uint32_t minimum) {
+        code_point_ = bits;
+        remaining_ = continuation_bytes;
+        minimum_ = minimum;
+    }
+
+    static bool is_valid(uint32_t code_point, uint32_t minimum) {
+        return code_point >= minimum && code_point <= 0x10FFFF && (code_point < 0xD800 || code_point > 0xDFFF);
+    }
+};
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef INVERTED_INDEX_LIB_ANALYZER_TYPE_H
+#define INVERTED_INDEX_LIB_ANALYZER_TYPE_H
+
+enum analyzer_type {
+    ENGLISH,
+    PLAIN,
+};
+
+#endif
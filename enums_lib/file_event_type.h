@@ -0,0 +1,9 @@
+#ifndef INVERTED_INDEX_LIB_FILE_EVENT_TYPE_H
+#define INVERTED_INDEX_LIB_FILE_EVENT_TYPE_H
+
+enum file_event_type {
+    FILE_WRITTEN,
+    FILE_REMOVED,
+};
+
+#endif
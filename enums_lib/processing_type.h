@@ -2,4 +2,6 @@ enum processing_type {
     WORD_FILE,
     INDEX,
     WORD_FILES,
+    MAP_REDUCE,
+    PIPELINE,
 };
@@ -0,0 +1,10 @@
+#ifndef INVERTED_INDEX_LIB_SHARD_MESSAGE_TYPE_H
+#define INVERTED_INDEX_LIB_SHARD_MESSAGE_TYPE_H
+
+enum shard_message_type {
+    SHARD_INDEX = 1,
+    SHARD_QUERY = 2,
+    SHARD_STOP = 3,
+};
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef INVERTED_INDEX_LIB_WAL_RECORD_TYPE_H
+#define INVERTED_INDEX_LIB_WAL_RECORD_TYPE_H
+
+enum wal_record_type {
+    WAL_ADD = 1,
+    WAL_REMOVE = 2,
+};
+
+#endif
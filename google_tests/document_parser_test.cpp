@@ -1,6 +1,19 @@
 #include <gtest/gtest.h>
 #include "document_parser.h"
+#include "english_exceptions.h"
+#include "english_stem.h"
+#include "byte_source.h"
+#include "batch_file_reader.h"
 #include <stdexcept>
+#include <cstring>
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#endif
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
 
 using std::runtime_error;
 
@@ -38,3 +51,335 @@ TEST_F(DocumentParserTest, HandlesEmptyDocument) {
 
     ASSERT_TRUE(parsed_words.empty());
 }
+
+TEST_F(DocumentParserTest, FiltersStopWords) {
+    fs::path stop_words_path = "/home/mykyta/uni/PC/inverted-index/data/stop_words.txt";
+
+    ASSERT_TRUE(parser->add_stop_words(stop_words_path));
+
+    words expected_words = {L"connect", L"dot"};
+    words parsed_words = parser->parse_words(L"I am connecting the dots, and having it ");
+
+    ASSERT_EQ(parsed_words, expected_words);
+}
+
+TEST_F(DocumentParserTest, CountsTermFrequencies) {
+    term_frequencies expected = {{L"dot", 2}, {L"line", 1}, {L"connect", 3}};
+
+    std::sort(expected.begin(), expected.end());
+
+    term_frequencies parsed = parser->parse_word_frequencies(L"connect connecting dots, connected line dot ");
+
+    ASSERT_EQ(parsed, expected);
+    ASSERT_EQ(parser->parse_word_frequencies(L"dots "), term_frequencies({{L"dot", 1}}));
+}
+
+TEST_F(DocumentParserTest, PlainAnalyzerSkipsStemming) {
+    words expected_words = {L"connecting", L"dots"};
+
+    ASSERT_EQ(parser->parse_words(L"Connecting DOTS ", PLAIN), expected_words);
+
+    parser->set_analyzer(PLAIN);
+
+    ASSERT_EQ(parser->get_analyzer(), PLAIN);
+    ASSERT_EQ(parser->parse_words(L"Connecting DOTS "), expected_words);
+    ASSERT_EQ(parser->parse_words(L"Connecting DOTS ", ENGLISH), words({L"connect", L"dot"}));
+}
+
+TEST_F(DocumentParserTest, TokenizesNonAsciiLetters) {
+    // no setlocale anywhere, the analyzers still know these are letters
+    ASSERT_EQ(parser->parse_words(L"Über die Straße, CAFÉ naïve Ωμέγα ", PLAIN),
+              words({L"über", L"die", L"straße", L"café", L"naïve", L"ωμέγα"}));
+    ASSERT_EQ(document_parser::string_to_wstring("caf\xc3\xa9 \xce\xa9"), L"café Ω");
+    ASSERT_EQ(document_parser::string_to_wstring("bad\xff\xc3"), L"bad  ");
+}
+
+TEST_F(DocumentParserTest, StopWordsArePerAnalyzer) {
+    fs::path stop_words_path = fs::temp_directory_path() / "plain_stop_words.txt";
+
+    std::ofstream(stop_words_path) << "und die der";
+
+    ASSERT_TRUE(parser->add_stop_words(stop_words_path, PLAIN));
+    ASSERT_EQ(parser->parse_words(L"die Katze und der Hund ", PLAIN), words({L"katze", L"hund"}));
+    ASSERT_EQ(parser->parse_words(L"die hard ", ENGLISH), words({L"die", L"hard"}));
+
+    if (parser->add_default_stop_words()) {
+        ASSERT_EQ(parser->parse_words(L"the dots ", ENGLISH), words({L"dot"}));
+        ASSERT_EQ(parser->parse_words(L"the dots ", PLAIN), words({L"the", L"dots"}));
+    }
+
+    fs::remove(stop_words_path);
+}
+
+class StreamingParserTest : public DocumentParserTest {
+protected:
+    fs::path file = fs::temp_directory_path() / "streaming_parser_test.txt";
+    wstring content;
+
+    void SetUp() override {
+        DocumentParserTest::SetUp();
+
+        std::ofstream out(file);
+
+        for (int i = 0; i < 500; ++i) {
+            out << "Connecting dots" << i << " across\tgenerations,\nrunning endlessly ";
+            content += L"Connecting dots" + std::to_wstring(i) + L" across\tgenerations,\nrunning endlessly ";
+        }
+
+        parser->set_dictionary(&dictionary);
+    }
+
+    void TearDown() override {
+        fs::remove(file);
+        DocumentParserTest::TearDown();
+    }
+
+    term_dictionary dictionary;
+};
+
+TEST_F(StreamingParserTest, DecodesUtf8AcrossChunks) {
+    std::ofstream(file, std::ios::trunc) << "na\xc3\xafve caf\xc3\xa9 \xe2\x82\xac\xf0\x9f\x98\x80 \xce\xa9\xce\xbc\xce\xad\xce\xb3\xce\xb1";
+
+    parser->set_analyzer(PLAIN);
+
+    for (size_t chunk_size : {1, 2, 3, 4096}) {
+        parser->set_chunk_size(chunk_size);
+
+        ASSERT_EQ(parser->parse_document(file.string()), words({L"naïve", L"café", L"ωμέγα"})) << chunk_size;
+    }
+}
+
+TEST_F(StreamingParserTest, ChunkBoundariesDoNotSplitTokens) {
+    term_frequencies expected = parser->parse_word_frequencies(content);
+
+    for (size_t chunk_size : {1, 7, 64, 4096}) {
+        parser->set_chunk_size(chunk_size);
+
+        ASSERT_EQ(parser->parse_document_frequencies(file.string()), expected);
+    }
+}
+
+TEST_F(StreamingParserTest, RangesPartitionDocument) {
+    term_id_frequencies expected = parser->parse_document_term_ids(file.string());
+    uint64_t size = fs::file_size(file);
+
+    for (uint64_t range_size : {size, size / 3, 100ul, 13ul}) {
+        unordered_map<term_id, uint32_t> counts;
+
+        for (uint64_t begin = 0; begin < size; begin += range_size) {
+            for (const auto& [id, count] : parser->parse_document_term_ids(file.string(), begin, begin + range_size)) {
+                counts[id] += count;
+            }
+        }
+
+        term_id_frequencies merged(counts.begin(), counts.end());
+
+        std::sort(merged.begin(), merged.end());
+
+        ASSERT_EQ(merged, expected);
+    }
+}
+
+TEST_F(StreamingParserTest, PipelinedSourcePreservesBytes) {
+    auto expected = std::make_unique<plain_byte_source>(file.string());
+    pipelined_byte_source pipelined(std::make_unique<plain_byte_source>(file.string()), 10, 2);
+    vector<char> expected_bytes(fs::file_size(file));
+    vector<char> actual_bytes(expected_bytes.size() + 1);
+
+    ASSERT_EQ(expected->read(expected_bytes.data(), expected_bytes.size()), expected_bytes.size());
+    ASSERT_EQ(pipelined.read(actual_bytes.data(), actual_bytes.size()), expected_bytes.size());
+    ASSERT_EQ(std::memcmp(actual_bytes.data(), expected_bytes.data(), expected_bytes.size()), 0);
+    ASSERT_EQ(pipelined.read(actual_bytes.data(), actual_bytes.size()), 0);
+}
+
+TEST_F(StreamingParserTest, ParsesGzipDocument) {
+    fs::path gz_file = file.string() + ".gz";
+
+    if (!is_compression_supported(gz_file)) {
+        GTEST_SKIP() << "built without zlib";
+    }
+
+#if __has_include(<zlib.h>)
+    {
+        std::ifstream in(file, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        gzFile out = gzopen(gz_file.c_str(), "wb");
+
+        gzwrite(out, bytes.data(), static_cast<unsigned>(bytes.size()));
+        gzclose(out);
+    }
+
+    parser->set_chunk_size(100);
+
+    EXPECT_EQ(parser->parse_document_frequencies(gz_file.string()), parser->parse_word_frequencies(content));
+    EXPECT_TRUE(parser->parse_document_term_ids(gz_file.string(), 10, 20).empty());
+
+    fs::remove(gz_file);
+#endif
+}
+
+TEST(StopWordSetTest, InsertAndLookup) {
+    stop_word_set set;
+
+    for (int i = 0; i < 1000; ++i) {
+        set.insert(L"word" + std::to_wstring(i));
+    }
+
+    set.insert(L"word1");
+
+    EXPECT_EQ(set.size(), 1000);
+    EXPECT_TRUE(set.contains(L"word0"));
+    EXPECT_TRUE(set.contains(L"word999"));
+    EXPECT_FALSE(set.contains(L"word1000"));
+    EXPECT_FALSE(set.contains(L""));
+
+    set.clear();
+
+    EXPECT_TRUE(set.empty());
+    EXPECT_FALSE(set.contains(L"word0"));
+}
+
+TEST_F(DocumentParserTest, FiltersDefaultStopWords) {
+    if (!parser->add_default_stop_words()) {
+        GTEST_SKIP() << "built without EMBED_DEFAULT_STOP_WORDS";
+    }
+
+    words expected_words = {L"connect", L"dot"};
+    words parsed_words = parser->parse_words(L"I am connecting the dots, and having it ");
+
+    ASSERT_EQ(parsed_words, expected_words);
+}
+
+TEST(EnglishExceptionsTest, MatchesStemmer) {
+    static_assert(english_exceptions.contains(L"skies"));
+    static_assert(!english_exceptions.contains(L"sk"));
+
+    const wstring exceptions[] = {
+            L"skis", L"skies", L"dying", L"lying", L"tying", L"idly", L"gently", L"ugly", L"early",
+            L"only", L"singly", L"sky", L"news", L"howe", L"atlas", L"cosmos", L"bias", L"andes",
+            L"inning", L"innings", L"outing", L"outings", L"canning", L"cannings", L"herring",
+            L"herrings", L"earring", L"earrings", L"proceed", L"proceeds", L"exceed", L"exceeds",
+            L"succeed", L"succeeds",
+    };
+    stemming::english_stem<> stem;
+
+    for (const auto& exception : exceptions) {
+        wstring expected = exception;
+
+        stem(expected);
+
+        const auto* stemmed = english_exceptions.find(exception);
+
+        ASSERT_NE(stemmed, nullptr);
+        EXPECT_EQ(wstring(*stemmed), expected);
+    }
+
+    EXPECT_EQ(english_exceptions.find(L"connecting"), nullptr);
+}
+
+class BatchFileReaderTest : public ::testing::Test {
+protected:
+    fs::path dir = fs::temp_directory_path() / "batch_file_reader_test";
+    vector<string> paths;
+    vector<string> contents;
+
+    void SetUp() override {
+        fs::create_directories(dir);
+
+        for (int i = 0; i < 100; ++i) {
+            string content(i == 7 ? 200000 : i * 37, static_cast<char>('a' + i % 26));
+            string path = (dir / ("file" + std::to_string(i) + ".txt")).string();
+
+            std::ofstream(path, std::ios::binary) << content;
+            paths.push_back(path);
+            contents.push_back(content);
+        }
+    }
+
+    void TearDown() override {
+        fs::remove_all(dir);
+    }
+
+    void write_corpus(int files_num) {
+        for (int i = 0; i < files_num; ++i) {
+            std::ofstream out(dir / ("review" + std::to_string(i) + ".txt"));
+
+            for (int j = 0; j < 40; ++j) {
+                out << "a film review sentence number " << j << " ";
+            }
+
+            paths.push_back((dir / ("review" + std::to_string(i) + ".txt")).string());
+        }
+    }
+
+    void evict_page_cache() const {
+        sync();
+
+        for (const auto& path : paths) {
+            int fd = open(path.c_str(), O_RDONLY);
+
+            if (fd >= 0) {
+                posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                close(fd);
+            }
+        }
+    }
+};
+
+TEST_F(BatchFileReaderTest, ReadsWholeFiles) {
+    vector<string> requested = paths;
+
+    requested.push_back((dir / "missing.txt").string());
+    requested.push_back(dir.string());
+
+    for (bool use_io_uring : {true, false}) {
+        batch_file_reader reader(8, 4096, use_io_uring);
+        auto result = reader.read(requested);
+
+        ASSERT_EQ(result.size(), requested.size());
+
+        for (size_t i = 0; i < paths.size(); ++i) {
+            ASSERT_TRUE(result[i].has_value()) << paths[i];
+            EXPECT_EQ(*result[i], contents[i]);
+        }
+
+        EXPECT_FALSE(result[paths.size()].has_value());
+        EXPECT_FALSE(result[paths.size() + 1].has_value());
+        EXPECT_TRUE(reader.read({}).empty());
+    }
+}
+
+TEST_F(BatchFileReaderTest, ColdAndWarmPageCache) {
+    write_corpus(500);
+
+    for (bool use_io_uring : {true, false}) {
+        batch_file_reader reader(batch_file_reader::default_depth, batch_file_reader::default_buffer_size,
+                                 use_io_uring);
+        vector<vector<optional<string>>> reads;
+
+        for (bool cold : {true, false}) {
+            if (cold) {
+                evict_page_cache();
+            }
+
+            vector<optional<string>> result;
+
+            for (size_t begin = 0; begin < paths.size(); begin += 256) {
+                vector<string> batch(paths.begin() + begin, paths.begin() + std::min(begin + 256, paths.size()));
+
+                for (auto& content : reader.read(batch)) {
+                    ASSERT_TRUE(content.has_value());
+                    result.push_back(std::move(content));
+                }
+            }
+
+            reads.push_back(std::move(result));
+        }
+
+        EXPECT_EQ(reads[0], reads[1]);
+
+        for (size_t i = 0; i < contents.size(); ++i) {
+            EXPECT_EQ(*reads[0][i], contents[i]);
+        }
+    }
+}
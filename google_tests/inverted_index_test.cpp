@@ -2,6 +2,8 @@
 #include <filesystem>
 #include <fstream>
 #include "inverted_index.h"
+#include "segmented_index.h"
+#include "durable_index.h"
 
 using std::ifstream;
 using std::filesystem::remove;
@@ -92,7 +94,7 @@ TEST_F(InvertedIndexTest, SaveAsJson) {
 
     index->add(test_word, test_doc);
 
-    string file_path = "/home/mykyta/uni/PC/inverted-index/data/test_index.json";
+    string file_path = (std::filesystem::temp_directory_path() / "test_index.json").string();
 
     index->save_as_json(file_path);
 
@@ -149,6 +151,51 @@ TEST_F(InvertedIndexTest, AllDocumentsOverlapping) {
     EXPECT_EQ(result, "doc1"); // 'doc1' is the only document and appears in all word sets
 }
 
+TEST_F(InvertedIndexTest, AddTermFrequencies) {
+    index->add("doc1", term_frequencies{{L"word1", 3}, {L"word2", 1}});
+    index->add(L"word1", "doc2");
+
+    EXPECT_TRUE(index->find(L"word1").contains("doc1"));
+    EXPECT_EQ(index->term_frequency(L"word1", "doc1"), 3);
+    EXPECT_EQ(index->term_frequency(L"word1", "doc2"), 1);
+    EXPECT_EQ(index->term_frequency(L"word2", "doc2"), 0);
+    EXPECT_EQ(index->document_length("doc1"), 4);
+
+    index->remove_document_from_all_records("doc1");
+
+    EXPECT_EQ(index->term_frequency(L"word1", "doc1"), 0);
+    EXPECT_EQ(index->document_length("doc1"), 0);
+}
+
+TEST_F(InvertedIndexTest, Bm25PrefersHigherTermFrequency) {
+    index->add("doc1", term_frequencies{{L"word1", 1}, {L"word2", 5}});
+    index->add("doc2", term_frequencies{{L"word1", 5}, {L"word2", 1}});
+    index->add("doc3", term_frequencies{{L"word3", 6}});
+
+    EXPECT_EQ(index->read_bm25({L"word1"}), "doc2");
+    EXPECT_EQ(index->read_bm25({L"word2"}), "doc1");
+    EXPECT_EQ(index->read_bm25({L"word4"}), "");
+}
+
+TEST_F(InvertedIndexTest, ExpandPrefixAndWildcard) {
+    index->add(L"film", "doc1");
+    index->add(L"films", "doc2");
+    index->add(L"final", "doc3");
+
+    EXPECT_EQ(index->expand_prefix(L"film"), (vector<word>{L"film", L"films"}));
+    EXPECT_EQ(index->expand_wildcard(L"f*l"), (vector<word>{L"final"}));
+    EXPECT_EQ(index->expand_range(L"fil", L"fin"), (vector<word>{L"film", L"films"}));
+
+    index->add(L"filmmak", "doc4");
+    index->remove_word(L"films");
+
+    EXPECT_EQ(index->expand_prefix(L"film"), (vector<word>{L"film", L"filmmak"}));
+
+    index->clear();
+
+    EXPECT_TRUE(index->expand_prefix(L"f").empty());
+}
+
 void add_documents(inverted_index& index, const word& w, int num_docs, int start_id) {
     for (int i = 0; i < num_docs; ++i) {
         index.add(w, "doc" + to_string(start_id + i));
@@ -175,6 +222,56 @@ TEST_F(InvertedIndexTest, ConcurrentAdditionOfDocuments) {
     EXPECT_EQ(docs.size(), num_threads * docs_per_thread);
 }
 
+TEST_F(InvertedIndexTest, ConcurrentBulkAddsOverTermRanges) {
+    constexpr int ranges_num = 4;
+    constexpr int terms_per_range = 50;
+    constexpr int docs_num = 40;
+    vector<term_id> ids;
+    vector<thread> threads;
+
+    for (int t = 0; t < ranges_num * terms_per_range; ++t) {
+        ids.push_back(index->dictionary()->intern(L"term" + std::to_wstring(t)));
+    }
+
+    // every range adds the same documents, each under its own terms
+    for (int r = 0; r < ranges_num; ++r) {
+        threads.emplace_back([this, &ids, r] {
+            term_postings postings;
+
+            for (int t = r * terms_per_range; t < (r + 1) * terms_per_range; ++t) {
+                document_frequencies docs;
+
+                for (int d = t % 3; d < docs_num; d += 3) {
+                    docs["doc" + to_string(d)] = 1 + d % 2;
+                }
+
+                postings.emplace_back(ids[t], docs);
+            }
+
+            index->add(postings);
+        });
+    }
+
+    threads.emplace_back([this] {
+        for (int i = 0; i < 200; ++i) {
+            (void) index->read_bm25({L"term0", L"term199"});
+        }
+    });
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int t = 0; t < ranges_num * terms_per_range; ++t) {
+        EXPECT_EQ(index->find(ids[t]).size(), (docs_num - t % 3 + 2) / 3);
+    }
+
+    // doc0 and doc3 are under every third term, with frequency 1 and 2
+    EXPECT_EQ(index->document_length("doc0"), ranges_num * terms_per_range / 3 + 1);
+    EXPECT_EQ(index->document_length("doc3"), 2 * (ranges_num * terms_per_range / 3 + 1));
+    EXPECT_EQ(index->term_frequency(L"term3", "doc3"), 2);
+}
+
 void read_and_write_operations(inverted_index& index, const word& w, const document& doc) {
     index.add(w, doc);
     index.contains(w);
@@ -243,8 +340,410 @@ TEST_F(InvertedIndexTest, ClearMethodThreadSafetyTest) {
     EXPECT_FALSE(index->contains(L"word5"));
 }
 
+TEST_F(InvertedIndexTest, TombstonesAndCompaction) {
+    index->add("doc1", term_frequencies{{L"word1", 2}, {L"word2", 1}});
+    index->add("doc2", term_frequencies{{L"word1", 1}});
+
+    index->remove_document_from_all_records("doc1");
+
+    EXPECT_EQ(index->tombstones_num(), 1);
+    EXPECT_FALSE(index->find(L"word1").contains("doc1"));
+    EXPECT_FALSE(index->contains(L"word2"));
+    EXPECT_EQ(index->read({L"word2"}), "");
+    EXPECT_EQ(index->read_bm25({L"word1"}), "doc2");
+
+    // the old postings of a document added again do not come back
+    index->add("doc1", term_frequencies{{L"word3", 1}});
+
+    EXPECT_EQ(index->tombstones_num(), 0);
+    EXPECT_EQ(index->read({L"word2"}), "");
+    EXPECT_EQ(index->term_frequency(L"word1", "doc1"), 0);
+    EXPECT_EQ(index->read({L"word3"}), "doc1");
+
+    index->remove_document_from_all_records("doc2");
+
+    EXPECT_EQ(index->compact(1), 1);
+    EXPECT_EQ(index->tombstones_num(), 0);
+    EXPECT_TRUE(index->find(L"word1").empty());
+    EXPECT_TRUE(index->expand_prefix(L"word").size() == 1);
+}
+
+TEST_F(InvertedIndexTest, BackgroundCompaction) {
+    for (int i = 0; i < 100; ++i) {
+        index->add("doc" + std::to_string(i), term_frequencies{{L"word" + std::to_wstring(i), 1}, {L"common", 1}});
+    }
+
+    index->start_compaction(std::chrono::milliseconds(10));
+
+    for (int i = 0; i < 50; ++i) {
+        index->remove_document_from_all_records("doc" + std::to_string(i));
+    }
+
+    for (int i = 0; i < 200 && index->tombstones_num() > 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    index->stop_compaction();
+
+    EXPECT_EQ(index->tombstones_num(), 0);
+    EXPECT_EQ(index->find(L"common").size(), 50);
+    EXPECT_EQ(index->expand_prefix(L"word").size(), 50);
+}
+
+static segment_config segments(size_t flush_postings, size_t merge_factor, const std::filesystem::path& directory = {}) {
+    segment_config config;
+
+    config.flush_postings = flush_postings;
+    config.merge_factor = merge_factor;
+    config.directory = directory;
+
+    return config;
+}
+
+TEST(SegmentedIndexTest, FlushesAndMergesTiers) {
+    segmented_index index(nullptr, nullptr, segments(4, 2));
+
+    for (int i = 0; i < 64; ++i) {
+        index.add("doc" + to_string(i), term_frequencies{{L"common", 1}, {L"word" + std::to_wstring(i), 2}});
+    }
+
+    index.flush();
+
+    auto stats = index.stats();
+
+    EXPECT_EQ(index.find(L"common").size(), 64);
+    EXPECT_EQ(index.read({L"word7", L"common"}), "doc7");
+    EXPECT_EQ(index.term_frequency(L"word7", "doc7"), 2);
+    EXPECT_GT(stats.merges, 0);
+    EXPECT_LE(stats.segments, 4);
+    EXPECT_EQ(stats.buffered_postings, 0);
+    EXPECT_GT(stats.write_amplification(), 1.0);
+    EXPECT_LT(stats.write_amplification(), 8.0);
+}
+
+TEST(SegmentedIndexTest, DeletesOlderVersionsOnly) {
+    segmented_index index(nullptr, nullptr, segments(2, 2));
+
+    index.add("doc1", term_frequencies{{L"old", 1}, {L"both", 1}});
+    index.add("doc2", term_frequencies{{L"both", 1}});
+    index.flush();
+
+    index.remove("doc1");
+
+    EXPECT_TRUE(index.find(L"old").empty());
+    EXPECT_EQ(index.find(L"both"), documents({"doc2"}));
+
+    index.add("doc1", term_frequencies{{L"new", 1}, {L"both", 1}});
+    index.flush();
+
+    EXPECT_TRUE(index.find(L"old").empty());
+    EXPECT_EQ(index.find(L"new"), documents({"doc1"}));
+    EXPECT_EQ(index.term_frequency(L"both", "doc1"), 1);
+
+    // merging drops the dead postings, after which the tombstone is not needed
+    index.add("doc3", term_frequencies{{L"x", 1}, {L"y", 1}});
+    index.add("doc4", term_frequencies{{L"x", 1}, {L"y", 1}});
+    index.flush();
+    index.wait_merges();
+
+    EXPECT_TRUE(index.find(L"old").empty());
+    EXPECT_EQ(index.find(L"both"), documents({"doc1", "doc2"}));
+    EXPECT_EQ(index.stats().tombstones, 0);
+}
+
+TEST(SegmentedIndexTest, BackgroundMergesWithConcurrentQueries) {
+    thread_pool pool(4);
+    segmented_index index(nullptr, &pool, segments(256, 4));
+    std::atomic<bool> done = false;
+    vector<thread> writers;
+
+    for (int w = 0; w < 2; ++w) {
+        writers.emplace_back([&index, w] {
+            for (int i = 0; i < 2000; ++i) {
+                index.add("doc" + to_string(w) + "_" + to_string(i),
+                          term_frequencies{{L"common", 1}, {L"word" + std::to_wstring(i % 100), 1}});
+            }
+        });
+    }
+
+    thread reader([&index, &done] {
+        while (!done) {
+            EXPECT_LE(index.find(L"common").size(), 4000);
+        }
+    });
+
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    index.flush();
+    index.wait_merges();
+    done = true;
+    reader.join();
+
+    auto stats = index.stats();
+
+    EXPECT_EQ(index.find(L"common").size(), 4000);
+    EXPECT_EQ(index.find(L"word42").size(), 40);
+    EXPECT_LE(stats.segments, 3 * 4);
+}
+
+TEST(SegmentedIndexTest, MappedSegmentsMatchInMemory) {
+    auto directory = std::filesystem::temp_directory_path() / "mapped_segments";
+
+    std::filesystem::remove_all(directory);
+
+    {
+        term_dictionary dictionary;
+        segmented_index in_memory(&dictionary, nullptr, segments(8, 2));
+        segmented_index mapped(&dictionary, nullptr, segments(8, 2, directory));
+
+        for (int i = 0; i < 100; ++i) {
+            term_frequencies terms{{L"common", 1}, {L"word" + std::to_wstring(i % 13), static_cast<uint32_t>(i % 3 + 1)}};
+
+            in_memory.add("doc" + to_string(i), terms);
+            mapped.add("doc" + to_string(i), terms);
+        }
+
+        in_memory.remove("doc5");
+        mapped.remove("doc5");
+        in_memory.flush();
+        mapped.flush();
+        mapped.wait_merges();
+
+        EXPECT_FALSE(std::filesystem::is_empty(directory));
+
+        for (int round = 0; round < 2; ++round) {
+            EXPECT_EQ(mapped.find(L"common"), in_memory.find(L"common"));
+            EXPECT_EQ(mapped.find(L"common").size(), 99);
+
+            for (int w = 0; w < 13; ++w) {
+                EXPECT_EQ(mapped.find(L"word" + std::to_wstring(w)), in_memory.find(L"word" + std::to_wstring(w)));
+            }
+        }
+
+        EXPECT_EQ(mapped.term_frequency(L"word4", "doc17"), in_memory.term_frequency(L"word4", "doc17"));
+        EXPECT_GT(mapped.cache_stats().hits, 0);
+        EXPECT_EQ(in_memory.cache_stats().misses, 0);
+    }
+
+    EXPECT_TRUE(std::filesystem::is_empty(directory));
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(SegmentedIndexTest, PostingCacheKeepsHotTermsUnderScans) {
+    auto directory = std::filesystem::temp_directory_path() / "cached_segments";
+
+    std::filesystem::remove_all(directory);
+
+    // room for the hot list and a handful of short ones
+    auto config = segments(1 << 20, 4, directory);
+
+    config.posting_cache_bytes = 24 * 1024;
+
+    segmented_index index(nullptr, nullptr, config);
+
+    for (int i = 0; i < 1000; ++i) {
+        index.add("doc" + to_string(i), term_frequencies{{L"hot", 1}, {L"cold" + std::to_wstring(i), 1}});
+    }
+
+    index.flush();
+
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(index.find(L"hot").size(), 1000);
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(index.find(L"cold" + std::to_wstring(i)).size(), 1);
+    }
+
+    auto before = index.cache_stats();
+
+    EXPECT_EQ(index.find(L"hot").size(), 1000);
+
+    auto after = index.cache_stats();
+
+    EXPECT_EQ(after.hits, before.hits + 1);
+    EXPECT_GT(after.rejected, 0);
+    EXPECT_LE(after.bytes, 24 * 1024);
+
+    std::filesystem::remove_all(directory);
+}
+
+class DurableIndexTest : public ::testing::Test {
+protected:
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "durable_index_test";
+
+    void SetUp() override {
+        std::filesystem::remove_all(dir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir);
+    }
+};
+
+TEST_F(DurableIndexTest, ReplaysLogAfterCrash) {
+    {
+        inverted_index index;
+        durable_index durable(&index, dir, {0});
+
+        durable.add("doc1", term_frequencies{{L"word1", 3}, {L"word2", 1}});
+        durable.add("doc2", term_frequencies{{L"word1", 1}});
+        durable.add("doc3", term_frequencies{{L"word3", 1}});
+        durable.remove("doc3");
+    }
+
+    inverted_index index;
+    durable_index durable(&index, dir, {0});
+
+    EXPECT_EQ(durable.recovered_records(), 4);
+    EXPECT_EQ(index.find(L"word1"), documents({"doc1", "doc2"}));
+    EXPECT_EQ(index.term_frequency(L"word1", "doc1"), 3);
+    EXPECT_TRUE(index.find(L"word3").empty());
+}
+
+TEST_F(DurableIndexTest, CheckpointLeavesOnlyTheTailToReplay) {
+    {
+        inverted_index index;
+        durable_index durable(&index, dir);
+
+        durable.add("doc1", term_frequencies{{L"word1", 2}});
+        durable.add("doc2", term_frequencies{{L"word2", 1}});
+        durable.checkpoint();
+        durable.add("doc3", term_frequencies{{L"word1", 1}});
+    }
+
+    inverted_index index;
+    durable_index durable(&index, dir);
+
+    EXPECT_EQ(durable.recovered_records(), 1);
+    EXPECT_EQ(index.find(L"word1"), documents({"doc1", "doc3"}));
+    EXPECT_EQ(index.term_frequency(L"word1", "doc1"), 2);
+    EXPECT_EQ(index.read_bm25({L"word2"}), "doc2");
+}
+
+TEST_F(DurableIndexTest, ReplaysBulkLoadedBatch) {
+    {
+        inverted_index index;
+        durable_index durable(&index, dir, {0});
+        term_id id = index.dictionary()->intern(L"word1");
+        term_index bulk;
+
+        bulk[id] = {"doc1", "doc2"};
+
+        // the bulk add only keeps documents, the log keeps the frequencies too
+        durable.add_batch({{"doc1", {{id, 2}}}, {"doc2", {{id, 1}}}}, [&index, &bulk] {
+            index.add(bulk);
+        });
+
+        EXPECT_EQ(index.find(L"word1"), documents({"doc1", "doc2"}));
+    }
+
+    inverted_index index;
+    durable_index durable(&index, dir, {0});
+
+    EXPECT_EQ(durable.recovered_records(), 2);
+    EXPECT_EQ(index.find(L"word1"), documents({"doc1", "doc2"}));
+    EXPECT_EQ(index.term_frequency(L"word1", "doc1"), 2);
+}
+
+TEST_F(DurableIndexTest, DropsTornTail) {
+    {
+        inverted_index index;
+        durable_index durable(&index, dir);
+
+        durable.add("doc1", term_frequencies{{L"word1", 1}});
+    }
+
+    // a record whose write was cut short
+    std::ofstream(dir / "index.wal", std::ios::app | std::ios::binary) << string("\x40\x00\x00\x00garbage", 11);
+
+    {
+        inverted_index index;
+        durable_index durable(&index, dir);
+
+        EXPECT_EQ(durable.recovered_records(), 1);
+
+        durable.add("doc2", term_frequencies{{L"word2", 1}});
+    }
+
+    inverted_index index;
+    durable_index durable(&index, dir);
+
+    EXPECT_EQ(durable.recovered_records(), 2);
+    EXPECT_EQ(index.find(L"word2"), documents({"doc2"}));
+}
+
+TEST_F(DurableIndexTest, GroupCommitSharesSyncs) {
+    // enough concurrent writers for batches to form
+    constexpr int threads_num = 32;
+    constexpr int docs_per_thread = 50;
+
+    for (uint32_t interval : {0u, 1000u}) {
+        std::filesystem::remove_all(dir);
+
+        inverted_index index;
+        durable_index durable(&index, dir, {interval});
+        vector<thread> threads;
+
+        for (int t = 0; t < threads_num; ++t) {
+            threads.emplace_back([&durable, t] {
+                for (int i = 0; i < docs_per_thread; ++i) {
+                    durable.add("doc" + to_string(t) + "_" + to_string(i),
+                                term_frequencies{{L"word" + std::to_wstring(i % 50), 1}, {L"common", 2}});
+                }
+            });
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_EQ(index.find(L"common").size(), threads_num * docs_per_thread);
+        EXPECT_LE(durable.syncs(), threads_num * docs_per_thread);
+
+        if (interval > 0) {
+            EXPECT_LT(durable.syncs(), threads_num * docs_per_thread);
+        }
+    }
+}
+
+TEST_F(InvertedIndexTest, ReadBatchMatchesRead) {
+    thread_pool pool(4);
+    vector<unordered_set<word>> queries;
+
+    for (int d = 0; d < 200; ++d) {
+        term_frequencies terms;
+
+        for (int w = d % 7; w < 40; w += 1 + d % 5) {
+            terms.emplace_back(L"word" + std::to_wstring(w), 1);
+        }
+
+        index->add("doc" + to_string(d), terms);
+    }
+
+    index->remove_document_from_all_records("doc3");
+
+    for (int q = 0; q < 500; ++q) {
+        queries.push_back({L"word" + std::to_wstring(q % 40), L"word" + std::to_wstring(q * 7 % 43), L"missing"});
+    }
+
+    auto serial = index->read_batch(queries);
+    auto parallel = index->read_batch(queries, &pool);
+
+    for (size_t q = 0; q < queries.size(); ++q) {
+        EXPECT_EQ(serial[q], index->read(queries[q]));
+        EXPECT_EQ(parallel[q], serial[q]);
+        EXPECT_NE(serial[q], "doc3");
+    }
+
+    EXPECT_EQ(index->read_batch({{L"missing"}}, &pool), vector<document>{""});
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
 
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -1,13 +1,17 @@
 #include <gtest/gtest.h>
 #include "server.h"
+#include "load_generator.h"
+#include "shard_coordinator.h"
 #include <filesystem>
-#include <iostream>
+#include <fstream>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
-using std::cout;
-using std::endl;
-
 class ServerTest : public ::testing::Test {
 protected:
     server* test_server;
@@ -33,240 +37,1093 @@ protected:
     }
 };
 
-TEST_F(ServerTest, WORD_FILES_250) {
-    type = WORD_FILES;
+TEST_F(ServerTest, READ_TEST_NEG) {
+    type = WORD_FILE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset/test/neg";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_files_index.json";
+    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
+    fs::path output_file = fs::temp_directory_path() / "word_file_index.json";
 
-    const auto duration = test_server->run(input_dir, output_file);
+    test_server->run(input_dir, output_file);
 
-    cout << "Duration (WORD_FILES_250): " << duration << "ms" << endl;
+    auto file1 = test_server->read("Mykyta Krainik");
+    auto file2 = test_server->read("'Northfork' is what is wrong with indie films");
+
+    EXPECT_EQ(file1, "/home/mykyta/uni/PC/inverted-index/data/dataset/test/neg/document1.txt");
+    EXPECT_EQ(file2, "/home/mykyta/uni/PC/inverted-index/data/dataset/test/neg/3001_1.txt");
 }
 
-TEST_F(ServerTest, WORD_FILE_250) {
+TEST_F(ServerTest, READ_TEST_POS) {
     type = WORD_FILE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset/test/neg";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_file_index.json";
+    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
+    fs::path output_file = fs::temp_directory_path() / "word_file_index.json";
+
+    test_server->run(input_dir, output_file);
 
-    const auto duration = test_server->run(input_dir, output_file);
+    auto file1 = test_server->read("King of the Underworld");
+    auto file2 = test_server->read(
+            "Radio City Music Hall The film's Theodore is just the \"Music Hall.\""
+    );
 
-    cout << "Duration (WORD_FILE_250): " << duration << "ms" << endl;
+    EXPECT_EQ(file1, "/home/mykyta/uni/PC/inverted-index/data/dataset/test/pos/3001_7.txt");
+    EXPECT_EQ(file2, "/home/mykyta/uni/PC/inverted-index/data/dataset/test/pos/3053_8.txt");
 }
 
-TEST_F(ServerTest, INDEX_250) {
-    type = INDEX;
+TEST_F(ServerTest, READ_TRAIN_NEG) {
+    type = WORD_FILE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset/test/neg";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/index.json";
+    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
+    fs::path output_file = fs::temp_directory_path() / "word_file_index.json";
 
-    const auto duration = test_server->run(input_dir, output_file);
+    test_server->run(input_dir, output_file);
 
-    cout << "Duration (INDEX_250): " << duration << "ms" << endl;
+    auto file1 = test_server->read("competitive world of step-dancing");
+    auto file2 = test_server->read(
+            "MST3K The Hands of Fate think twice about seeing this one"
+    );
+
+    EXPECT_EQ(file1, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/neg/3035_2.txt");
+    EXPECT_EQ(file2, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/neg/3081_2.txt");
 }
 
-TEST_F(ServerTest, WORD_FILES_500) {
-    type = WORD_FILES;
+TEST_F(ServerTest, READ_TRAIN_POS) {
+    type = WORD_FILE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset/test";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_files_index.json";
+    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
+    fs::path output_file = fs::temp_directory_path() / "word_file_index.json";
 
-    const auto duration = test_server->run(input_dir, output_file);
+    test_server->run(input_dir, output_file);
 
-    cout << "Duration (WORD_FILES_500): " << duration << "ms" << endl;
+    auto file1 = test_server->read(
+            "Demonicus a video game Horror and sword fight freaks"
+    );
+    auto file2 = test_server->read(
+            "Boston Tivo House for my intellectual-mystery-jackass Legal vendetta"
+    );
+
+    EXPECT_EQ(file1, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/pos/3047_7.txt");
+    EXPECT_EQ(file2, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/pos/3095_10.txt");
 }
 
-TEST_F(ServerTest, WORD_FILE_500) {
+TEST_F(ServerTest, READ_TRAIN_UNSUP) {
     type = WORD_FILE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset/test";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_file_index.json";
+    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
+    fs::path output_file = fs::temp_directory_path() / "word_file_index.json";
+
+    test_server->run(input_dir, output_file);
 
-    const auto duration = test_server->run(input_dir, output_file);
+    auto file1 = test_server->read(
+            "I would say for making a movie during the writer's strike low budget filmmakers"
+    );
+    auto file2 = test_server->read("supposed family killing each other Huckleberry Fin");
+    auto file3 = test_server->read("perfect movie projecting 'Desu'");
+    auto file4 = test_server->read("J.D Chakraverthy evokes much emotions");
 
-    cout << "Duration (WORD_FILE_500): " << duration << "ms" << endl;
+    EXPECT_EQ(file1, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/unsup/12008_0.txt");
+    EXPECT_EQ(file2, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/unsup/12022_0.txt");
+    EXPECT_EQ(file3, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/unsup/12037_0.txt");
+    EXPECT_EQ(file4, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/unsup/12039_0.txt");
 }
 
-TEST_F(ServerTest, INDEX_500) {
-    type = INDEX;
+TEST_F(ServerTest, SPLIT_LARGE_FILE) {
+    type = WORD_FILE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset/test";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/index.json";
+    fs::path input_dir = fs::temp_directory_path() / "split_large_file";
+    fs::path big_file = input_dir / "big.txt";
+    fs::path small_file = input_dir / "small.txt";
+    fs::path output_file = input_dir / "index.json";
+
+    fs::create_directories(input_dir);
+
+    {
+        std::ofstream big(big_file);
+        std::ofstream small(small_file);
+
+        for (int i = 0; i < 2000; ++i) {
+            big << "filler review text " << (i == 1000 ? "quokka " : "") << "\n";
+        }
 
-    const auto duration = test_server->run(input_dir, output_file);
+        big << "zanzibar";
+        small << "quokka";
+    }
+
+    test_server->set_split_size(1024);
+    test_server->run(input_dir, output_file);
+
+    EXPECT_EQ(test_server->read("quokka zanzibar"), big_file.string());
+    EXPECT_EQ(test_server->read("filler"), big_file.string());
 
-    cout << "Duration (INDEX_500): " << duration << "ms" << endl;
+    fs::remove_all(input_dir);
 }
 
-TEST_F(ServerTest, WORD_FILES_1000) {
-    type = WORD_FILES;
+TEST_F(ServerTest, FUZZY_READ) {
+    type = WORD_FILE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset/train";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_files_index.json";
+    fs::path input_dir = fs::temp_directory_path() / "fuzzy_read";
+    fs::path output_file = input_dir / "index.json";
+
+    fs::create_directories(input_dir);
 
-    const auto duration = test_server->run(input_dir, output_file);
+    std::ofstream(input_dir / "huck.txt") << "The Adventures of Huckleberry Finn";
+    std::ofstream(input_dir / "tom.txt") << "The Adventures of Tom Sawyer";
 
-    cout << "Duration (WORD_FILES_1000): " << duration << "ms" << endl;
+    test_server->set_fuzzy_distance(1);
+    test_server->run(input_dir, output_file);
+
+    EXPECT_EQ(test_server->read("Hucklebery"), (input_dir / "huck.txt").string());
+    EXPECT_EQ(test_server->read("Tom Sawyr"), (input_dir / "tom.txt").string());
+
+    test_server->set_fuzzy_distance(0);
+
+    EXPECT_EQ(test_server->read("Hucklebery"), "");
+
+    fs::remove_all(input_dir);
 }
 
-TEST_F(ServerTest, WORD_FILE_1000) {
+TEST_F(ServerTest, WILDCARD_READ) {
     type = WORD_FILE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset/train";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_file_index.json";
+    fs::path input_dir = fs::temp_directory_path() / "wildcard_read";
+    fs::path output_file = input_dir / "index.json";
+
+    fs::create_directories(input_dir);
 
-    const auto duration = test_server->run(input_dir, output_file);
+    std::ofstream(input_dir / "huck.txt") << "The Adventures of Huckleberry Finn";
+    std::ofstream(input_dir / "tom.txt") << "The Adventures of Tom Sawyer";
 
-    cout << "Duration (WORD_FILE_1000): " << duration << "ms" << endl;
+    test_server->run(input_dir, output_file);
+
+    EXPECT_EQ(test_server->read("Huckle*"), (input_dir / "huck.txt").string());
+    EXPECT_EQ(test_server->read("s?wyer"), (input_dir / "tom.txt").string());
+    EXPECT_EQ(test_server->read("zzz*"), "");
+
+    fs::remove_all(input_dir);
 }
 
-TEST_F(ServerTest, INDEX_1000) {
-    type = INDEX;
+TEST_F(ServerTest, MAP_REDUCE_MATCHES_WORD_FILE) {
+    fs::path input_dir = fs::temp_directory_path() / "map_reduce";
+    fs::path output_file = fs::temp_directory_path() / "map_reduce_index.json";
+    const vector<string> texts = {
+            "The Adventures of Huckleberry Finn",
+            "The Adventures of Tom Sawyer",
+            "Tom and Huck go rafting down the river, the river is wide",
+            "A film about rafting",
+    };
+
+    fs::create_directories(input_dir / "nested");
+
+    for (size_t i = 0; i < texts.size(); ++i) {
+        std::ofstream(input_dir / (i % 2 ? "nested" : "") / ("doc" + std::to_string(i) + ".txt")) << texts[i];
+    }
+
+    auto* expected_index = new inverted_index();
+    auto* expected_parser = new document_parser();
+    processing_type expected_type = WORD_FILE;
+
+    expected_parser->add_stop_words(stop_words_file);
+
+    server expected(new thread_pool(2), expected_index, expected_parser, expected_type);
+
+    type = MAP_REDUCE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset/train";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/index.json";
+    expected.run(input_dir, output_file);
+    test_server->run(input_dir, output_file);
+
+    for (const auto* w : {L"adventur", L"tom", L"river", L"raft", L"film"}) {
+        EXPECT_EQ(index->find(w), expected_index->find(w));
 
-    const auto duration = test_server->run(input_dir, output_file);
+        for (const auto& doc : expected_index->find(w)) {
+            EXPECT_EQ(index->term_frequency(w, doc), expected_index->term_frequency(w, doc));
+            EXPECT_EQ(index->document_length(doc), expected_index->document_length(doc));
+        }
+    }
 
-    cout << "Duration (INDEX_1000): " << duration << "ms" << endl;
+    EXPECT_EQ(index->term_frequency(L"river", (input_dir / "nested" / "doc1.txt").string()), 0);
+    EXPECT_EQ(index->term_frequency(L"river", (input_dir / "doc2.txt").string()), 2);
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
 }
 
-TEST_F(ServerTest, WORD_FILES_2000) {
+TEST_F(ServerTest, PIPELINE_MATCHES_WORD_FILE) {
+    fs::path input_dir = fs::temp_directory_path() / "pipeline";
+    fs::path output_file = fs::temp_directory_path() / "pipeline_index.json";
+    const int files_num = 200;
+
+    fs::create_directories(input_dir / "nested");
+
+    for (int i = 0; i < files_num; ++i) {
+        std::ofstream(input_dir / (i % 3 ? "" : "nested") / ("doc" + std::to_string(i) + ".txt"))
+                << "Tom and Huck go rafting down the river number " << i % 7 << " the river is wide";
+    }
+
+    auto* expected_index = new inverted_index();
+    auto* expected_parser = new document_parser();
+    processing_type expected_type = WORD_FILE;
+
+    expected_parser->add_stop_words(stop_words_file);
+
+    server expected(new thread_pool(2), expected_index, expected_parser, expected_type);
+
+    type = PIPELINE;
+    test_server = new server(pool, index, parser, type);
+    test_server->set_pipeline_config({2, 3, 2, 4});
+
+    expected.run(input_dir, output_file);
+    test_server->run(input_dir, output_file);
+
+    for (const auto* w : {L"tom", L"huck", L"river", L"raft", L"wide"}) {
+        EXPECT_EQ(index->find(w), expected_index->find(w));
+
+        for (const auto& doc : expected_index->find(w)) {
+            EXPECT_EQ(index->term_frequency(w, doc), expected_index->term_frequency(w, doc));
+            EXPECT_EQ(index->document_length(doc), expected_index->document_length(doc));
+        }
+    }
+
+    const auto& metrics = test_server->pipeline_metrics();
+
+    ASSERT_EQ(metrics.size(), 3);
+
+    for (const auto& stage : metrics) {
+        EXPECT_EQ(stage.items, files_num);
+        EXPECT_LE(stage.max_queue_depth, 4);
+    }
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+}
+
+TEST(DirectoryCrawlerTest, CrawlsNestedTree) {
+    fs::path root = fs::temp_directory_path() / "directory_crawler";
+    auto* crawl_pool = new thread_pool(3);
+
+    fs::remove_all(root);
+    fs::create_directories(root / "a" / "b" / "c");
+    fs::create_directories(root / "empty");
+
+    std::ofstream(root / "top.txt") << "12345";
+    std::ofstream(root / "a" / "one.txt") << "1";
+    std::ofstream(root / "a" / "b" / "c" / "deep.txt") << "1234567890";
+    fs::create_symlink(root / "top.txt", root / "a" / "link.txt");
+
+    directory_crawler crawler(crawl_pool);
+    auto files = crawler.crawl(root);
+
+    ASSERT_EQ(files.size(), 4);
+    EXPECT_EQ(files[0].path, root / "a" / "b" / "c" / "deep.txt");
+    EXPECT_EQ(files[0].size, 10);
+    EXPECT_EQ(files[1].path, root / "a" / "link.txt");
+    EXPECT_EQ(files[1].size, 5);
+    EXPECT_EQ(files[2].path, root / "a" / "one.txt");
+    EXPECT_EQ(files[3].path, root / "top.txt");
+    EXPECT_THROW(crawler.crawl(root / "missing"), std::runtime_error);
+
+    delete crawl_pool;
+    fs::remove_all(root);
+}
+
+TEST(DirectoryCrawlerTest, PartitionBalancesBytes) {
+    vector<crawled_file> files;
+    uint64_t total = 0;
+
+    // one huge directory of small files next to a few big ones
+    for (int i = 0; i < 10000; ++i) {
+        files.push_back({"small" + std::to_string(i), static_cast<uint64_t>(500 + i % 700)});
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        files.push_back({"big" + std::to_string(i), 400000});
+    }
+
+    for (const auto& file : files) {
+        total += file.size;
+    }
+
+    auto units = directory_crawler::partition(files, 16);
+    uint64_t assigned = 0;
+    size_t files_num = 0;
+
+    ASSERT_EQ(units.size(), 16);
+
+    for (const auto& unit : units) {
+        assigned += unit.bytes;
+        files_num += unit.files.size();
+
+        EXPECT_LE(unit.bytes, total / 16 + 1200);
+    }
+
+    EXPECT_EQ(assigned, total);
+    EXPECT_EQ(files_num, files.size());
+    EXPECT_EQ(directory_crawler::partition({}, 4).size(), 1);
+}
+
+TEST_F(ServerTest, SKEWED_TREE) {
     type = WORD_FILES;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_files_index.json";
+    fs::path input_dir = fs::temp_directory_path() / "skewed_tree";
+    fs::path output_file = fs::temp_directory_path() / "skewed_tree_index.json";
 
-    const auto duration = test_server->run(input_dir, output_file);
+    fs::create_directories(input_dir / "unsup");
+    fs::create_directories(input_dir / "neg");
 
-    cout << "Duration (WORD_FILES_2000): " << duration << "ms" << endl;
+    for (int i = 0; i < 500; ++i) {
+        std::ofstream(input_dir / "unsup" / ("review" + std::to_string(i) + ".txt")) << "unsupervised review";
+    }
+
+    std::ofstream(input_dir / "neg" / "review.txt") << "negative quokka";
+
+    test_server->run(input_dir, output_file);
+
+    EXPECT_EQ(index->find(L"unsupervis").size(), 500);
+    EXPECT_EQ(test_server->read("quokka"), (input_dir / "neg" / "review.txt").string());
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
 }
 
-TEST_F(ServerTest, WORD_FILE_2000) {
+TEST_F(ServerTest, INCREMENTAL) {
+    type = WORD_FILES;
+    test_server = new server(pool, index, parser, type);
+
+    fs::path input_dir = fs::temp_directory_path() / "incremental_tree";
+    fs::path output_file = fs::temp_directory_path() / "incremental_index.json";
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+    fs::remove(server::manifest_path(output_file));
+    fs::remove(server::snapshot_path(output_file));
+    fs::create_directories(input_dir);
+
+    std::ofstream(input_dir / "kept.txt") << "quokka quokka quokka";
+    std::ofstream(input_dir / "touched.txt") << "wombat";
+    std::ofstream(input_dir / "changed.txt") << "platypus";
+    std::ofstream(input_dir / "deleted.txt") << "echidna";
+
+    test_server->run_incremental(input_dir, output_file);
+
+    EXPECT_EQ(test_server->last_delta().added, 4);
+    EXPECT_TRUE(fs::exists(server::manifest_path(output_file)));
+
+    auto later = fs::last_write_time(input_dir / "kept.txt") + std::chrono::seconds(10);
+
+    fs::last_write_time(input_dir / "touched.txt", later);
+    std::ofstream(input_dir / "changed.txt") << "numbat";
+    fs::last_write_time(input_dir / "changed.txt", later);
+    fs::remove(input_dir / "deleted.txt");
+    std::ofstream(input_dir / "added.txt") << "dingo";
+
+    // a fresh server picks the index and the manifest up from disk
+    auto* next_parser = new document_parser();
+
+    next_parser->add_stop_words(stop_words_file);
+
+    auto* next_index = new inverted_index();
+    server next_server(new thread_pool(4), next_index, next_parser, type);
+
+    next_server.run_incremental(input_dir, output_file);
+
+    const auto& delta = next_server.last_delta();
+
+    EXPECT_EQ(delta.added, 1);
+    EXPECT_EQ(delta.changed, 1);
+    EXPECT_EQ(delta.removed, 1);
+    EXPECT_EQ(delta.unchanged, 2);
+
+    EXPECT_EQ(next_server.read("quokka"), (input_dir / "kept.txt").string());
+    EXPECT_EQ(next_server.read("wombat"), (input_dir / "touched.txt").string());
+    EXPECT_EQ(next_server.read("numbat"), (input_dir / "changed.txt").string());
+    EXPECT_EQ(next_server.read("dingo"), (input_dir / "added.txt").string());
+    EXPECT_EQ(next_server.read("platypus"), "");
+    EXPECT_EQ(next_server.read("echidna"), "");
+
+    // BM25 inputs of the files that were not parsed again survive the reload
+    EXPECT_EQ(next_index->term_frequency(L"quokka", (input_dir / "kept.txt").string()), 3);
+    EXPECT_EQ(next_index->document_length((input_dir / "kept.txt").string()), 3);
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+    fs::remove(server::manifest_path(output_file));
+    fs::remove(server::snapshot_path(output_file));
+}
+
+TEST_F(ServerTest, WATCH) {
     type = WORD_FILE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_file_index.json";
+    fs::path input_dir = fs::temp_directory_path() / "watched_tree";
+
+    fs::remove_all(input_dir);
+    fs::create_directories(input_dir);
+
+    test_server->watch(input_dir, {50, 1024});
+
+    auto wait_for = [this](const string& query, const string& expected) {
+        for (int i = 0; i < 100 && test_server->read(query) != expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        return test_server->read(query);
+    };
+
+    std::ofstream(input_dir / "quokka.txt") << "quokka";
+
+    EXPECT_EQ(wait_for("quokka", (input_dir / "quokka.txt").string()), (input_dir / "quokka.txt").string());
+
+    fs::create_directories(input_dir / "nested");
+    std::ofstream(input_dir / "nested" / "wombat.txt") << "wombat";
+
+    EXPECT_EQ(wait_for("wombat", (input_dir / "nested" / "wombat.txt").string()),
+              (input_dir / "nested" / "wombat.txt").string());
+
+    fs::remove(input_dir / "quokka.txt");
+
+    EXPECT_EQ(wait_for("quokka", ""), "");
+
+    test_server->stop_watch();
+
+    auto stats = test_server->watch_stats();
+
+    EXPECT_GE(stats.documents_indexed, 2);
+    EXPECT_EQ(stats.documents_removed, 1);
+    EXPECT_GT(stats.max_freshness_ms, 0);
+
+    fs::remove_all(input_dir);
+}
+
+TEST_F(ServerTest, WAL_RECOVERY) {
+    fs::path input_dir = fs::temp_directory_path() / "wal_tree";
+    fs::path wal_dir = fs::temp_directory_path() / "wal_state";
+    fs::path output_file = fs::temp_directory_path() / "wal_index.json";
+
+    fs::remove_all(input_dir);
+    fs::create_directories(input_dir);
+
+    std::ofstream(input_dir / "quokka.txt") << "quokka quokka echidna";
+    std::ofstream(input_dir / "wombat.txt") << "wombat";
+
+    string quokka_doc = (input_dir / "quokka.txt").string();
+
+    // the bulk modes log their documents in batches instead of one by one;
+    // replay adds every logged document with its counts, the live index must
+    // hold the same counts or a recovered index differs from an uninterrupted one
+    for (auto run_type : {WORD_FILE, WORD_FILES, INDEX, MAP_REDUCE, PIPELINE}) {
+        fs::remove_all(wal_dir);
+
+        auto* run_parser = new document_parser();
+        auto* run_index = new inverted_index();
+
+        run_parser->add_stop_words(stop_words_file);
+
+        {
+            server run_server(new thread_pool(4), run_index, run_parser, run_type);
 
-    const auto duration = test_server->run(input_dir, output_file);
+            run_server.enable_wal(wal_dir);
+            run_server.run(input_dir, output_file);
 
-    cout << "Duration (WORD_FILE_2000): " << duration << "ms" << endl;
+            EXPECT_EQ(run_index->term_frequency(L"quokka", quokka_doc), 2) << run_type;
+            EXPECT_EQ(run_index->document_length(quokka_doc), 3) << run_type;
+        }
+
+        auto* next_parser = new document_parser();
+
+        next_parser->add_stop_words(stop_words_file);
+
+        auto* next_index = new inverted_index();
+        server next_server(new thread_pool(4), next_index, next_parser, run_type);
+
+        next_server.enable_wal(wal_dir);
+
+        EXPECT_EQ(next_server.read("quokka"), quokka_doc) << run_type;
+        EXPECT_EQ(next_server.read("wombat"), (input_dir / "wombat.txt").string()) << run_type;
+        EXPECT_EQ(next_index->term_frequency(L"quokka", quokka_doc), 2) << run_type;
+        EXPECT_EQ(next_index->document_length(quokka_doc), 3) << run_type;
+    }
+
+    fs::remove_all(input_dir);
+    fs::remove_all(wal_dir);
+    fs::remove(output_file);
 }
 
-TEST_F(ServerTest, INDEX_2000) {
-    type = INDEX;
+TEST_F(ServerTest, RESUME) {
+    type = WORD_FILES;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/index.json";
+    fs::path input_dir = fs::temp_directory_path() / "resume_tree";
+    fs::path checkpoint_dir = fs::temp_directory_path() / "resume_checkpoints";
+    fs::path output_file = fs::temp_directory_path() / "resume_index.json";
+
+    fs::remove_all(input_dir);
+    fs::remove_all(checkpoint_dir);
+    fs::create_directories(input_dir);
+
+    for (int i = 0; i < 20; ++i) {
+        std::ofstream(input_dir / ("first" + std::to_string(i) + ".txt")) << "quokka";
+    }
+
+    test_server->set_checkpoints(checkpoint_dir, 10);
 
-    const auto duration = test_server->run(input_dir, output_file);
+    // left by an earlier run over another tree, a fresh run must not pick it up
+    std::ofstream(checkpoint_dir / "checkpoint-9.progress") << "stale";
 
-    cout << "Duration (INDEX_2000): " << duration << "ms" << endl;
+    test_server->run(input_dir, output_file);
+
+    // one checkpoint per round, each with only the files of its round
+    EXPECT_TRUE(fs::exists(checkpoint_dir / "checkpoint-1.progress"));
+    EXPECT_TRUE(fs::exists(checkpoint_dir / "checkpoint-2.progress"));
+    EXPECT_FALSE(fs::exists(checkpoint_dir / "checkpoint-9.progress"));
+    EXPECT_LT(fs::file_size(checkpoint_dir / "checkpoint-2.progress"),
+              fs::file_size(checkpoint_dir / "checkpoint-1.progress") * 3 / 2);
+
+    // the run is cut short here, the files below were never reached
+    for (int i = 0; i < 10; ++i) {
+        std::ofstream(input_dir / ("second" + std::to_string(i) + ".txt")) << "wombat";
+    }
+
+    auto* next_parser = new document_parser();
+
+    next_parser->add_stop_words(stop_words_file);
+
+    auto* next_index = new inverted_index();
+    server next_server(new thread_pool(4), next_index, next_parser, type);
+
+    next_server.set_checkpoints(checkpoint_dir, 10);
+    next_server.resume(input_dir, output_file);
+
+    EXPECT_EQ(next_server.skipped_files(), 20);
+    EXPECT_EQ(next_index->find(L"quokka").size(), 20);
+    EXPECT_EQ(next_index->find(L"wombat").size(), 10);
+    EXPECT_TRUE(fs::exists(checkpoint_dir / "checkpoint-3.progress"));
+
+    fs::remove_all(input_dir);
+    fs::remove_all(checkpoint_dir);
+    fs::remove(output_file);
 }
 
-TEST_F(ServerTest, READ_TEST_NEG) {
+TEST_F(ServerTest, RESUME_MID_ROUND) {
     type = WORD_FILE;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_file_index.json";
+    fs::path input_dir = fs::temp_directory_path() / "resume_mid_round_tree";
+    fs::path checkpoint_dir = fs::temp_directory_path() / "resume_mid_round_checkpoints";
+    fs::path output_file = fs::temp_directory_path() / "resume_mid_round_index.json";
 
+    fs::remove_all(input_dir);
+    fs::remove_all(checkpoint_dir);
+    fs::create_directories(input_dir);
+
+    for (int i = 0; i < 20; ++i) {
+        std::ofstream(input_dir / ("review" + std::to_string(i) + ".txt")) << "quokka quokka wombat";
+    }
+
+    test_server->set_checkpoints(checkpoint_dir, 10);
     test_server->run(input_dir, output_file);
 
-    auto file1 = test_server->read("Mykyta Krainik");
-    auto file2 = test_server->read("'Northfork' is what is wrong with indie films");
+    // the second round reached the log, the crash came before its checkpoint
+    fs::remove(checkpoint_dir / "checkpoint-2.progress");
 
-    EXPECT_EQ(file1, "/home/mykyta/uni/PC/inverted-index/data/dataset/test/neg/document1.txt");
-    EXPECT_EQ(file2, "/home/mykyta/uni/PC/inverted-index/data/dataset/test/neg/3001_1.txt");
+    auto* next_parser = new document_parser();
+
+    next_parser->add_stop_words(stop_words_file);
+
+    auto* next_index = new inverted_index();
+    server next_server(new thread_pool(4), next_index, next_parser, type);
+
+    next_server.set_checkpoints(checkpoint_dir, 10);
+    next_server.resume(input_dir, output_file);
+
+    EXPECT_EQ(next_server.skipped_files(), 10);
+    EXPECT_EQ(next_index->find(L"quokka").size(), 20);
+
+    for (int i = 0; i < 20; ++i) {
+        string doc = (input_dir / ("review" + std::to_string(i) + ".txt")).string();
+
+        EXPECT_EQ(next_index->term_frequency(L"quokka", doc), 2) << doc;
+        EXPECT_EQ(next_index->document_length(doc), 3) << doc;
+    }
+
+    fs::remove_all(input_dir);
+    fs::remove_all(checkpoint_dir);
+    fs::remove(output_file);
 }
 
-TEST_F(ServerTest, READ_TEST_POS) {
-    type = WORD_FILE;
+// Sends raw bytes and reads until the server closes the connection, half_close
+// shuts down the sending side right after the request.
+static string http_exchange(uint16_t port, const string& request, bool half_close = false) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    string response;
+    char chunk[4096];
+    ssize_t received;
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+
+        if (half_close) {
+            shutdown(fd, SHUT_WR);
+        }
+
+        while ((received = recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+            response.append(chunk, received);
+        }
+    }
+
+    close(fd);
+
+    return response;
+}
+
+TEST_F(ServerTest, HTTP_ENDPOINT) {
+    type = WORD_FILES;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_file_index.json";
+    fs::path input_dir = fs::temp_directory_path() / "http_tree";
+    fs::path output_file = fs::temp_directory_path() / "http_index.json";
+
+    fs::remove_all(input_dir);
+    fs::create_directories(input_dir);
+
+    std::ofstream(input_dir / "quokka.txt") << "quokka";
+    std::ofstream(input_dir / "wombat.txt") << "wombat";
 
     test_server->run(input_dir, output_file);
+    test_server->serve();
 
-    auto file1 = test_server->read("King of the Underworld");
-    auto file2 = test_server->read(
-            "Radio City Music Hall The film's Theodore is just the \"Music Hall.\""
-    );
+    uint16_t port = test_server->serving_port();
 
-    EXPECT_EQ(file1, "/home/mykyta/uni/PC/inverted-index/data/dataset/test/pos/3001_7.txt");
-    EXPECT_EQ(file2, "/home/mykyta/uni/PC/inverted-index/data/dataset/test/pos/3053_8.txt");
+    ASSERT_GT(port, 0);
+
+    auto health = http_exchange(port, "GET /health HTTP/1.1\r\nConnection: close\r\n\r\n");
+
+    EXPECT_EQ(health.rfind("HTTP/1.1 200", 0), 0);
+    EXPECT_NE(health.find(R"({"status":"ok"})"), string::npos);
+
+    auto missing = http_exchange(port, "GET /nowhere HTTP/1.1\r\nConnection: close\r\n\r\n");
+
+    EXPECT_EQ(missing.rfind("HTTP/1.1 404", 0), 0);
+
+    // three pipelined requests on one connection come back in the order they were sent
+    auto pipelined = http_exchange(port,
+            "GET /search?q=wombat HTTP/1.1\r\n\r\n"
+            "GET /search?q=quokka%20wombat HTTP/1.1\r\n\r\n"
+            "GET /search?q=quokka HTTP/1.1\r\nConnection: close\r\n\r\n");
+
+    auto wombat = pipelined.find(R"("query":"wombat")");
+    auto both = pipelined.find(R"("query":"quokka wombat")");
+    auto quokka = pipelined.find(R"("query":"quokka")");
+
+    ASSERT_NE(wombat, string::npos);
+    ASSERT_NE(both, string::npos);
+    ASSERT_NE(quokka, string::npos);
+    EXPECT_LT(wombat, both);
+    EXPECT_LT(both, quokka);
+    EXPECT_NE(pipelined.find((input_dir / "wombat.txt").string()), string::npos);
+    EXPECT_NE(pipelined.find((input_dir / "quokka.txt").string()), string::npos);
+
+    // a client that sends its requests and shuts down its side still gets every answer
+    auto half_closed = http_exchange(port,
+            "GET /search?q=wombat HTTP/1.1\r\n\r\n"
+            "GET /search?q=quokka HTTP/1.1\r\n\r\n", true);
+
+    EXPECT_NE(half_closed.find(R"("query":"wombat")"), string::npos);
+    EXPECT_NE(half_closed.find(R"("query":"quokka")"), string::npos);
+
+    test_server->stop_serving();
+
+    EXPECT_EQ(test_server->serving_port(), 0);
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
 }
 
-TEST_F(ServerTest, READ_TRAIN_NEG) {
-    type = WORD_FILE;
+TEST_F(ServerTest, HTTP_REQUEST_LIMIT) {
+    type = WORD_FILES;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_file_index.json";
+    fs::path input_dir = fs::temp_directory_path() / "http_limit_tree";
+    fs::path output_file = fs::temp_directory_path() / "http_limit_index.json";
+    size_t flood_size = 64 * 1024 * 1024;
+    size_t sent = 0;
+
+    fs::remove_all(input_dir);
+    fs::create_directories(input_dir);
+
+    std::ofstream(input_dir / "quokka.txt") << "quokka";
 
     test_server->run(input_dir, output_file);
+    test_server->serve();
 
-    auto file1 = test_server->read("competitive world of step-dancing");
-    auto file2 = test_server->read(
-            "MST3K The Hands of Fate think twice about seeing this one"
-    );
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    string response;
+    char chunk[4096];
+    ssize_t received;
 
-    EXPECT_EQ(file1, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/neg/3035_2.txt");
-    EXPECT_EQ(file2, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/neg/3081_2.txt");
+    address.sin_family = AF_INET;
+    address.sin_port = htons(test_server->serving_port());
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+
+    // a header that never ends, sent without a pause for the server to see EAGAIN
+    std::thread flood([fd, flood_size, &sent] {
+        string header = "GET /search?q=quokka HTTP/1.1\r\nX-Padding: " + string(1024 * 1024, 'a');
+
+        while (sent < flood_size) {
+            ssize_t written = send(fd, header.data(), header.size(), MSG_NOSIGNAL);
+
+            if (written <= 0) {
+                return;
+            }
+
+            sent += static_cast<size_t>(written);
+        }
+    });
+
+    while ((received = recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+        response.append(chunk, received);
+    }
+
+    shutdown(fd, SHUT_RDWR);
+    flood.join();
+    close(fd);
+
+    EXPECT_EQ(response.rfind("HTTP/1.1 413", 0), 0);
+    // the connection was dropped long before the whole flood was buffered
+    EXPECT_LT(sent, flood_size);
+
+    test_server->stop_serving();
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
 }
 
-TEST_F(ServerTest, READ_TRAIN_POS) {
-    type = WORD_FILE;
+TEST_F(ServerTest, HTTP_LOAD) {
+    type = WORD_FILES;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_file_index.json";
+    fs::path input_dir = fs::temp_directory_path() / "http_load_tree";
+    fs::path output_file = fs::temp_directory_path() / "http_load_index.json";
+    vector<string> words = {"quokka", "wombat", "dingo", "numbat", "bilby", "possum", "echidna", "wallaby"};
+    vector<string> targets;
+
+    fs::remove_all(input_dir);
+    fs::create_directories(input_dir);
+
+    for (int i = 0; i < 200; ++i) {
+        std::ofstream(input_dir / ("doc" + std::to_string(i) + ".txt"))
+                << words[i % words.size()] << " " << words[(i * 3 + 1) % words.size()];
+    }
+
+    for (const auto& w : words) {
+        targets.push_back("/search?q=" + w);
+    }
 
     test_server->run(input_dir, output_file);
+    test_server->serve();
 
-    auto file1 = test_server->read(
-            "Demonicus a video game Horror and sword fight freaks"
-    );
-    auto file2 = test_server->read(
-            "Boston Tivo House for my intellectual-mystery-jackass Legal vendetta"
-    );
+    load_generator generator("127.0.0.1", test_server->serving_port());
 
-    EXPECT_EQ(file1, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/pos/3047_7.txt");
-    EXPECT_EQ(file2, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/pos/3095_10.txt");
+    for (unsigned int connections : {1u, 4u, 16u, 64u}) {
+        auto report = generator.run(targets, connections, 512 / connections);
+
+        EXPECT_EQ(report.errors, 0);
+        EXPECT_EQ(report.requests, 512);
+    }
+
+    auto pipelined = generator.run(targets, 4, 128, 8);
+
+    EXPECT_EQ(pipelined.errors, 0);
+    EXPECT_EQ(pipelined.requests, 512);
+
+    test_server->stop_serving();
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
 }
 
-TEST_F(ServerTest, READ_TRAIN_UNSUP) {
-    type = WORD_FILE;
+TEST_F(ServerTest, READ_BATCH) {
+    type = WORD_FILES;
     test_server = new server(pool, index, parser, type);
 
-    fs::path input_dir = "/home/mykyta/uni/PC/inverted-index/data/dataset";
-    fs::path output_file = "/home/mykyta/uni/PC/inverted-index/data/word_file_index.json";
+    fs::path input_dir = fs::temp_directory_path() / "read_batch_tree";
+    fs::path output_file = fs::temp_directory_path() / "read_batch_index.json";
+    vector<string> words = {"quokka", "wombat", "dingo", "numbat", "bilby", "possum", "echidna", "wallaby",
+                            "platypus", "kookaburra", "cassowary", "emu"};
+    vector<string> queries;
+
+    fs::remove_all(input_dir);
+    fs::create_directories(input_dir);
+
+    for (size_t i = 0; i < 2000; ++i) {
+        std::ofstream(input_dir / ("doc" + std::to_string(i) + ".txt"))
+                << words[i % words.size()] << " " << words[i * 5 % words.size()] << " " << words[i * 7 % 11];
+    }
+
+    for (size_t i = 0; i < 5000; ++i) {
+        queries.push_back("the " + words[i % words.size()] + " and the " + words[i * 3 % 11] + " of a " + words[i % 7]);
+    }
 
     test_server->run(input_dir, output_file);
 
-    auto file1 = test_server->read(
-            "I would say for making a movie during the writer's strike low budget filmmakers"
-    );
-    auto file2 = test_server->read("supposed family killing each other Huckleberry Fin");
-    auto file3 = test_server->read("perfect movie projecting 'Desu'");
-    auto file4 = test_server->read("J.D Chakraverthy evokes much emotions");
+    vector<document> looped;
 
-    EXPECT_EQ(file1, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/unsup/12008_0.txt");
-    EXPECT_EQ(file2, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/unsup/12022_0.txt");
-    EXPECT_EQ(file3, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/unsup/12037_0.txt");
-    EXPECT_EQ(file4, "/home/mykyta/uni/PC/inverted-index/data/dataset/train/unsup/12039_0.txt");
+    for (const auto& query : queries) {
+        looped.push_back(test_server->read(query));
+    }
+
+    auto batched = test_server->read_batch(queries);
+
+    EXPECT_EQ(batched, looped);
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+}
+
+TEST(QueryCacheTest, AdmitsKeysHotterThanTheVictim) {
+    query_cache cache(16);
+    auto hot = query_cache::make_key({L"wombat", L"quokka"});
+
+    EXPECT_EQ(hot, query_cache::make_key({L"quokka", L"wombat"}));
+    EXPECT_FALSE(cache.find(hot, 0));
+
+    cache.insert(hot, 0, "hot.txt");
+
+    EXPECT_EQ(cache.find(hot, 0), "hot.txt");
+    EXPECT_FALSE(cache.find(hot, 1));
+
+    // 16 shards of one entry each, a cold key never displaces the hot one from its shard
+    cache.insert(hot, 1, "hot.txt");
+
+    for (int i = 0; i < 5; ++i) {
+        cache.find(hot, 1);
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        auto cold = query_cache::make_key({L"cold" + std::to_wstring(i)});
+
+        if (!cache.find(cold, 1)) {
+            cache.insert(cold, 1, "cold.txt");
+        }
+    }
+
+    EXPECT_GT(cache.stats().rejected, 0);
+    EXPECT_EQ(cache.find(hot, 1), "hot.txt");
+}
+
+TEST_F(ServerTest, QUERY_CACHE) {
+    type = WORD_FILES;
+    test_server = new server(pool, index, parser, type);
+
+    fs::path input_dir = fs::temp_directory_path() / "query_cache_tree";
+    fs::path output_file = fs::temp_directory_path() / "query_cache_index.json";
+
+    fs::remove_all(input_dir);
+    fs::create_directories(input_dir);
+
+    std::ofstream(input_dir / "both.txt") << "quokka wombat";
+    std::ofstream(input_dir / "quokka.txt") << "quokka";
+
+    test_server->run(input_dir, output_file);
+    test_server->enable_query_cache(1024);
+
+    auto both = (input_dir / "both.txt").string();
+
+    EXPECT_EQ(test_server->read("quokka and wombat"), both);
+    // same terms, different words around them
+    EXPECT_EQ(test_server->read("the wombat with a quokka"), both);
+    EXPECT_EQ(test_server->cache_stats().hits, 1);
+
+    index->remove_document_from_all_records(both);
+
+    EXPECT_EQ(test_server->read("quokka and wombat"), (input_dir / "quokka.txt").string());
+
+    auto stats = test_server->cache_stats();
+
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 2);
+    EXPECT_EQ(stats.stale, 1);
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+}
+
+TEST(ShardCoordinatorTest, RankingDoesNotDependOnShardCount) {
+    fs::path input_dir = fs::temp_directory_path() / "sharded_tree";
+    vector<string> words = {"quokka", "wombat", "dingo", "numbat", "bilby", "possum", "echidna", "wallaby",
+                            "platypus", "kookaburra", "cassowary", "emu", "galah", "dugong"};
+    vector<string> queries;
+
+    fs::remove_all(input_dir);
+    fs::create_directories(input_dir);
+
+    for (size_t i = 0; i < 2000; ++i) {
+        std::ofstream(input_dir / ("doc" + std::to_string(i) + ".txt"))
+                << words[i % words.size()] << " " << words[i * 5 % 13] << " " << words[i * 7 % 11] << " "
+                << words[i * 3 % 9];
+    }
+
+    for (size_t i = 0; i < 2000; ++i) {
+        queries.push_back(words[i % words.size()] + " " + words[i * 3 % 13] + " " + words[i % 5]);
+    }
+
+    vector<vector<scored_document>> expected;
+    thread_pool pool(2);
+
+    for (size_t shards : {1, 2, 4}) {
+        shard_config config;
+
+        config.shards = shards;
+
+        shard_coordinator coordinator(config);
+
+        EXPECT_EQ(coordinator.index_dir(input_dir, &pool), 2000);
+
+        auto results = coordinator.search_batch(queries, 10);
+
+        ASSERT_EQ(results.size(), queries.size());
+        EXPECT_EQ(coordinator.search(queries[7], 10), results[7]);
+
+        if (expected.empty()) {
+            expected = results;
+        } else {
+            EXPECT_EQ(results, expected);
+        }
+    }
+
+    // the first query is "quokka" three times, one term
+    ASSERT_EQ(expected[0].size(), 10);
+    EXPECT_EQ(expected[0][0].score, 1);
+    EXPECT_TRUE(std::is_sorted(expected[1].begin(), expected[1].end(), shard_worker::ranks_before));
+
+    fs::remove_all(input_dir);
+}
+
+TEST_F(ServerTest, SHARDED_READ) {
+    type = WORD_FILES;
+    test_server = new server(pool, index, parser, type);
+
+    fs::path input_dir = fs::temp_directory_path() / "sharded_read_tree";
+    fs::path output_file = fs::temp_directory_path() / "sharded_read_index.json";
+    shard_config config;
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+    fs::create_directories(input_dir / "nested");
+
+    std::ofstream(input_dir / "quokka.txt") << "quokka";
+    std::ofstream(input_dir / "nested" / "wombat.txt") << "wombat and dingo";
+    std::ofstream(input_dir / "dingo.txt") << "dingo";
+
+    config.shards = 2;
+    test_server->enable_shards(config);
+
+    EXPECT_THROW(test_server->run(input_dir, output_file), std::invalid_argument);
+
+    test_server->run(input_dir, {});
+
+    EXPECT_TRUE(index->find(L"quokka").empty());
+    EXPECT_FALSE(fs::exists(output_file));
+    EXPECT_EQ(test_server->read("quokka"), (input_dir / "quokka.txt").string());
+    EXPECT_EQ(test_server->read("wombat dingo"), (input_dir / "nested" / "wombat.txt").string());
+    EXPECT_EQ(test_server->read("numbat"), "");
+    EXPECT_EQ(test_server->read_batch({"dingo wombat", "quokka"}),
+              vector<document>({(input_dir / "nested" / "wombat.txt").string(), (input_dir / "quokka.txt").string()}));
+
+    fs::remove_all(input_dir);
+}
+
+TEST_F(ServerTest, SEGMENTED_READ) {
+    type = WORD_FILES;
+    test_server = new server(pool, index, parser, type);
+
+    fs::path input_dir = fs::temp_directory_path() / "segmented_read_tree";
+    fs::path output_file = fs::temp_directory_path() / "segmented_read_index.json";
+    segment_config config;
+
+    fs::remove_all(input_dir);
+    fs::remove(output_file);
+    fs::create_directories(input_dir);
+
+    for (int i = 0; i < 40; ++i) {
+        std::ofstream(input_dir / ("review" + std::to_string(i) + ".txt")) << "unsupervised review " << i;
+    }
+
+    std::ofstream(input_dir / "quokka.txt") << "quokka and wombat";
+    std::ofstream(input_dir / "wombat.txt") << "wombat";
+
+    config.flush_postings = 16;
+    config.merge_factor = 2;
+    test_server->enable_segments(config);
+
+    EXPECT_THROW(test_server->run(input_dir, output_file), std::invalid_argument);
+
+    test_server->run(input_dir, {});
+
+    EXPECT_TRUE(index->find(L"quokka").empty());
+    EXPECT_FALSE(fs::exists(output_file));
+    EXPECT_GT(test_server->segments_stats().segments, 0);
+    EXPECT_EQ(test_server->segments_stats().buffered_postings, 0);
+    EXPECT_EQ(test_server->read("quokka wombat"), (input_dir / "quokka.txt").string());
+    EXPECT_EQ(test_server->read("numbat"), "");
+    EXPECT_EQ(test_server->read_batch({"wombat quokka", "numbat"}),
+              vector<document>({(input_dir / "quokka.txt").string(), ""}));
+
+    fs::remove_all(input_dir);
+}
+
+TEST_F(ServerTest, SEGMENTED_READ_FROM_DISK) {
+    type = WORD_FILES;
+    test_server = new server(pool, index, parser, type);
+
+    fs::path input_dir = fs::temp_directory_path() / "mapped_read_tree";
+    fs::path segment_dir = fs::temp_directory_path() / "mapped_read_segments";
+    segment_config config;
+
+    fs::remove_all(input_dir);
+    fs::remove_all(segment_dir);
+    fs::create_directories(input_dir);
+
+    for (int i = 0; i < 40; ++i) {
+        std::ofstream(input_dir / ("review" + std::to_string(i) + ".txt")) << "unsupervised review " << i;
+    }
+
+    std::ofstream(input_dir / "quokka.txt") << "quokka and wombat";
+
+    config.flush_postings = 16;
+    config.directory = segment_dir;
+    test_server->enable_segments(config);
+    test_server->run(input_dir, {});
+
+    EXPECT_EQ(test_server->read("quokka wombat"), (input_dir / "quokka.txt").string());
+
+    auto first = test_server->postings_cache_stats();
+
+    EXPECT_GT(first.misses, 0);
+
+    // the same terms again are served decoded from memory
+    EXPECT_EQ(test_server->read("quokka wombat"), (input_dir / "quokka.txt").string());
+
+    auto second = test_server->postings_cache_stats();
+
+    EXPECT_EQ(second.misses, first.misses);
+    EXPECT_GT(second.hits, first.hits);
+
+    fs::remove_all(input_dir);
+    fs::remove_all(segment_dir);
 }
@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <set>
+#include <random>
+#include "term_dictionary.h"
+#include "trigram_index.h"
+#include "front_coded_dictionary.h"
+#include "document_parser.h"
+#include "inverted_index.h"
+
+using std::thread;
+using std::to_wstring;
+using std::wstring;
+
+class TermDictionaryTest : public ::testing::Test {
+protected:
+    term_dictionary* dictionary;
+
+    void SetUp() override {
+        dictionary = new term_dictionary();
+    }
+
+    void TearDown() override {
+        delete dictionary;
+    }
+};
+
+TEST_F(TermDictionaryTest, InternReturnsStableIds) {
+    term_id first = dictionary->intern(L"film");
+    term_id second = dictionary->intern(L"movie");
+
+    EXPECT_NE(first, second);
+    EXPECT_EQ(dictionary->intern(L"film"), first);
+    EXPECT_EQ(dictionary->find(L"movie"), second);
+    EXPECT_EQ(dictionary->term(first), L"film");
+    EXPECT_EQ(dictionary->size(), 2);
+}
+
+TEST_F(TermDictionaryTest, FindUnknownTerm) {
+    EXPECT_EQ(dictionary->find(L"unknown"), term_dictionary::no_term);
+    EXPECT_THROW((void) dictionary->term(42), std::out_of_range);
+}
+
+TEST_F(TermDictionaryTest, ConcurrentInterning) {
+    const int threads_num = 8;
+    const int terms_num = 1000;
+    vector<thread> threads;
+    vector<vector<term_id>> ids(threads_num, vector<term_id>(terms_num));
+
+    threads.reserve(threads_num);
+
+    for (int t = 0; t < threads_num; ++t) {
+        threads.emplace_back([this, &ids, t]() {
+            for (int i = 0; i < terms_num; ++i) {
+                ids[t][i] = dictionary->intern(L"term" + to_wstring(i));
+            }
+        });
+    }
+
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    EXPECT_EQ(dictionary->size(), terms_num);
+
+    for (int t = 1; t < threads_num; ++t) {
+        EXPECT_EQ(ids[t], ids[0]);
+    }
+
+    for (int i = 0; i < terms_num; ++i) {
+        EXPECT_EQ(dictionary->term(ids[0][i]), L"term" + to_wstring(i));
+    }
+}
+
+TEST_F(TermDictionaryTest, SharedBetweenParserAndIndex) {
+    document_parser parser;
+    inverted_index index(dictionary);
+
+    parser.set_dictionary(index.dictionary());
+
+    auto terms = parser.parse_word_term_ids(L"connecting dots, dots ");
+
+    index.add("doc1", terms);
+
+    EXPECT_EQ(terms.size(), 2);
+    EXPECT_EQ(dictionary->size(), 2);
+    EXPECT_TRUE(index.find(L"dot").contains("doc1"));
+    EXPECT_TRUE(index.find(dictionary->find(L"connect")).contains("doc1"));
+    EXPECT_EQ(index.term_frequency(L"dot", "doc1"), 2);
+}
+
+TEST_F(TermDictionaryTest, TrigramIndexFindsCloseTerms) {
+    trigram_index trigrams(dictionary);
+
+    for (const auto* term : {L"huckleberri", L"finn", L"fine", L"film", L"filmmak", L"friend"}) {
+        bool inserted;
+        term_id id = dictionary->intern(term, inserted);
+
+        ASSERT_TRUE(inserted);
+        trigrams.add(id, term);
+    }
+
+    EXPECT_EQ(trigrams.size(), 6);
+    EXPECT_EQ(dictionary->term(trigrams.best_match(L"huckleberi", 1)), L"huckleberri");
+    EXPECT_EQ(dictionary->term(trigrams.best_match(L"filn", 1)), L"film");
+    EXPECT_EQ(trigrams.best_match(L"zebra", 1), term_dictionary::no_term);
+
+    auto matches = trigrams.matches(L"fin", 1);
+
+    ASSERT_EQ(matches.size(), 2);
+    EXPECT_EQ(std::set<wstring>({dictionary->term(matches[0]), dictionary->term(matches[1])}),
+              std::set<wstring>({L"finn", L"fine"}));
+}
+
+TEST_F(TermDictionaryTest, EditDistanceIsBounded) {
+    EXPECT_EQ(trigram_index::edit_distance(L"kitten", L"sitting", 3), 3);
+    EXPECT_EQ(trigram_index::edit_distance(L"kitten", L"sitting", 1), 2);
+    EXPECT_EQ(trigram_index::edit_distance(L"film", L"film", 0), 0);
+    EXPECT_EQ(trigram_index::edit_distance(L"", L"abc", 5), 3);
+}
+
+TEST_F(TermDictionaryTest, TrigramMatchesMisspellingsAtScale) {
+    const int terms_num = 100000;
+    const int queries_num = 1000;
+    trigram_index trigrams(dictionary);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> letter(0, 25);
+    std::uniform_int_distribution<int> length(4, 10);
+    vector<wstring> terms;
+
+    terms.reserve(terms_num);
+
+    for (int i = 0; i < terms_num; ++i) {
+        wstring term(length(rng), L'a');
+
+        for (auto& c : term) {
+            c = static_cast<wchar_t>(L'a' + letter(rng));
+        }
+
+        bool inserted;
+        term_id id = dictionary->intern(term, inserted);
+
+        if (inserted) {
+            trigrams.add(id, term);
+            terms.push_back(term);
+        }
+    }
+
+    int found = 0;
+
+    for (int i = 0; i < queries_num; ++i) {
+        wstring query = terms[i * 997 % terms.size()];
+
+        query[query.size() / 2] = L'z' == query[query.size() / 2] ? L'y' : L'z';
+        found += trigrams.best_match(query, 1) != term_dictionary::no_term;
+    }
+
+    EXPECT_EQ(found, queries_num);
+}
+
+TEST_F(TermDictionaryTest, FrontCodedLookups) {
+    sorted_terms terms;
+
+    for (const auto* term : {L"film", L"filmmak", L"films", L"final", L"fire", L"movi", L"café", L"cafe"}) {
+        terms.emplace_back(term, dictionary->intern(term));
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        wstring term = L"term" + to_wstring(i);
+
+        terms.emplace_back(term, dictionary->intern(term));
+    }
+
+    front_coded_dictionary sorted(terms);
+    auto names = [](const sorted_terms& found) {
+        vector<wstring> result;
+
+        for (const auto& [term, id] : found) {
+            result.push_back(term);
+        }
+
+        return result;
+    };
+
+    EXPECT_EQ(sorted.size(), terms.size());
+    EXPECT_EQ(sorted.find(L"films"), dictionary->find(L"films"));
+    EXPECT_EQ(sorted.find(L"café"), dictionary->find(L"café"));
+    EXPECT_EQ(sorted.find(L"term57"), dictionary->find(L"term57"));
+    EXPECT_EQ(sorted.find(L"fil"), term_dictionary::no_term);
+    EXPECT_EQ(sorted.find(L"zzz"), term_dictionary::no_term);
+    EXPECT_EQ(names(sorted.prefix(L"film")), (vector<wstring>{L"film", L"filmmak", L"films"}));
+    EXPECT_EQ(names(sorted.prefix(L"caf")), (vector<wstring>{L"cafe", L"café"}));
+    EXPECT_EQ(sorted.prefix(L"term").size(), 100);
+    EXPECT_EQ(names(sorted.range(L"fin", L"movi")), (vector<wstring>{L"final", L"fire"}));
+    EXPECT_EQ(names(sorted.wildcard(L"fi?e")), (vector<wstring>{L"fire"}));
+    EXPECT_EQ(names(sorted.wildcard(L"*s")), (vector<wstring>{L"films"}));
+    EXPECT_EQ(names(sorted.wildcard(L"f*l*")), (vector<wstring>{L"film", L"filmmak", L"films", L"final"}));
+    EXPECT_TRUE(front_coded_dictionary().prefix(L"a").empty());
+}
+
+TEST_F(TermDictionaryTest, FrontCodedMemoryUsage) {
+    const int terms_num = 100000;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> letter(0, 25);
+    std::uniform_int_distribution<int> length(4, 10);
+    sorted_terms terms;
+
+    terms.reserve(terms_num);
+
+    for (int i = 0; i < terms_num; ++i) {
+        wstring term(length(rng), L'a');
+
+        for (auto& c : term) {
+            c = static_cast<wchar_t>(L'a' + letter(rng));
+        }
+
+        bool inserted;
+        term_id id = dictionary->intern(term, inserted);
+
+        if (inserted) {
+            terms.emplace_back(std::move(term), id);
+        }
+    }
+
+    size_t dictionary_bytes = dictionary->memory_usage();
+    front_coded_dictionary sorted(terms);
+
+    // every term costs at least its string object, a hash node and its letters
+    EXPECT_GT(dictionary_bytes, terms.size() * (sizeof(wstring) + 4 * sizeof(wchar_t)));
+    // the sorted index comes on top of the dictionary, but adds under a quarter to it
+    EXPECT_GT(sorted.memory_usage(), 0);
+    EXPECT_LT(sorted.memory_usage(), dictionary_bytes / 4);
+    EXPECT_EQ(sorted.find(terms[12345].first), terms[12345].second);
+}
@@ -1,8 +1,10 @@
 #include <gtest/gtest.h>
+#include <atomic>
 #include <future>
 #include <thread>
 #include <vector>
 #include "thread_pool.h"
+#include "bounded_queue.h"
 #include <iostream>
 
 class ThreadPoolTest : public ::testing::Test {
@@ -184,3 +186,98 @@ TEST_F(ThreadPoolTest, LongRunningTasks) {
     pool->shutdown();
     EXPECT_EQ(std::any_cast<int>(future.get()), 42);
 }
+
+TEST_F(ThreadPoolTest, DetachedTasksAreAwaitedByWaitAll) {
+    std::atomic<int> done = 0;
+
+    for (int i = 0; i < 1000; ++i) {
+        pool->add_detached_task([&done]() { ++done; });
+    }
+
+    auto task_id = pool->add_task([]() { return 42; });
+
+    pool->wait_all();
+
+    EXPECT_EQ(done, 1000);
+    // detached tasks take no ids, the next tracked task still gets the next one
+    EXPECT_EQ(task_id, 0);
+    EXPECT_TRUE(pool->is_task_finished(task_id));
+}
+
+TEST_F(ThreadPoolTest, DetachedTaskAfterShutdown) {
+    pool->shutdown();
+
+    EXPECT_THROW(pool->add_detached_task([]() {}), std::exception);
+}
+
+TEST(BoundedQueueTest, FifoWithinCapacity) {
+    bounded_queue<int> queue(3);
+    int value;
+
+    EXPECT_EQ(queue.capacity(), 4);
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_push(int(i)));
+    }
+
+    EXPECT_FALSE(queue.try_push(4));
+    EXPECT_EQ(queue.size(), 4);
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_pop(value));
+        EXPECT_EQ(value, i);
+    }
+
+    EXPECT_FALSE(queue.try_pop(value));
+
+    queue.push(5);
+    queue.close();
+
+    EXPECT_FALSE(queue.push(6));
+    EXPECT_TRUE(queue.pop(value));
+    EXPECT_EQ(value, 5);
+    EXPECT_FALSE(queue.pop(value));
+}
+
+TEST(BoundedQueueTest, ConcurrentProducersAndConsumers) {
+    const int producers_num = 4;
+    const int consumers_num = 4;
+    const int items_num = 20000;
+    bounded_queue<int> queue(16);
+    std::atomic<int> producers_left = producers_num;
+    std::atomic<long long> sum = 0;
+    std::atomic<int> popped = 0;
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers_num; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < items_num; ++i) {
+                queue.push(p * items_num + i);
+            }
+
+            if (--producers_left == 0) {
+                queue.close();
+            }
+        });
+    }
+
+    for (int c = 0; c < consumers_num; ++c) {
+        threads.emplace_back([&]() {
+            int value;
+
+            while (queue.pop(value)) {
+                sum += value;
+                ++popped;
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    long long total = producers_num * items_num;
+
+    EXPECT_EQ(popped, total);
+    EXPECT_EQ(sum, total * (total - 1) / 2);
+}
@@ -0,0 +1,152 @@
+#include "binary_io.h"
+#include <cerrno>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+uint32_t checksum(string_view data) {
+    uint32_t hash = 2166136261u;
+
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static bool write_all(int fd, string_view data) {
+    while (!data.empty()) {
+        ssize_t written = write(fd, data.data(), data.size());
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        data.remove_prefix(written);
+    }
+
+    return true;
+}
+
+bool write_file_atomically(const string& file_path, string_view data) {
+    string temporary = file_path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    bool written = write_all(fd, data) && fdatasync(fd) == 0;
+
+    close(fd);
+
+    if (!written || rename(temporary.c_str(), file_path.c_str()) != 0) {
+        unlink(temporary.c_str());
+
+        return false;
+    }
+
+    // the rename itself is only durable once the directory is synced
+    string dir = std::filesystem::path(file_path).parent_path().string();
+    int dir_fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+
+    return true;
+}
+
+optional<string> read_whole_file(const string& file_path) {
+    int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return std::nullopt;
+    }
+
+    string content;
+    char buffer[64 * 1024];
+    ssize_t read_bytes;
+
+    while ((read_bytes = read(fd, buffer, sizeof(buffer))) > 0 || (read_bytes < 0 && errno == EINTR)) {
+        if (read_bytes > 0) {
+            content.append(buffer, read_bytes);
+        }
+    }
+
+    close(fd);
+
+    if (read_bytes < 0) {
+        return std::nullopt;
+    }
+
+    return content;
+}
+
+byte_reader::byte_reader(string_view data) : data_(data) {}
+
+bool byte_reader::u8(uint8_t& value) {
+    return fixed(value);
+}
+
+bool byte_reader::u32(uint32_t& value) {
+    return fixed(value);
+}
+
+bool byte_reader::u64(uint64_t& value) {
+    return fixed(value);
+}
+
+bool byte_reader::varint(uint32_t& value) {
+    value = 0;
+
+    for (int shift = 0; shift < 35 && position_ < data_.size(); shift += 7) {
+        auto byte = static_cast<uint8_t>(data_[position_++]);
+
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool byte_reader::str(string& value) {
+    uint32_t size;
+    string_view view;
+
+    if (!u32(size) || !bytes(size, view)) {
+        return false;
+    }
+
+    value.assign(view);
+
+    return true;
+}
+
+bool byte_reader::bytes(size_t size, string_view& value) {
+    if (data_.size() - position_ < size) {
+        return false;
+    }
+
+    value = data_.substr(position_, size);
+    position_ += size;
+
+    return true;
+}
+
+size_t byte_reader::position() const {
+    return position_;
+}
+
+bool byte_reader::at_end() const {
+    return position_ == data_.size();
+}
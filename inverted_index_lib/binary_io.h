@@ -0,0 +1,83 @@
+#ifndef INVERTED_INDEX_LIB_BINARY_IO_H
+#define INVERTED_INDEX_LIB_BINARY_IO_H
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using std::optional;
+using std::string;
+using std::string_view;
+
+// Little helpers for the index's binary files (snapshots, the write-ahead
+// log). Integers are stored in host byte order, the files are not meant to
+// move between machines.
+inline void put_u8(string& out, uint8_t value) {
+    out.push_back(static_cast<char>(value));
+}
+
+inline void put_u32(string& out, uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void put_u64(string& out, uint64_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// 7 bits per byte, high bit set on all but the last
+inline void put_varint(string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<char>(value));
+}
+
+inline void put_string(string& out, string_view value) {
+    put_u32(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+uint32_t checksum(string_view data);
+
+// Writes data to a temporary file, syncs it and renames it over file_path,
+// so readers see either the old file or the whole new one.
+bool write_file_atomically(const string& file_path, string_view data);
+optional<string> read_whole_file(const string& file_path);
+
+// Reads what put_* wrote; every getter fails instead of reading past the end.
+class byte_reader {
+public:
+    explicit byte_reader(string_view data);
+
+    bool u8(uint8_t& value);
+    bool u32(uint32_t& value);
+    bool u64(uint64_t& value);
+    bool varint(uint32_t& value);
+    bool str(string& value);
+    bool bytes(size_t size, string_view& value);
+
+    [[nodiscard]] size_t position() const;
+    [[nodiscard]] bool at_end() const;
+
+private:
+    string_view data_;
+    size_t position_ = 0;
+
+    template<typename T>
+    bool fixed(T& value) {
+        if (data_.size() - position_ < sizeof(T)) {
+            return false;
+        }
+
+        std::memcpy(&value, data_.data() + position_, sizeof(T));
+        position_ += sizeof(T);
+
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "durable_index.h"
+#include <iostream>
+#include <string>
+
+using std::cerr;
+using std::endl;
+
+static const string snapshot_prefix = "snapshot-";
+static const string snapshot_extension = ".bin";
+static constexpr uint64_t no_snapshot = 0;
+
+durable_index::durable_index(inverted_index* index, const fs::path& dir, const wal_config& config)
+        : index_(index), dir_(dir), config_(config) {
+    fs::create_directories(dir_);
+    recover();
+}
+
+void durable_index::add(const document& doc, const term_id_frequencies& terms) {
+    auto words = to_words(terms);
+    uint64_t lsn;
+
+    {
+        read_lock operation_lock(checkpoint_mutex_);
+
+        lsn = log_->append_add(doc, words);
+        index_->add(doc, terms);
+    }
+
+    after_operation(lsn, 1);
+}
+
+void durable_index::add(const document& doc, const term_frequencies& terms) {
+    uint64_t lsn;
+
+    {
+        read_lock operation_lock(checkpoint_mutex_);
+
+        lsn = log_->append_add(doc, terms);
+        index_->add(doc, terms);
+    }
+
+    after_operation(lsn, 1);
+}
+
+void durable_index::remove(const document& doc) {
+    uint64_t lsn;
+
+    {
+        read_lock operation_lock(checkpoint_mutex_);
+
+        lsn = log_->append_remove(doc);
+        index_->remove_document_from_all_records(doc);
+    }
+
+    after_operation(lsn, 1);
+}
+
+void durable_index::add_batch(const document_terms& docs, const function<void()>& apply) {
+    if (docs.empty()) {
+        apply();
+
+        return;
+    }
+
+    uint64_t lsn = 0;
+
+    {
+        read_lock operation_lock(checkpoint_mutex_);
+
+        for (const auto& [doc, terms] : docs) {
+            lsn = log_->append_add(doc, to_words(terms));
+        }
+
+        apply();
+    }
+
+    after_operation(lsn, docs.size());
+}
+
+void durable_index::add_batch(const document_terms& docs) {
+    add_batch(docs, [this, &docs] {
+        for (const auto& [doc, terms] : docs) {
+            index_->add(doc, terms);
+        }
+    });
+}
+
+// A crash between writing the snapshot and truncating the log is harmless:
+// recovery skips the records the snapshot already holds by their lsn.
+void durable_index::checkpoint() {
+    write_lock checkpoint_lock(checkpoint_mutex_);
+    uint64_t lsn = log_->last_lsn();
+
+    since_checkpoint_ = 0;
+    log_->wait_durable(lsn);
+    index_->save_snapshot(snapshot_path(lsn).string());
+    log_->truncate();
+
+    for (const auto& entry : fs::directory_iterator(dir_)) {
+        uint64_t old = snapshot_lsn(entry.path());
+
+        if (old != no_snapshot && old < lsn) {
+            fs::remove(entry.path());
+        }
+    }
+}
+
+size_t durable_index::recovered_records() const {
+    return recovered_records_;
+}
+
+uint64_t durable_index::syncs() const {
+    return log_->syncs();
+}
+
+void durable_index::recover() {
+    uint64_t snapshot = no_snapshot;
+
+    for (const auto& entry : fs::directory_iterator(dir_)) {
+        snapshot = std::max(snapshot, snapshot_lsn(entry.path()));
+    }
+
+    if (snapshot != no_snapshot && !index_->load_snapshot(snapshot_path(snapshot).string())) {
+        throw std::runtime_error("Cannot load snapshot " + snapshot_path(snapshot).string());
+    }
+
+    uint64_t valid_size;
+    uint64_t last = snapshot;
+    auto records = write_ahead_log::read(log_path(), valid_size);
+
+    for (const auto& record : records) {
+        last = std::max(last, record.lsn);
+
+        if (record.lsn <= snapshot) {
+            continue;
+        }
+
+        if (record.type == WAL_ADD) {
+            index_->add(record.doc, record.terms);
+        } else {
+            index_->remove_document_from_all_records(record.doc);
+        }
+
+        ++recovered_records_;
+    }
+
+    // new records must not land behind a torn one, recovery would stop there
+    if (fs::exists(log_path()) && fs::file_size(log_path()) > valid_size) {
+        cerr << "Dropping torn write-ahead log tail of " << log_path() << endl;
+        fs::resize_file(log_path(), valid_size);
+    }
+
+    log_ = std::make_unique<write_ahead_log>(log_path(), last + 1, config_);
+}
+
+term_frequencies durable_index::to_words(const term_id_frequencies& terms) const {
+    term_frequencies words;
+
+    words.reserve(terms.size());
+
+    for (const auto& [id, count] : terms) {
+        words.emplace_back(index_->dictionary()->term(id), count);
+    }
+
+    return words;
+}
+
+void durable_index::after_operation(uint64_t lsn, size_t operations) {
+    log_->wait_durable(lsn);
+
+    if (config_.checkpoint_every > 0 && (since_checkpoint_ += operations) >= config_.checkpoint_every) {
+        checkpoint();
+    }
+}
+
+fs::path durable_index::log_path() const {
+    return dir_ / "index.wal";
+}
+
+fs::path durable_index::snapshot_path(uint64_t lsn) const {
+    return dir_ / (snapshot_prefix + std::to_string(lsn) + snapshot_extension);
+}
+
+uint64_t durable_index::snapshot_lsn(const fs::path& path) {
+    string name = path.filename().string();
+
+    if (!name.starts_with(snapshot_prefix) || !name.ends_with(snapshot_extension)) {
+        return no_snapshot;
+    }
+
+    try {
+        return std::stoull(name.substr(snapshot_prefix.size(),
+                                       name.size() - snapshot_prefix.size() - snapshot_extension.size()));
+    } catch (std::exception&) {
+        return no_snapshot;
+    }
+}
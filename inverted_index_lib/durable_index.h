@@ -0,0 +1,63 @@
+#ifndef INVERTED_INDEX_LIB_DURABLE_INDEX_H
+#define INVERTED_INDEX_LIB_DURABLE_INDEX_H
+
+#include "inverted_index.h"
+#include "write_ahead_log.h"
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+
+namespace fs = std::filesystem;
+
+using std::atomic;
+using std::function;
+using std::shared_mutex;
+using std::unique_ptr;
+
+using document_terms = vector<pair<document, term_id_frequencies>>;
+
+// Makes the adds and removes of an inverted_index survive a crash. Every
+// operation is logged before it returns, and checkpoints write a snapshot of
+// the whole index named after the last logged lsn and then empty the log.
+// Construction recovers whatever dir holds: the newest snapshot, then the
+// logged operations newer than it.
+class durable_index {
+public:
+    durable_index(inverted_index* index, const fs::path& dir, const wal_config& config = {});
+
+    void add(const document& doc, const term_id_frequencies& terms);
+    void add(const document& doc, const term_frequencies& terms);
+    void remove(const document& doc);
+    // Logs every document of a bulk load, lets apply put them into the index
+    // however it likes (no checkpoint can fall in between) and waits for one
+    // sync covering the whole batch.
+    void add_batch(const document_terms& docs, const function<void()>& apply);
+    void add_batch(const document_terms& docs);
+    void checkpoint();
+
+    [[nodiscard]] size_t recovered_records() const;
+    [[nodiscard]] uint64_t syncs() const;
+
+private:
+    inverted_index* index_ = nullptr;
+    fs::path dir_;
+    wal_config config_;
+    unique_ptr<write_ahead_log> log_;
+
+    // operations hold it shared while they log and apply, a checkpoint exclusively
+    shared_mutex checkpoint_mutex_;
+    atomic<size_t> since_checkpoint_ = 0;
+    size_t recovered_records_ = 0;
+
+    void recover();
+    [[nodiscard]] term_frequencies to_words(const term_id_frequencies& terms) const;
+    void after_operation(uint64_t lsn, size_t operations);
+    [[nodiscard]] fs::path log_path() const;
+    [[nodiscard]] fs::path snapshot_path(uint64_t lsn) const;
+    [[nodiscard]] static uint64_t snapshot_lsn(const fs::path& path);
+};
+
+#endif
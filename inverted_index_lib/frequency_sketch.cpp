@@ -0,0 +1,48 @@
+#include "frequency_sketch.h"
+#include <algorithm>
+#include <bit>
+
+frequency_sketch::frequency_sketch(size_t expected_items) {
+    size_t width = std::bit_ceil(std::max<size_t>(expected_items, 1) * 4);
+
+    counters_.assign(width * rows, 0);
+    mask_ = width - 1;
+    reset_after_ = std::max<size_t>(expected_items, 1) * 10;
+}
+
+void frequency_sketch::record(size_t hash) {
+    for (size_t row = 0; row < rows; ++row) {
+        auto& counter = counters_[index(hash, row)];
+
+        if (counter < max_frequency) {
+            ++counter;
+        }
+    }
+
+    if (++additions_ >= reset_after_) {
+        for (auto& counter : counters_) {
+            counter /= 2;
+        }
+
+        additions_ = 0;
+    }
+}
+
+uint8_t frequency_sketch::estimate(size_t hash) const {
+    uint8_t result = max_frequency;
+
+    for (size_t row = 0; row < rows; ++row) {
+        result = std::min(result, counters_[index(hash, row)]);
+    }
+
+    return result;
+}
+
+// callers may have used the low bits to pick a shard, so they are mixed into the rest first
+size_t frequency_sketch::index(size_t hash, size_t row) const {
+    uint64_t mixed = static_cast<uint64_t>(hash) * 0x9e3779b97f4a7c15ULL;
+    uint64_t h1 = mixed >> 32;
+    uint64_t h2 = (mixed & 0xffffffff) | 1;
+
+    return row * (mask_ + 1) + ((h1 + row * h2) & mask_);
+}
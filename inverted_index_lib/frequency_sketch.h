@@ -0,0 +1,33 @@
+#ifndef INVERTED_INDEX_LIB_FREQUENCY_SKETCH_H
+#define INVERTED_INDEX_LIB_FREQUENCY_SKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+// TinyLFU's popularity estimate: a count-min sketch of 4 rows with counters
+// saturating at 15, all halved once 10 additions per expected item were
+// recorded so old popularity fades. Caches use it to admit a new entry only
+// when it is asked for more often than the entry it would evict.
+class frequency_sketch {
+public:
+    explicit frequency_sketch(size_t expected_items);
+
+    void record(size_t hash);
+    [[nodiscard]] uint8_t estimate(size_t hash) const;
+
+private:
+    static constexpr size_t rows = 4;
+    static constexpr uint8_t max_frequency = 15;
+
+    vector<uint8_t> counters_;
+    size_t mask_ = 0;
+    size_t additions_ = 0;
+    size_t reset_after_ = 0;
+
+    [[nodiscard]] size_t index(size_t hash, size_t row) const;
+};
+
+#endif
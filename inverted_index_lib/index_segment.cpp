@@ -0,0 +1,364 @@
+#include "index_segment.h"
+#include "binary_io.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::runtime_error;
+
+static constexpr uint32_t dropped = std::numeric_limits<uint32_t>::max();
+static constexpr string_view segment_magic = "IIS1";
+
+index_segment::~index_segment() {
+    if (mapped_ != nullptr) {
+        munmap(const_cast<char*>(mapped_), mapped_size_);
+    }
+}
+
+shared_ptr<const index_segment> index_segment::build(uint64_t generation, const buffer& postings) {
+    auto segment = std::make_shared<index_segment>();
+    unordered_map<string, uint32_t> ids;
+
+    segment->generation_ = generation;
+    segment->terms_.reserve(postings.size());
+
+    for (const auto& [id, docs] : postings) {
+        segment->terms_.push_back(id);
+
+        for (const auto& [doc, count] : docs) {
+            ids.emplace(doc, 0);
+        }
+    }
+
+    segment->documents_.reserve(ids.size());
+
+    for (const auto& [doc, id] : ids) {
+        segment->documents_.push_back(doc);
+    }
+
+    std::sort(segment->documents_.begin(), segment->documents_.end());
+    std::sort(segment->terms_.begin(), segment->terms_.end());
+
+    for (uint32_t i = 0; i < segment->documents_.size(); ++i) {
+        ids[segment->documents_[i]] = i;
+    }
+
+    segment->offsets_.reserve(segment->terms_.size() + 1);
+
+    for (auto id : segment->terms_) {
+        const auto& docs = postings.at(id);
+        size_t begin = segment->postings_.size();
+
+        segment->offsets_.push_back(static_cast<uint32_t>(begin));
+
+        for (const auto& [doc, count] : docs) {
+            segment->postings_.push_back({ids[doc], count});
+        }
+
+        std::sort(segment->postings_.begin() + static_cast<ptrdiff_t>(begin), segment->postings_.end(),
+                  [](const segment_posting& lhs, const segment_posting& rhs) {
+                      return lhs.document < rhs.document;
+                  });
+    }
+
+    segment->offsets_.push_back(static_cast<uint32_t>(segment->postings_.size()));
+
+    return segment;
+}
+
+shared_ptr<const index_segment> index_segment::merge(
+        const vector<shared_ptr<const index_segment>>& inputs,
+        const is_deleted& deleted
+) {
+    auto segment = std::make_shared<index_segment>();
+    unordered_map<string, uint32_t> ids;
+    vector<vector<uint32_t>> remaps(inputs.size());
+
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        const auto& input = *inputs[i];
+
+        segment->generation_ = std::max(segment->generation_, input.generation_);
+        remaps[i].resize(input.documents_.size(), dropped);
+
+        for (uint32_t doc = 0; doc < input.documents_.size(); ++doc) {
+            const string& name = input.documents_[doc];
+
+            if (deleted && deleted(name, input.generation_)) {
+                continue;
+            }
+
+            auto [it, inserted] = ids.emplace(name, static_cast<uint32_t>(segment->documents_.size()));
+
+            if (inserted) {
+                segment->documents_.push_back(name);
+            }
+
+            remaps[i][doc] = it->second;
+        }
+    }
+
+    vector<size_t> cursors(inputs.size());
+    vector<segment_posting> merged;
+    vector<segment_posting> run;
+
+    // k-way merge over the sorted term lists, the fan-in is the merge policy's tier width
+    while (true) {
+        term_id next = term_dictionary::no_term;
+
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (cursors[i] < inputs[i]->terms_.size()) {
+                next = std::min(next, inputs[i]->terms_[cursors[i]]);
+            }
+        }
+
+        if (next == term_dictionary::no_term) {
+            break;
+        }
+
+        merged.clear();
+
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            const auto& input = *inputs[i];
+
+            if (cursors[i] >= input.terms_.size() || input.terms_[cursors[i]] != next) {
+                continue;
+            }
+
+            run.clear();
+            input.decode_run(cursors[i], run);
+
+            for (const auto& posting : run) {
+                uint32_t doc = remaps[i][posting.document];
+
+                if (doc != dropped) {
+                    merged.push_back({doc, posting.count});
+                }
+            }
+
+            ++cursors[i];
+        }
+
+        if (merged.empty()) {
+            continue;
+        }
+
+        std::sort(merged.begin(), merged.end(), [](const segment_posting& lhs, const segment_posting& rhs) {
+            return lhs.document < rhs.document;
+        });
+
+        segment->terms_.push_back(next);
+        segment->offsets_.push_back(static_cast<uint32_t>(segment->postings_.size()));
+
+        // a document split over several flushes has postings in several inputs
+        for (const auto& posting : merged) {
+            if (!segment->postings_.empty() && segment->postings_.size() > segment->offsets_.back() &&
+                segment->postings_.back().document == posting.document) {
+                segment->postings_.back().count += posting.count;
+            } else {
+                segment->postings_.push_back(posting);
+            }
+        }
+    }
+
+    segment->offsets_.push_back(static_cast<uint32_t>(segment->postings_.size()));
+
+    return segment;
+}
+
+// Layout: magic, generation, document table, term directory (id, postings
+// before it, byte offset of its run), postings count, encoded size, then the
+// runs themselves as (document delta, count) varint pairs.
+void index_segment::save(const fs::path& path) const {
+    string encoded;
+    vector<uint64_t> starts;
+    vector<segment_posting> run;
+
+    starts.reserve(terms_.size());
+
+    for (size_t i = 0; i < terms_.size(); ++i) {
+        uint32_t previous = 0;
+
+        starts.push_back(encoded.size());
+        run.clear();
+        decode_run(i, run);
+
+        for (const auto& posting : run) {
+            put_varint(encoded, posting.document - previous);
+            put_varint(encoded, posting.count);
+            previous = posting.document;
+        }
+    }
+
+    string data(segment_magic);
+
+    put_u64(data, generation_);
+    put_u32(data, static_cast<uint32_t>(documents_.size()));
+
+    for (const auto& doc : documents_) {
+        put_string(data, doc);
+    }
+
+    put_u32(data, static_cast<uint32_t>(terms_.size()));
+
+    for (size_t i = 0; i < terms_.size(); ++i) {
+        put_u32(data, terms_[i]);
+        put_u32(data, offsets_[i]);
+        put_u64(data, starts[i]);
+    }
+
+    put_u32(data, static_cast<uint32_t>(postings_num()));
+    put_u64(data, encoded.size());
+    data += encoded;
+
+    if (!write_file_atomically(path.string(), data)) {
+        throw runtime_error("Cannot write segment " + path.string());
+    }
+}
+
+shared_ptr<const index_segment> index_segment::open(const fs::path& path) {
+    auto segment = std::make_shared<index_segment>();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info{};
+
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        throw runtime_error("Cannot open segment " + path.string());
+    }
+
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if (mapped == MAP_FAILED) {
+        throw runtime_error("Cannot map segment " + path.string());
+    }
+
+    segment->path_ = path;
+    segment->mapped_ = static_cast<const char*>(mapped);
+    segment->mapped_size_ = info.st_size;
+
+    string_view data(segment->mapped_, segment->mapped_size_);
+    byte_reader reader(data.substr(std::min(data.size(), segment_magic.size())));
+    uint32_t documents_num;
+    uint32_t terms_num;
+    uint32_t postings_num;
+    uint64_t encoded_size;
+    bool valid = data.starts_with(segment_magic) && reader.u64(segment->generation_) && reader.u32(documents_num);
+
+    for (uint32_t d = 0; valid && d < documents_num; ++d) {
+        valid = reader.str(segment->documents_.emplace_back());
+    }
+
+    valid = valid && reader.u32(terms_num);
+
+    for (uint32_t t = 0; valid && t < terms_num; ++t) {
+        valid = reader.u32(segment->terms_.emplace_back()) && reader.u32(segment->offsets_.emplace_back()) &&
+                reader.u64(segment->byte_offsets_.emplace_back());
+    }
+
+    valid = valid && reader.u32(postings_num) && reader.u64(encoded_size) &&
+            encoded_size == data.size() - segment_magic.size() - reader.position();
+
+    if (!valid) {
+        throw runtime_error("Corrupt segment " + path.string());
+    }
+
+    uint64_t base = segment_magic.size() + reader.position();
+
+    for (auto& offset : segment->byte_offsets_) {
+        offset += base;
+    }
+
+    segment->offsets_.push_back(postings_num);
+    segment->byte_offsets_.push_back(base + encoded_size);
+
+    return segment;
+}
+
+span<const segment_posting> index_segment::postings(term_id id) const {
+    auto it = std::lower_bound(terms_.begin(), terms_.end(), id);
+
+    if (mapped_ != nullptr || it == terms_.end() || *it != id) {
+        return {};
+    }
+
+    auto i = static_cast<size_t>(it - terms_.begin());
+
+    return {postings_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]};
+}
+
+vector<segment_posting> index_segment::decode(term_id id) const {
+    vector<segment_posting> run;
+    auto it = std::lower_bound(terms_.begin(), terms_.end(), id);
+
+    if (it != terms_.end() && *it == id) {
+        decode_run(static_cast<size_t>(it - terms_.begin()), run);
+    }
+
+    return run;
+}
+
+void index_segment::decode_run(size_t term_index, vector<segment_posting>& out) const {
+    uint32_t size = offsets_[term_index + 1] - offsets_[term_index];
+
+    if (mapped_ == nullptr) {
+        auto begin = postings_.begin() + offsets_[term_index];
+
+        out.insert(out.end(), begin, begin + size);
+
+        return;
+    }
+
+    byte_reader reader(string_view(mapped_ + byte_offsets_[term_index],
+                                   byte_offsets_[term_index + 1] - byte_offsets_[term_index]));
+    uint32_t document = 0;
+
+    out.reserve(out.size() + size);
+
+    for (uint32_t p = 0; p < size; ++p) {
+        uint32_t delta;
+        uint32_t count;
+
+        if (!reader.varint(delta) || !reader.varint(count)) {
+            throw runtime_error("Corrupt segment " + path_.string());
+        }
+
+        document += delta;
+        out.push_back({document, count});
+    }
+}
+
+const string& index_segment::document_name(uint32_t document) const {
+    return documents_[document];
+}
+
+const vector<term_id>& index_segment::terms() const {
+    return terms_;
+}
+
+uint64_t index_segment::generation() const {
+    return generation_;
+}
+
+size_t index_segment::postings_num() const {
+    return offsets_.empty() ? 0 : offsets_.back();
+}
+
+size_t index_segment::documents_num() const {
+    return documents_.size();
+}
+
+bool index_segment::is_mapped() const {
+    return mapped_ != nullptr;
+}
+
+const fs::path& index_segment::path() const {
+    return path_;
+}
@@ -0,0 +1,87 @@
+#ifndef INVERTED_INDEX_LIB_INDEX_SEGMENT_H
+#define INVERTED_INDEX_LIB_INDEX_SEGMENT_H
+
+#include "term_dictionary.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using std::function;
+using std::shared_ptr;
+using std::span;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+struct segment_posting {
+    uint32_t document;
+    uint32_t count;
+};
+
+// Immutable postings of one flush or merge. Terms are sorted by id and every
+// term owns a contiguous run of postings sorted by document, which index the
+// segment's own document table. The generation orders segments by age: a
+// merge keeps the newest generation of its inputs.
+//
+// A segment can be saved to a file and opened again memory-mapped. A mapped
+// segment keeps its term and document tables in memory, the postings stay in
+// the file delta and varint encoded and are decoded term by term.
+class index_segment {
+public:
+    index_segment() = default;
+    ~index_segment();
+
+    index_segment(const index_segment&) = delete;
+    index_segment& operator=(const index_segment&) = delete;
+
+    using buffer = unordered_map<term_id, unordered_map<string, uint32_t>>;
+    using is_deleted = function<bool(const string& document, uint64_t generation)>;
+
+    static shared_ptr<const index_segment> build(uint64_t generation, const buffer& postings);
+    // Postings of documents is_deleted reports for their input's generation are dropped.
+    static shared_ptr<const index_segment> merge(
+            const vector<shared_ptr<const index_segment>>& inputs,
+            const is_deleted& deleted
+    );
+
+    static shared_ptr<const index_segment> open(const fs::path& path);
+    void save(const fs::path& path) const;
+
+    // Only for segments in memory, a mapped segment has to decode.
+    [[nodiscard]] span<const segment_posting> postings(term_id id) const;
+    [[nodiscard]] vector<segment_posting> decode(term_id id) const;
+    [[nodiscard]] const string& document_name(uint32_t document) const;
+    [[nodiscard]] const vector<term_id>& terms() const;
+
+    [[nodiscard]] uint64_t generation() const;
+    [[nodiscard]] size_t postings_num() const;
+    [[nodiscard]] size_t documents_num() const;
+    [[nodiscard]] bool is_mapped() const;
+    [[nodiscard]] const fs::path& path() const;
+
+private:
+    uint64_t generation_ = 0;
+    vector<string> documents_;
+    vector<term_id> terms_;
+    // postings before each term, one more entry for the end
+    vector<uint32_t> offsets_;
+    vector<segment_posting> postings_;
+
+    fs::path path_;
+    const char* mapped_ = nullptr;
+    size_t mapped_size_ = 0;
+    // where each term's encoded postings start in the mapping, one more entry for the end
+    vector<uint64_t> byte_offsets_;
+
+    void decode_run(size_t term_index, vector<segment_posting>& out) const;
+};
+
+#endif
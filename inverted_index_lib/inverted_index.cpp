@@ -1,114 +1,399 @@
 #include "inverted_index.h"
 #include "json.hpp"
+#include "binary_io.h"
 #include <fstream>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
 
 using nlohmann::json;
 using std::ofstream;
+using std::ifstream;
 using std::wstring_convert;
 using std::codecvt_utf8;
 
-inverted_index::inverted_index() = default;
+inverted_index::inverted_index(term_dictionary* dictionary) : dictionary_(dictionary) {
+    if (dictionary_ == nullptr) {
+        own_dictionary_ = std::make_unique<term_dictionary>();
+        dictionary_ = own_dictionary_.get();
+    }
+}
 
 inverted_index::~inverted_index() {
+    stop_compaction();
     clear();
 };
 
 void inverted_index::add(const word& word, const document& document) {
-    add_documents_to_word(word, {document});
+    add_documents_to_word(dictionary_->intern(word), {document});
 }
 
 void inverted_index::add(const word& word, const documents& docs) {
-    add_documents_to_word(word, docs);
+    add_documents_to_word(dictionary_->intern(word), docs);
+}
+
+void inverted_index::add(term_id id, const documents& docs) {
+    add_documents_to_word(id, docs);
 }
 
 void inverted_index::add(const inv_index& idx) {
+    for (const auto& pair : idx) {
+        add_documents_to_word(dictionary_->intern(pair.first), pair.second);
+    }
+}
+
+void inverted_index::add(const term_index& idx) {
     for (const auto& pair : idx) {
         add_documents_to_word(pair.first, pair.second);
     }
 }
 
-const documents& inverted_index::find(const word& word) const {
+void inverted_index::add(const document& document, const term_frequencies& terms) {
+    term_id_frequencies ids;
+
+    ids.reserve(terms.size());
+
+    for (const auto& [word, count] : terms) {
+        ids.emplace_back(dictionary_->intern(word), count);
+    }
+
+    add(document, ids);
+}
+
+void inverted_index::add(const document& document, const term_id_frequencies& terms) {
+    uint32_t length = 0;
+    vector<term_id> added;
+
+    revive(document);
+
+    {
+        write_lock index_write_lock(index_mutex_);
+
+        for (const auto& [id, count] : terms) {
+            write_lock word_lock(get_word_mutex(id));
+
+            if (!index_.contains(id)) {
+                sorted_terms_stale_ = true;
+            }
+
+            if (index_[id].insert(document).second) {
+                added.push_back(id);
+            }
+
+            frequencies_[id][document] += count;
+            length += count;
+        }
+    }
+
+    {
+        write_lock documents_lock(documents_mutex_);
+        auto& document_terms = document_terms_[document];
+
+        documents_.insert(document);
+        document_terms.insert(document_terms.end(), added.begin(), added.end());
+        document_lengths_[document] += length;
+        total_length_ += length;
+    }
+
+    ++generation_;
+}
+
+// Only creating the entries of new terms takes the index write lock. The
+// postings are then inserted under the shared lock and each term's own lock,
+// so bulk adds over different terms, like the reduce ranges of map_reduce,
+// run side by side.
+void inverted_index::add(const term_postings& postings) {
+    document_frequencies lengths;
+    unordered_map<document, vector<term_id>> added;
+
+    if (tombstones_num_ > 0) {
+        for (const auto& [id, docs] : postings) {
+            for (const auto& [document, count] : docs) {
+                revive(document);
+            }
+        }
+    }
+
+    {
+        write_lock index_write_lock(index_mutex_);
+
+        for (const auto& [id, docs] : postings) {
+            if (index_.try_emplace(id).second) {
+                sorted_terms_stale_ = true;
+            }
+
+            frequencies_.try_emplace(id);
+            get_word_mutex(id);
+        }
+    }
+
+    {
+        read_lock index_read_lock(index_mutex_);
+
+        for (const auto& [id, docs] : postings) {
+            write_lock word_lock(index_word_mutexes_.at(id));
+            auto& entry = index_.at(id);
+            auto& frequencies = frequencies_.at(id);
+
+            for (const auto& [document, count] : docs) {
+                if (entry.insert(document).second) {
+                    added[document].push_back(id);
+                }
+
+                frequencies[document] += count;
+                lengths[document] += count;
+            }
+        }
+    }
+
+    {
+        write_lock documents_lock(documents_mutex_);
+
+        for (const auto& [document, length] : lengths) {
+            documents_.insert(document);
+            document_lengths_[document] += length;
+            total_length_ += length;
+        }
+
+        for (const auto& [document, ids] : added) {
+            auto& document_terms = document_terms_[document];
+
+            document_terms.insert(document_terms.end(), ids.begin(), ids.end());
+        }
+    }
+
+    ++generation_;
+}
+
+documents inverted_index::find(const word& word) const {
+    return find(dictionary_->find(word));
+}
+
+documents inverted_index::find(term_id id) const {
     read_lock index_read_lock(index_mutex_);
-    auto it = index_.find(word);
+    auto it = index_.find(id);
+
+    if (it == index_.end()) {
+        return {};
+    }
+
+    read_lock word_lock(index_word_mutexes_.at(id));
 
-    if (it != index_.end()) {
-        read_lock word_lock(index_word_mutexes_.at(word));
+    if (tombstones_num_ == 0) {
         return it->second;
     }
 
-    static const documents empty_documents;
-    return empty_documents;
+    read_lock tombstones_lock(tombstones_mutex_);
+    documents docs;
+
+    docs.reserve(it->second.size());
+
+    for (const auto& doc : it->second) {
+        if (!tombstones_.contains(doc)) {
+            docs.insert(doc);
+        }
+    }
+
+    return docs;
 }
 
 bool inverted_index::contains(const word& word) const {
+    term_id id = dictionary_->find(word);
     read_lock index_read_lock(index_mutex_);
-    return index_.contains(word);
+    auto it = index_.find(id);
+
+    if (it == index_.end()) {
+        return false;
+    }
+
+    read_lock word_lock(index_word_mutexes_.at(id));
+    read_lock tombstones_lock(tombstones_mutex_);
+
+    return std::any_of(it->second.begin(), it->second.end(), [this](const document& doc) {
+        return !tombstones_.contains(doc);
+    });
 }
 
 void inverted_index::remove_word(const word& word) {
+    term_id id = dictionary_->find(word);
     write_lock index_write_lock(index_mutex_);
 
-    if (!index_.contains(word)) {
+    if (!index_.contains(id)) {
         return;
     }
 
-    write_lock word_lock(index_word_mutexes_.at(word));
+    write_lock word_lock(index_word_mutexes_.at(id));
 
-    index_.erase(word);
+    index_.erase(id);
+    frequencies_.erase(id);
+    sorted_terms_stale_ = true;
 
-    write_lock word_mutexes_lock(index_word_mutexes_mutex_);
+    {
+        write_lock word_mutexes_lock(index_word_mutexes_mutex_);
+
+        index_word_mutexes_.erase(id);
+    }
 
-    index_word_mutexes_.erase(word);
+    ++generation_;
 }
 
+// Only marks the document deleted, its postings stay until compaction.
 void inverted_index::remove_document_from_all_records(const document& doc) {
-    write_lock documents_lock(documents_mutex_);
+    {
+        write_lock documents_lock(documents_mutex_);
 
-    if (documents_.find(doc) == documents_.end()) {
-        return;
+        if (documents_.find(doc) == documents_.end()) {
+            return;
+        }
+
+        documents_.erase(doc);
+
+        if (auto length = document_lengths_.find(doc); length != document_lengths_.end()) {
+            total_length_ -= length->second;
+            document_lengths_.erase(length);
+        }
     }
 
-    documents_.erase(doc);
+    {
+        write_lock tombstones_lock(tombstones_mutex_);
 
-    write_lock index_write_lock(index_mutex_);
+        tombstones_.insert(doc);
+        tombstones_num_ = tombstones_.size();
+    }
+
+    ++generation_;
+}
 
-    for (auto it = index_.begin(); it != index_.end();) {
-        write_lock word_lock(index_word_mutexes_.at(it->first));
+// Purges the postings of every document deleted so far in one pass over
+// their terms, batch_size terms per write lock so queries get in between.
+// Returns the number of purged documents.
+size_t inverted_index::compact(size_t batch_size) {
+    std::lock_guard compaction_lock(compaction_mutex_);
+    documents deleted;
 
-        it->second.erase(doc);
+    {
+        read_lock tombstones_lock(tombstones_mutex_);
 
-        if (it->second.empty()) {
-            it = index_.erase(it);
+        deleted = tombstones_;
+    }
 
-            continue;
+    if (deleted.empty()) {
+        return 0;
+    }
+
+    purge(deleted, batch_size);
+
+    write_lock tombstones_lock(tombstones_mutex_);
+
+    for (const auto& doc : deleted) {
+        tombstones_.erase(doc);
+    }
+
+    tombstones_num_ = tombstones_.size();
+
+    return deleted.size();
+}
+
+void inverted_index::start_compaction(ch::milliseconds interval, size_t min_tombstones) {
+    std::lock_guard thread_lock(compaction_thread_mutex_);
+
+    if (compaction_running_) {
+        return;
+    }
+
+    compaction_running_ = true;
+    compaction_thread_ = thread([this, interval, min_tombstones] {
+        std::unique_lock lock(compaction_thread_mutex_);
+
+        while (!compaction_cv_.wait_for(lock, interval, [this] { return !compaction_running_; })) {
+            if (tombstones_num_ < std::max<size_t>(min_tombstones, 1)) {
+                continue;
+            }
+
+            lock.unlock();
+            compact();
+            lock.lock();
+        }
+    });
+}
+
+void inverted_index::stop_compaction() {
+    {
+        std::lock_guard thread_lock(compaction_thread_mutex_);
+
+        if (!compaction_running_) {
+            return;
         }
 
-        ++it;
+        compaction_running_ = false;
     }
+
+    compaction_cv_.notify_all();
+    compaction_thread_.join();
+}
+
+size_t inverted_index::tombstones_num() const {
+    return tombstones_num_;
 }
 
 void inverted_index::clear() {
     write_lock index_write_lock(index_mutex_);
 
-    for (auto& [word, docs] : index_) {
-        write_lock word_lock(index_word_mutexes_.at(word));
+    for (auto& [id, docs] : index_) {
+        write_lock word_lock(index_word_mutexes_.at(id));
 
         docs.clear();
     }
 
     index_.clear();
-    documents_.clear();
+    frequencies_.clear();
+    sorted_terms_stale_ = true;
+
+    {
+        write_lock documents_lock(documents_mutex_);
+
+        documents_.clear();
+        document_terms_.clear();
+        document_lengths_.clear();
+        total_length_ = 0;
+    }
+
+    {
+        write_lock tombstones_lock(tombstones_mutex_);
+
+        tombstones_.clear();
+        tombstones_num_ = 0;
+    }
+
+    ++generation_;
 }
 
 void inverted_index::save_as_json(const string& file_path) const {
     json j;
     read_lock index_read_lock(index_mutex_);
+    read_lock tombstones_lock(tombstones_mutex_);
 
-    for (const auto& [word, docs] : index_) {
-        read_lock word_lock(index_word_mutexes_.at(word));
-        string key = wstring_convert<codecvt_utf8<wchar_t>>().to_bytes(word);
+    for (const auto& [id, docs] : index_) {
+        read_lock word_lock(index_word_mutexes_.at(id));
+        string key = wstring_convert<codecvt_utf8<wchar_t>>().to_bytes(dictionary_->term(id));
 
-        j[key] = docs;
+        if (tombstones_.empty()) {
+            j[key] = docs;
+
+            continue;
+        }
+
+        json live = json::array();
+
+        for (const auto& doc : docs) {
+            if (!tombstones_.contains(doc)) {
+                live.push_back(doc);
+            }
+        }
+
+        if (!live.empty()) {
+            j[key] = std::move(live);
+        }
     }
 
     ofstream file(file_path);
@@ -116,6 +401,126 @@ void inverted_index::save_as_json(const string& file_path) const {
     file << j.dump(2);
 }
 
+// Restores postings written by save_as_json. Term frequencies are not part
+// of that format, so every posting counts once.
+bool inverted_index::load_json(const string& file_path) {
+    ifstream file(file_path);
+
+    if (!file.is_open()) {
+        return false;
+    }
+
+    json j = json::parse(file, nullptr, false);
+
+    if (j.is_discarded() || !j.is_object()) {
+        return false;
+    }
+
+    for (const auto& [key, docs] : j.items()) {
+        add(wstring_convert<codecvt_utf8<wchar_t>>().from_bytes(key), docs.get<documents>());
+    }
+
+    return true;
+}
+
+static constexpr string_view snapshot_magic = "IIX1";
+
+// Unlike save_as_json a snapshot keeps term frequencies, so loading it gives
+// back the same index, BM25 scores included.
+void inverted_index::save_snapshot(const string& file_path) const {
+    string data(snapshot_magic);
+
+    {
+        read_lock index_read_lock(index_mutex_);
+        read_lock tombstones_lock(tombstones_mutex_);
+
+        put_u64(data, index_.size());
+
+        for (const auto& [id, docs] : index_) {
+            read_lock word_lock(index_word_mutexes_.at(id));
+            auto freq = frequencies_.find(id);
+            uint32_t live = 0;
+
+            put_string(data, wstring_convert<codecvt_utf8<wchar_t>>().to_bytes(dictionary_->term(id)));
+
+            size_t count_position = data.size();
+
+            put_u32(data, 0);
+
+            for (const auto& doc : docs) {
+                if (tombstones_.contains(doc)) {
+                    continue;
+                }
+
+                uint32_t count = 1;
+
+                if (freq != frequencies_.end()) {
+                    if (auto f = freq->second.find(doc); f != freq->second.end()) {
+                        count = f->second;
+                    }
+                }
+
+                put_string(data, doc);
+                put_u32(data, count);
+                ++live;
+            }
+
+            std::memcpy(data.data() + count_position, &live, sizeof(live));
+        }
+    }
+
+    if (!write_file_atomically(file_path, data)) {
+        throw std::runtime_error("Cannot write snapshot " + file_path);
+    }
+}
+
+bool inverted_index::load_snapshot(const string& file_path) {
+    auto data = read_whole_file(file_path);
+
+    if (!data || !data->starts_with(snapshot_magic)) {
+        return false;
+    }
+
+    byte_reader reader(string_view(*data).substr(snapshot_magic.size()));
+    term_postings postings;
+    uint64_t terms_num;
+
+    if (!reader.u64(terms_num)) {
+        return false;
+    }
+
+    for (uint64_t t = 0; t < terms_num; ++t) {
+        string term;
+        uint32_t docs_num;
+
+        if (!reader.str(term) || !reader.u32(docs_num)) {
+            return false;
+        }
+
+        document_frequencies docs;
+
+        for (uint32_t d = 0; d < docs_num; ++d) {
+            string doc;
+            uint32_t count;
+
+            if (!reader.str(doc) || !reader.u32(count)) {
+                return false;
+            }
+
+            docs[doc] = count;
+        }
+
+        if (!docs.empty()) {
+            postings.emplace_back(dictionary_->intern(wstring_convert<codecvt_utf8<wchar_t>>().from_bytes(term)),
+                                  std::move(docs));
+        }
+    }
+
+    add(postings);
+
+    return true;
+}
+
 document inverted_index::read(const std::unordered_set<word>& words) const {
     std::unordered_map<document, int> doc_count;
     document most_relevant_doc;
@@ -123,13 +528,20 @@ document inverted_index::read(const std::unordered_set<word>& words) const {
 
     {
         read_lock index_read_lock(index_mutex_);
+        read_lock tombstones_lock(tombstones_mutex_);
+
         for (const auto& w : words) {
-            auto it = index_.find(w);
+            term_id id = dictionary_->find(w);
+            auto it = index_.find(id);
 
             if (it != index_.end()) {
-                read_lock word_lock(index_word_mutexes_.at(w));
+                read_lock word_lock(index_word_mutexes_.at(id));
 
                 for (const auto& doc : it->second) {
+                    if (tombstones_.contains(doc)) {
+                        continue;
+                    }
+
                     int count = ++doc_count[doc];
 
                     if (count > max_count) {
@@ -144,28 +556,392 @@ document inverted_index::read(const std::unordered_set<word>& words) const {
     return most_relevant_doc;
 }
 
-shared_mutex& inverted_index::get_word_mutex(const word& word) {
+// Every distinct term of the batch is looked up and filtered once, then the
+// queries count over those shared lists, split across the pool if one is
+// given. The locks stay held until all queries are done, so the lists point
+// into the index instead of copying it. Must not run on a task of that pool.
+vector<document> inverted_index::read_batch(const vector<unordered_set<word>>& queries, thread_pool* pool) const {
+    vector<document> results(queries.size());
+    vector<vector<const document*>> postings;
+    vector<vector<size_t>> query_postings(queries.size());
+    unordered_map<term_id, size_t> slots;
+    vector<read_lock> word_locks;
+
+    read_lock index_read_lock(index_mutex_);
+    read_lock tombstones_lock(tombstones_mutex_);
+
+    for (size_t q = 0; q < queries.size(); ++q) {
+        for (const auto& w : queries[q]) {
+            term_id id = dictionary_->find(w);
+            auto it = index_.find(id);
+
+            if (it == index_.end()) {
+                continue;
+            }
+
+            auto [slot, inserted] = slots.try_emplace(id, postings.size());
+
+            if (inserted) {
+                auto& list = postings.emplace_back();
+
+                word_locks.emplace_back(index_word_mutexes_.at(id));
+                list.reserve(it->second.size());
+
+                for (const auto& doc : it->second) {
+                    if (!tombstones_.contains(doc)) {
+                        list.push_back(&doc);
+                    }
+                }
+            }
+
+            query_postings[q].push_back(slot->second);
+        }
+    }
+
+    auto evaluate = [&results, &postings, &query_postings](size_t begin, size_t end) {
+        for (size_t q = begin; q < end; ++q) {
+            unordered_map<string_view, int> doc_count;
+            const document* most_relevant_doc = nullptr;
+            int max_count = 0;
+
+            for (auto slot : query_postings[q]) {
+                for (const auto* doc : postings[slot]) {
+                    int count = ++doc_count[*doc];
+
+                    if (count > max_count) {
+                        max_count = count;
+                        most_relevant_doc = doc;
+                    }
+                }
+            }
+
+            if (most_relevant_doc != nullptr) {
+                results[q] = *most_relevant_doc;
+            }
+        }
+
+        return true;
+    };
+
+    size_t chunks = pool == nullptr ? 1 : std::min<size_t>(queries.size(), pool->size() * 4);
+
+    if (chunks <= 1) {
+        evaluate(0, queries.size());
+
+        return results;
+    }
+
+    vector<task_id_t> tasks;
+
+    for (size_t c = 0; c < chunks; ++c) {
+        tasks.push_back(pool->add_task(evaluate, queries.size() * c / chunks, queries.size() * (c + 1) / chunks));
+    }
+
+    for (auto task : tasks) {
+        pool->wait(task);
+    }
+
+    return results;
+}
+
+document inverted_index::read_bm25(const unordered_set<word>& words) const {
+    constexpr double k1 = 1.2;
+    constexpr double b = 0.75;
+
+    unordered_map<document, double> scores;
+    document most_relevant_doc;
+    double max_score = 0;
+
+    read_lock index_read_lock(index_mutex_);
+    read_lock documents_lock(documents_mutex_);
+    read_lock tombstones_lock(tombstones_mutex_);
+
+    if (documents_.empty()) {
+        return most_relevant_doc;
+    }
+
+    auto docs_num = static_cast<double>(documents_.size());
+    double avg_length = total_length_ > 0 ? static_cast<double>(total_length_) / docs_num : 1.0;
+
+    for (const auto& w : words) {
+        term_id id = dictionary_->find(w);
+        auto it = index_.find(id);
+
+        if (it == index_.end()) {
+            continue;
+        }
+
+        read_lock word_lock(index_word_mutexes_.at(id));
+
+        size_t live = it->second.size();
+
+        for (const auto& doc : tombstones_) {
+            live -= it->second.contains(doc);
+        }
+
+        auto df = static_cast<double>(live);
+        double idf = std::log(1.0 + (docs_num - df + 0.5) / (df + 0.5));
+        auto freq = frequencies_.find(id);
+
+        for (const auto& doc : it->second) {
+            if (tombstones_.contains(doc)) {
+                continue;
+            }
+
+            double tf = 1.0;
+            double length = avg_length;
+
+            if (freq != frequencies_.end()) {
+                if (auto f = freq->second.find(doc); f != freq->second.end()) {
+                    tf = f->second;
+                }
+            }
+
+            if (auto l = document_lengths_.find(doc); l != document_lengths_.end() && l->second > 0) {
+                length = l->second;
+            }
+
+            double score = scores[doc] += idf * tf * (k1 + 1) / (tf + k1 * (1 - b + b * length / avg_length));
+
+            if (score > max_score) {
+                max_score = score;
+                most_relevant_doc = doc;
+            }
+        }
+    }
+
+    return most_relevant_doc;
+}
+
+uint32_t inverted_index::term_frequency(const word& word, const document& doc) const {
+    term_id id = dictionary_->find(word);
+    read_lock index_read_lock(index_mutex_);
+    auto it = index_.find(id);
+
+    if (it == index_.end()) {
+        return 0;
+    }
+
+    read_lock word_lock(index_word_mutexes_.at(id));
+    read_lock tombstones_lock(tombstones_mutex_);
+
+    if (!it->second.contains(doc) || tombstones_.contains(doc)) {
+        return 0;
+    }
+
+    if (auto freq = frequencies_.find(id); freq != frequencies_.end()) {
+        if (auto f = freq->second.find(doc); f != freq->second.end()) {
+            return f->second;
+        }
+    }
+
+    return 1;
+}
+
+uint32_t inverted_index::document_length(const document& doc) const {
+    read_lock documents_lock(documents_mutex_);
+    auto it = document_lengths_.find(doc);
+
+    return it != document_lengths_.end() ? it->second : 0;
+}
+
+bool inverted_index::contains_document(const document& doc) const {
+    read_lock documents_lock(documents_mutex_);
+
+    return documents_.contains(doc);
+}
+
+uint64_t inverted_index::generation() const {
+    return generation_;
+}
+
+term_dictionary* inverted_index::dictionary() const {
+    return dictionary_;
+}
+
+vector<word> inverted_index::expand_prefix(const word& prefix) const {
+    return to_words(get_sorted_terms()->prefix(prefix));
+}
+
+vector<word> inverted_index::expand_wildcard(const word& pattern) const {
+    return to_words(get_sorted_terms()->wildcard(pattern));
+}
+
+vector<word> inverted_index::expand_range(const word& from, const word& to) const {
+    return to_words(get_sorted_terms()->range(from, to));
+}
+
+shared_mutex& inverted_index::get_word_mutex(term_id id) {
     write_lock word_mutexes_lock(index_word_mutexes_mutex_);
 
-    return index_word_mutexes_[word];
+    return index_word_mutexes_[id];
 }
 
-void inverted_index::add_documents_to_word(const word& word, const documents& docs) {
+void inverted_index::add_documents_to_word(term_id id, const documents& docs) {
+    if (tombstones_num_ > 0) {
+        for (const auto& doc : docs) {
+            revive(doc);
+        }
+    }
+
     {
         write_lock index_write_lock(index_mutex_);
 
-        if (!index_.contains(word)) {
-            index_[word] = documents();
+        if (!index_.contains(id)) {
+            index_[id] = documents();
+            sorted_terms_stale_ = true;
         }
 
-        write_lock word_lock(get_word_mutex(word));
+        write_lock word_lock(get_word_mutex(id));
 
         for (const auto& doc : docs) {
-            index_[word].insert(doc);
+            bool inserted = index_[id].insert(doc).second;
 
             unique_lock documents_lock(documents_mutex_);
 
             documents_.insert(doc);
+
+            if (inserted) {
+                document_terms_[doc].push_back(id);
+                ++document_lengths_[doc];
+                ++total_length_;
+            }
+        }
+    }
+
+    ++generation_;
+}
+
+// A deleted document that comes back must not inherit the postings of its
+// old version, those are purged right away. Only its own terms are touched.
+void inverted_index::revive(const document& doc) {
+    if (tombstones_num_ == 0) {
+        return;
+    }
+
+    {
+        read_lock tombstones_lock(tombstones_mutex_);
+
+        if (!tombstones_.contains(doc)) {
+            return;
+        }
+    }
+
+    std::lock_guard compaction_lock(compaction_mutex_);
+
+    {
+        read_lock tombstones_lock(tombstones_mutex_);
+
+        // a compaction may have purged it while we waited
+        if (!tombstones_.contains(doc)) {
+            return;
+        }
+    }
+
+    purge({doc}, default_compaction_batch);
+
+    write_lock tombstones_lock(tombstones_mutex_);
+
+    tombstones_.erase(doc);
+    tombstones_num_ = tombstones_.size();
+}
+
+// Walks whichever side is smaller, postings or the documents to erase.
+template<typename Container>
+static void erase_documents(Container& container, const documents& docs) {
+    if (docs.size() <= container.size()) {
+        for (const auto& doc : docs) {
+            container.erase(doc);
+        }
+
+        return;
+    }
+
+    std::erase_if(container, [&docs](const auto& entry) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(entry)>, document>) {
+            return docs.contains(entry);
+        } else {
+            return docs.contains(entry.first);
+        }
+    });
+}
+
+void inverted_index::purge(const documents& docs, size_t batch_size) {
+    vector<term_id> ids;
+
+    {
+        write_lock documents_lock(documents_mutex_);
+
+        for (const auto& doc : docs) {
+            if (auto it = document_terms_.find(doc); it != document_terms_.end()) {
+                ids.insert(ids.end(), it->second.begin(), it->second.end());
+                document_terms_.erase(it);
+            }
         }
     }
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    batch_size = std::max<size_t>(batch_size, 1);
+
+    for (size_t begin = 0; begin < ids.size(); begin += batch_size) {
+        write_lock index_write_lock(index_mutex_);
+
+        for (size_t i = begin; i < std::min(begin + batch_size, ids.size()); ++i) {
+            auto it = index_.find(ids[i]);
+
+            if (it == index_.end()) {
+                continue;
+            }
+
+            write_lock word_lock(index_word_mutexes_.at(it->first));
+
+            erase_documents(it->second, docs);
+
+            if (auto freq = frequencies_.find(it->first); freq != frequencies_.end()) {
+                erase_documents(freq->second, docs);
+
+                if (freq->second.empty()) {
+                    frequencies_.erase(freq);
+                }
+            }
+
+            if (it->second.empty()) {
+                index_.erase(it);
+                sorted_terms_stale_ = true;
+            }
+        }
+    }
+}
+
+shared_ptr<const front_coded_dictionary> inverted_index::get_sorted_terms() const {
+    std::lock_guard sorted_terms_lock(sorted_terms_mutex_);
+
+    if (sorted_terms_stale_.exchange(false) || !sorted_terms_) {
+        sorted_terms terms;
+        read_lock index_read_lock(index_mutex_);
+
+        terms.reserve(index_.size());
+
+        for (const auto& [id, docs] : index_) {
+            terms.emplace_back(dictionary_->term(id), id);
+        }
+
+        sorted_terms_ = std::make_shared<const front_coded_dictionary>(std::move(terms));
+    }
+
+    return sorted_terms_;
+}
+
+vector<word> inverted_index::to_words(const sorted_terms& terms) {
+    vector<word> result;
+
+    result.reserve(terms.size());
+
+    for (const auto& [term, id] : terms) {
+        result.push_back(term);
+    }
+
+    return result;
 }
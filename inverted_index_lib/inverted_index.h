@@ -1,11 +1,23 @@
 #ifndef INVERTED_INDEX_H
 #define INVERTED_INDEX_H
 
+#include "term_dictionary.h"
+#include "front_coded_dictionary.h"
+#include "../thread_pool_lib/thread_pool.h"
+
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
 
 using std::shared_mutex;
 using std::unique_lock;
@@ -14,41 +26,114 @@ using std::unordered_map;
 using std::unordered_set;
 using std::string;
 using std::wstring;
+using std::vector;
+using std::pair;
+using std::unique_ptr;
+using std::shared_ptr;
+using std::atomic;
+using std::thread;
+using std::condition_variable;
+
+namespace ch = std::chrono;
 
 using word = wstring;
 using document = string;
 using documents = unordered_set<document>;
 using inv_index = unordered_map<word, documents>;
+using term_index = unordered_map<term_id, documents>;
+using term_frequency = pair<word, uint32_t>;
+using term_frequencies = vector<term_frequency>;
+using document_frequencies = unordered_map<document, uint32_t>;
+using term_postings = vector<pair<term_id, document_frequencies>>;
 using read_lock = shared_lock<shared_mutex>;
 using write_lock = unique_lock<shared_mutex>;
 
 class inverted_index {
 public:
-    inverted_index();
+    explicit inverted_index(term_dictionary* dictionary = nullptr);
     ~inverted_index();
 
     void add(const word& word, const document& document);
     void add(const word& word, const documents& docs);
+    void add(term_id id, const documents& docs);
     void add(const inv_index& idx);
-    const documents& find(const word& word) const;
+    void add(const term_index& idx);
+    void add(const document& document, const term_frequencies& terms);
+    void add(const document& document, const term_id_frequencies& terms);
+    void add(const term_postings& postings);
+    documents find(const word& word) const;
+    documents find(term_id id) const;
     bool contains(const word& word) const;
     void remove_word(const word& word);
     void remove_document_from_all_records(const document& doc);
+    size_t compact(size_t batch_size = default_compaction_batch);
+    void start_compaction(ch::milliseconds interval, size_t min_tombstones = 1);
+    void stop_compaction();
+    [[nodiscard]] size_t tombstones_num() const;
     void clear();
     void save_as_json(const string& file_path) const;
+    bool load_json(const string& file_path);
+    void save_snapshot(const string& file_path) const;
+    bool load_snapshot(const string& file_path);
     document read(const unordered_set<word>& words) const;
+    document read_bm25(const unordered_set<word>& words) const;
+    vector<document> read_batch(const vector<unordered_set<word>>& queries, thread_pool* pool = nullptr) const;
+    uint32_t term_frequency(const word& word, const document& doc) const;
+    uint32_t document_length(const document& doc) const;
+    [[nodiscard]] bool contains_document(const document& doc) const;
+    // bumped after every change that can alter query results
+    [[nodiscard]] uint64_t generation() const;
+    [[nodiscard]] term_dictionary* dictionary() const;
+    vector<word> expand_prefix(const word& prefix) const;
+    vector<word> expand_wildcard(const word& pattern) const;
+    vector<word> expand_range(const word& from, const word& to) const;
+
+    static constexpr size_t default_compaction_batch = 4096;
 
 private:
-    inv_index index_;
+    unique_ptr<term_dictionary> own_dictionary_;
+    term_dictionary* dictionary_ = nullptr;
+
+    term_index index_;
     mutable shared_mutex index_mutex_;
-    mutable unordered_map<word, shared_mutex> index_word_mutexes_;
+    mutable unordered_map<term_id, shared_mutex> index_word_mutexes_;
     mutable shared_mutex index_word_mutexes_mutex_;
 
+    unordered_map<term_id, document_frequencies> frequencies_;
+
     documents documents_;
+    // terms of every document, so deleting one touches only its own postings
+    unordered_map<document, vector<term_id>> document_terms_;
+    document_frequencies document_lengths_;
+    uint64_t total_length_ = 0;
     mutable shared_mutex documents_mutex_;
 
-    shared_mutex& get_word_mutex(const word& word);
-    void add_documents_to_word(const word& word, const documents& docs);
+    // Deleted documents whose postings are still in index_. Queries skip them
+    // until compaction purges the postings; adding a deleted document again
+    // purges its old postings first, so they cannot come back with it.
+    documents tombstones_;
+    mutable shared_mutex tombstones_mutex_;
+    atomic<size_t> tombstones_num_ = 0;
+    atomic<uint64_t> generation_ = 0;
+    std::mutex compaction_mutex_;
+
+    thread compaction_thread_;
+    bool compaction_running_ = false;
+    std::mutex compaction_thread_mutex_;
+    condition_variable compaction_cv_;
+
+    // sorted snapshot of the indexed terms for prefix, range and wildcard lookups,
+    // held on top of the dictionary and rebuilt on the first lookup after the term set changes
+    mutable shared_ptr<const front_coded_dictionary> sorted_terms_;
+    mutable std::mutex sorted_terms_mutex_;
+    mutable atomic<bool> sorted_terms_stale_ = true;
+
+    shared_mutex& get_word_mutex(term_id id);
+    void add_documents_to_word(term_id id, const documents& docs);
+    void revive(const document& doc);
+    void purge(const documents& docs, size_t batch_size);
+    shared_ptr<const front_coded_dictionary> get_sorted_terms() const;
+    static vector<word> to_words(const sorted_terms& terms);
 };
 
 #endif
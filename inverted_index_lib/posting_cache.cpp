@@ -0,0 +1,100 @@
+#include "posting_cache.h"
+#include <functional>
+
+// the sketch is sized for lists of about 64 postings
+posting_cache::posting_cache(size_t budget_bytes)
+        : budget_(budget_bytes), sketch_(budget_bytes / (64 * sizeof(segment_posting)) + 1) {}
+
+posting_cache::postings_ptr posting_cache::find(const index_segment* segment, term_id id) {
+    key k{segment, id};
+    std::lock_guard lock(cache_mutex_);
+
+    sketch_.record(key_hash{}(k));
+
+    auto it = entries_.find(k);
+
+    if (it == entries_.end()) {
+        ++stats_.misses;
+
+        return nullptr;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    ++stats_.hits;
+
+    return it->second->postings;
+}
+
+void posting_cache::insert(const index_segment* segment, term_id id, postings_ptr postings) {
+    key k{segment, id};
+    size_t bytes = bytes_of(*postings);
+    std::lock_guard lock(cache_mutex_);
+
+    if (entries_.contains(k)) {
+        return;
+    }
+
+    if (bytes > budget_) {
+        ++stats_.rejected;
+
+        return;
+    }
+
+    // the victims are only evicted if the new list beats every one of them
+    auto frequency = sketch_.estimate(key_hash{}(k));
+    size_t freed = 0;
+    size_t victims = 0;
+
+    for (auto it = lru_.rbegin(); stats_.bytes - freed + bytes > budget_; ++it, ++victims) {
+        if (sketch_.estimate(key_hash{}(it->k)) >= frequency) {
+            ++stats_.rejected;
+
+            return;
+        }
+
+        freed += it->bytes;
+    }
+
+    for (; victims > 0; --victims) {
+        entries_.erase(lru_.back().k);
+        stats_.bytes -= lru_.back().bytes;
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+
+    lru_.push_front({k, std::move(postings), bytes});
+    entries_.emplace(k, lru_.begin());
+    stats_.bytes += bytes;
+}
+
+void posting_cache::forget(const index_segment* segment) {
+    std::lock_guard lock(cache_mutex_);
+
+    for (auto it = lru_.begin(); it != lru_.end();) {
+        if (it->k.segment == segment) {
+            entries_.erase(it->k);
+            stats_.bytes -= it->bytes;
+            it = lru_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+posting_cache_stats posting_cache::stats() const {
+    std::lock_guard lock(cache_mutex_);
+    auto result = stats_;
+
+    result.entries = entries_.size();
+
+    return result;
+}
+
+size_t posting_cache::key_hash::operator()(const key& k) const {
+    return std::hash<const void*>{}(k.segment) * 31 + k.id;
+}
+
+// the list itself plus a rough share for the node and the map slot
+size_t posting_cache::bytes_of(const vector<segment_posting>& postings) {
+    return postings.capacity() * sizeof(segment_posting) + sizeof(entry) + 64;
+}
@@ -0,0 +1,74 @@
+#ifndef INVERTED_INDEX_LIB_POSTING_CACHE_H
+#define INVERTED_INDEX_LIB_POSTING_CACHE_H
+
+#include "index_segment.h"
+#include "frequency_sketch.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using std::list;
+using std::shared_ptr;
+using std::unordered_map;
+using std::vector;
+
+struct posting_cache_stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    // decoded lists the admission filter kept out
+    uint64_t rejected = 0;
+    size_t bytes = 0;
+    size_t entries = 0;
+};
+
+// Decoded postings of mapped segments, bounded by a byte budget. Admission is
+// TinyLFU: a list that needs room only gets in when it is asked for more
+// often than every LRU entry it would push out, so one scan over cold terms
+// cannot flush the hot, long lists out of memory.
+class posting_cache {
+public:
+    using postings_ptr = shared_ptr<const vector<segment_posting>>;
+
+    explicit posting_cache(size_t budget_bytes);
+
+    postings_ptr find(const index_segment* segment, term_id id);
+    void insert(const index_segment* segment, term_id id, postings_ptr postings);
+    // Drops the lists of a segment that is going away.
+    void forget(const index_segment* segment);
+    [[nodiscard]] posting_cache_stats stats() const;
+
+private:
+    struct key {
+        const index_segment* segment;
+        term_id id;
+
+        bool operator==(const key& other) const = default;
+    };
+
+    struct key_hash {
+        size_t operator()(const key& k) const;
+    };
+
+    struct entry {
+        key k;
+        postings_ptr postings;
+        size_t bytes;
+    };
+
+    size_t budget_;
+    // lookups are a hash probe and a splice, one mutex is enough next to the decoding they save
+    mutable std::mutex cache_mutex_;
+    list<entry> lru_;
+    unordered_map<key, list<entry>::iterator, key_hash> entries_;
+    frequency_sketch sketch_;
+    posting_cache_stats stats_;
+
+    static size_t bytes_of(const vector<segment_posting>& postings);
+};
+
+#endif
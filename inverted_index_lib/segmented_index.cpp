@@ -0,0 +1,434 @@
+#include "segmented_index.h"
+#include <algorithm>
+#include <limits>
+#include <string_view>
+
+using std::string_view;
+
+double segment_stats::write_amplification() const {
+    return flushed_postings > 0 ? static_cast<double>(flushed_postings + merged_postings) / flushed_postings : 0;
+}
+
+segmented_index::segmented_index(term_dictionary* dictionary, thread_pool* pool, const segment_config& config)
+        : dictionary_(dictionary), pool_(pool), config_(config), cache_(config.posting_cache_bytes) {
+    if (dictionary_ == nullptr) {
+        own_dictionary_ = std::make_unique<term_dictionary>();
+        dictionary_ = own_dictionary_.get();
+    }
+
+    config_.flush_postings = std::max<size_t>(config_.flush_postings, 1);
+    config_.merge_factor = std::max<size_t>(config_.merge_factor, 2);
+
+    if (!config_.directory.empty()) {
+        fs::create_directories(config_.directory);
+    }
+}
+
+segmented_index::~segmented_index() {
+    wait_merges();
+
+    for (const auto& segment : segments_) {
+        if (segment->is_mapped()) {
+            std::error_code error;
+
+            fs::remove(segment->path(), error);
+        }
+    }
+}
+
+void segmented_index::add(const document& document, const term_id_frequencies& terms) {
+    bool full;
+
+    {
+        write_lock state_lock(state_mutex_);
+        auto& document_terms = buffer_documents_[document];
+
+        for (const auto& [id, count] : terms) {
+            auto [it, inserted] = buffer_[id].try_emplace(document, 0);
+
+            it->second += count;
+
+            if (inserted) {
+                document_terms.push_back(id);
+                ++buffer_postings_;
+            }
+        }
+
+        full = buffer_postings_ >= config_.flush_postings;
+    }
+
+    if (full) {
+        flush();
+    }
+}
+
+void segmented_index::add(const document& document, const term_frequencies& terms) {
+    term_id_frequencies ids;
+
+    ids.reserve(terms.size());
+
+    for (const auto& [word, count] : terms) {
+        ids.emplace_back(dictionary_->intern(word), count);
+    }
+
+    add(document, ids);
+}
+
+// The buffered postings are dropped right away, the ones already in segments
+// die with the tombstone.
+void segmented_index::remove(const document& document) {
+    write_lock state_lock(state_mutex_);
+
+    if (auto it = buffer_documents_.find(document); it != buffer_documents_.end()) {
+        for (auto id : it->second) {
+            auto postings = buffer_.find(id);
+
+            postings->second.erase(document);
+            --buffer_postings_;
+
+            if (postings->second.empty()) {
+                buffer_.erase(postings);
+            }
+        }
+
+        buffer_documents_.erase(it);
+    }
+
+    if (!segments_.empty() || frozen_) {
+        tombstones_[document] = generation_;
+    }
+}
+
+// The buffer stays visible to queries as frozen_ while its segment is built.
+void segmented_index::flush() {
+    std::lock_guard flush_lock(flush_mutex_);
+    shared_ptr<const index_segment::buffer> frozen;
+    uint64_t generation;
+
+    {
+        write_lock state_lock(state_mutex_);
+
+        if (buffer_.empty()) {
+            return;
+        }
+
+        frozen_ = std::make_shared<const index_segment::buffer>(std::move(buffer_));
+        frozen = frozen_;
+        generation = frozen_generation_ = generation_++;
+        buffer_ = {};
+        buffer_documents_.clear();
+        buffer_postings_ = 0;
+    }
+
+    auto segment = to_disk(index_segment::build(generation, *frozen));
+
+    {
+        write_lock state_lock(state_mutex_);
+
+        segments_.push_back(segment);
+        frozen_.reset();
+        prune_tombstones();
+    }
+
+    ++flushes_;
+    flushed_postings_ += segment->postings_num();
+
+    schedule_merge();
+}
+
+void segmented_index::wait_merges() {
+    std::unique_lock merge_lock(merge_mutex_);
+
+    merge_cv_.wait(merge_lock, [this] {
+        return !merging_;
+    });
+}
+
+documents segmented_index::find(const word& word) const {
+    return find(dictionary_->find(word));
+}
+
+documents segmented_index::find(term_id id) const {
+    documents docs;
+    read_lock state_lock(state_mutex_);
+
+    for_each_posting(id, [&docs](const document& doc, uint32_t) {
+        docs.insert(doc);
+    });
+
+    return docs;
+}
+
+// Names are counted as views into the segments' document tables and the
+// buffer, which the state lock keeps alive, so a query copies no strings.
+document segmented_index::read(const unordered_set<word>& words) const {
+    unordered_map<string_view, int> doc_count;
+    unordered_set<string_view> matched;
+    string_view most_relevant_doc;
+    int max_count = 0;
+    read_lock state_lock(state_mutex_);
+
+    for (const auto& w : words) {
+        matched.clear();
+
+        for_each_posting(dictionary_->find(w), [&matched](const document& doc, uint32_t) {
+            matched.insert(doc);
+        });
+
+        for (auto doc : matched) {
+            int count = ++doc_count[doc];
+
+            if (count > max_count) {
+                max_count = count;
+                most_relevant_doc = doc;
+            }
+        }
+    }
+
+    return document(most_relevant_doc);
+}
+
+uint32_t segmented_index::term_frequency(const word& word, const document& doc) const {
+    uint32_t frequency = 0;
+    read_lock state_lock(state_mutex_);
+
+    for_each_posting(dictionary_->find(word), [&frequency, &doc](const document& posting_doc, uint32_t count) {
+        if (posting_doc == doc) {
+            frequency += count;
+        }
+    });
+
+    return frequency;
+}
+
+segment_stats segmented_index::stats() const {
+    read_lock state_lock(state_mutex_);
+
+    return {
+        segments_.size(),
+        buffer_postings_,
+        tombstones_.size(),
+        flushes_,
+        merges_,
+        flushed_postings_,
+        merged_postings_
+    };
+}
+
+posting_cache_stats segmented_index::cache_stats() const {
+    return cache_.stats();
+}
+
+term_dictionary* segmented_index::dictionary() const {
+    return dictionary_;
+}
+
+bool segmented_index::is_dead(const document& doc, uint64_t generation) const {
+    auto it = tombstones_.find(doc);
+
+    return it != tombstones_.end() && generation < it->second;
+}
+
+size_t segmented_index::tier(const index_segment& segment) const {
+    size_t t = 0;
+    size_t bound = config_.flush_postings * config_.merge_factor;
+
+    while (segment.postings_num() >= bound) {
+        ++t;
+        bound *= config_.merge_factor;
+    }
+
+    return t;
+}
+
+// The oldest merge_factor segments of the lowest tier that has that many.
+vector<segmented_index::segment_ptr> segmented_index::pick_merge() const {
+    unordered_map<size_t, vector<segment_ptr>> tiers;
+
+    for (const auto& segment : segments_) {
+        tiers[tier(*segment)].push_back(segment);
+    }
+
+    vector<segment_ptr> inputs;
+    size_t lowest = std::numeric_limits<size_t>::max();
+
+    for (auto& [t, segments] : tiers) {
+        if (segments.size() >= config_.merge_factor && t < lowest) {
+            lowest = t;
+            inputs = std::move(segments);
+        }
+    }
+
+    std::sort(inputs.begin(), inputs.end(), [](const segment_ptr& lhs, const segment_ptr& rhs) {
+        return lhs->generation() < rhs->generation();
+    });
+
+    inputs.resize(std::min(inputs.size(), config_.merge_factor));
+
+    return inputs;
+}
+
+void segmented_index::schedule_merge() {
+    {
+        std::lock_guard merge_lock(merge_mutex_);
+
+        if (merging_) {
+            return;
+        }
+
+        merging_ = true;
+    }
+
+    if (pool_ == nullptr) {
+        merge_task();
+
+        return;
+    }
+
+    pool_->add_detached_task([this] {
+        merge_task();
+
+        return true;
+    });
+}
+
+// Merges until no tier is full. Flushes that finish meanwhile find merging_
+// set and leave their segments to this task.
+void segmented_index::merge_task() {
+    while (true) {
+        vector<segment_ptr> inputs;
+        unordered_map<document, uint64_t> tombstones;
+
+        {
+            read_lock state_lock(state_mutex_);
+
+            inputs = pick_merge();
+            tombstones = tombstones_;
+        }
+
+        if (inputs.empty()) {
+            std::lock_guard merge_lock(merge_mutex_);
+            read_lock state_lock(state_mutex_);
+
+            if (!pick_merge().empty()) {
+                continue;
+            }
+
+            merging_ = false;
+            merge_cv_.notify_all();
+
+            return;
+        }
+
+        // tombstones added meanwhile are newer than every input, they still apply to the merged segment
+        auto merged = to_disk(index_segment::merge(inputs, [&tombstones](const document& doc, uint64_t generation) {
+            auto it = tombstones.find(doc);
+
+            return it != tombstones.end() && generation < it->second;
+        }));
+
+        {
+            write_lock state_lock(state_mutex_);
+
+            std::erase_if(segments_, [&inputs](const segment_ptr& segment) {
+                return std::find(inputs.begin(), inputs.end(), segment) != inputs.end();
+            });
+
+            segments_.push_back(merged);
+            prune_tombstones();
+
+            // no query holds the inputs now, their cached lists and files can go
+            for (const auto& input : inputs) {
+                cache_.forget(input.get());
+
+                if (input->is_mapped()) {
+                    std::error_code error;
+
+                    fs::remove(input->path(), error);
+                }
+            }
+        }
+
+        ++merges_;
+        merged_postings_ += merged->postings_num();
+    }
+}
+
+segmented_index::segment_ptr segmented_index::to_disk(const segment_ptr& segment) {
+    if (config_.directory.empty()) {
+        return segment;
+    }
+
+    auto path = config_.directory / ("segment-" + std::to_string(next_file_++) + ".seg");
+
+    segment->save(path);
+
+    return index_segment::open(path);
+}
+
+// A tombstone is needed while some segment is older than it.
+void segmented_index::prune_tombstones() {
+    uint64_t oldest = generation_;
+
+    for (const auto& segment : segments_) {
+        oldest = std::min(oldest, segment->generation());
+    }
+
+    if (frozen_) {
+        oldest = std::min(oldest, frozen_generation_);
+    }
+
+    std::erase_if(tombstones_, [oldest](const auto& tombstone) {
+        return tombstone.second <= oldest;
+    });
+}
+
+template<typename F>
+void segmented_index::for_each_posting(term_id id, F&& on_posting) const {
+    if (id == term_dictionary::no_term) {
+        return;
+    }
+
+    for (const auto& segment : segments_) {
+        auto visit = [&](span<const segment_posting> postings) {
+            for (const auto& posting : postings) {
+                const document& doc = segment->document_name(posting.document);
+
+                if (!is_dead(doc, segment->generation())) {
+                    on_posting(doc, posting.count);
+                }
+            }
+        };
+
+        if (!segment->is_mapped()) {
+            visit(segment->postings(id));
+
+            continue;
+        }
+
+        auto postings = cache_.find(segment.get(), id);
+
+        if (!postings) {
+            postings = std::make_shared<const vector<segment_posting>>(segment->decode(id));
+            cache_.insert(segment.get(), id, postings);
+        }
+
+        visit(*postings);
+    }
+
+    if (frozen_) {
+        if (auto it = frozen_->find(id); it != frozen_->end()) {
+            for (const auto& [doc, count] : it->second) {
+                if (!is_dead(doc, frozen_generation_)) {
+                    on_posting(doc, count);
+                }
+            }
+        }
+    }
+
+    if (auto it = buffer_.find(id); it != buffer_.end()) {
+        for (const auto& [doc, count] : it->second) {
+            on_posting(doc, count);
+        }
+    }
+}
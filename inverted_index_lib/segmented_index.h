@@ -0,0 +1,137 @@
+#ifndef INVERTED_INDEX_LIB_SEGMENTED_INDEX_H
+#define INVERTED_INDEX_LIB_SEGMENTED_INDEX_H
+
+#include "inverted_index.h"
+#include "index_segment.h"
+#include "posting_cache.h"
+#include "../thread_pool_lib/thread_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using std::atomic;
+using std::condition_variable;
+using std::shared_ptr;
+using std::shared_mutex;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+
+struct segment_config {
+    // buffered postings that trigger a flush into a segment
+    size_t flush_postings = 64 * 1024;
+    // segments of one tier that get merged into one segment of the next
+    size_t merge_factor = 4;
+    // if set, segments are written here and served memory-mapped
+    fs::path directory;
+    // decoded postings of mapped segments kept in memory
+    size_t posting_cache_bytes = 64 * 1024 * 1024;
+};
+
+struct segment_stats {
+    size_t segments = 0;
+    size_t buffered_postings = 0;
+    size_t tombstones = 0;
+    uint64_t flushes = 0;
+    uint64_t merges = 0;
+    uint64_t flushed_postings = 0;
+    uint64_t merged_postings = 0;
+
+    // postings written to segments per posting added, flushes and merges together
+    [[nodiscard]] double write_amplification() const;
+};
+
+// An index built from immutable segments. Adds go to a mutable buffer that
+// is flushed into a sorted segment once it holds flush_postings postings,
+// queries fan out over the buffer and every segment. Segments are tiered by
+// size, tier t holding about flush_postings * merge_factor^t postings; when a
+// tier collects merge_factor segments they are merged into one on the pool.
+// That keeps every posting rewritten about once per tier and the number of
+// segments a query visits logarithmic in the index size.
+//
+// Deletes record the generation of the current buffer: a document is dead in
+// every older segment, while a later add of the same document lives on in
+// newer ones. Merges drop dead postings.
+//
+// With a directory, every flushed or merged segment is saved there and
+// mapped back, and queries decode its postings through the posting cache.
+// The files only live as long as the index.
+class segmented_index {
+public:
+    explicit segmented_index(
+            term_dictionary* dictionary = nullptr,
+            thread_pool* pool = nullptr,
+            const segment_config& config = {}
+    );
+    ~segmented_index();
+
+    segmented_index(const segmented_index&) = delete;
+    segmented_index& operator=(const segmented_index&) = delete;
+
+    void add(const document& document, const term_id_frequencies& terms);
+    void add(const document& document, const term_frequencies& terms);
+    void remove(const document& document);
+    void flush();
+    void wait_merges();
+
+    [[nodiscard]] documents find(const word& word) const;
+    [[nodiscard]] documents find(term_id id) const;
+    [[nodiscard]] document read(const unordered_set<word>& words) const;
+    [[nodiscard]] uint32_t term_frequency(const word& word, const document& doc) const;
+    [[nodiscard]] segment_stats stats() const;
+    [[nodiscard]] posting_cache_stats cache_stats() const;
+    [[nodiscard]] term_dictionary* dictionary() const;
+
+private:
+    using segment_ptr = shared_ptr<const index_segment>;
+
+    unique_ptr<term_dictionary> own_dictionary_;
+    term_dictionary* dictionary_ = nullptr;
+    thread_pool* pool_ = nullptr;
+    segment_config config_;
+
+    // buffer_, frozen_, segments_ and tombstones_ change together under state_mutex_
+    index_segment::buffer buffer_;
+    unordered_map<document, vector<term_id>> buffer_documents_;
+    size_t buffer_postings_ = 0;
+    uint64_t generation_ = 0;
+    shared_ptr<const index_segment::buffer> frozen_;
+    uint64_t frozen_generation_ = 0;
+    vector<segment_ptr> segments_;
+    unordered_map<document, uint64_t> tombstones_;
+    mutable shared_mutex state_mutex_;
+
+    std::mutex flush_mutex_;
+
+    mutable posting_cache cache_;
+    atomic<uint64_t> next_file_ = 0;
+
+    bool merging_ = false;
+    std::mutex merge_mutex_;
+    condition_variable merge_cv_;
+
+    atomic<uint64_t> flushes_ = 0;
+    atomic<uint64_t> merges_ = 0;
+    atomic<uint64_t> flushed_postings_ = 0;
+    atomic<uint64_t> merged_postings_ = 0;
+
+    [[nodiscard]] bool is_dead(const document& doc, uint64_t generation) const;
+    [[nodiscard]] size_t tier(const index_segment& segment) const;
+    [[nodiscard]] vector<segment_ptr> pick_merge() const;
+    void schedule_merge();
+    void merge_task();
+    void prune_tombstones();
+    [[nodiscard]] segment_ptr to_disk(const segment_ptr& segment);
+
+    template<typename F>
+    void for_each_posting(term_id id, F&& on_posting) const;
+};
+
+#endif
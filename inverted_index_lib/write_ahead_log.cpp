@@ -0,0 +1,228 @@
+#include "write_ahead_log.h"
+#include "binary_io.h"
+#include <cerrno>
+#include <chrono>
+#include <codecvt>
+#include <locale>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+using std::runtime_error;
+using std::wstring_convert;
+using std::codecvt_utf8;
+
+write_ahead_log::write_ahead_log(const fs::path& file_path, uint64_t next_lsn, const wal_config& config)
+        : config_(config), next_lsn_(std::max<uint64_t>(next_lsn, 1)), durable_lsn_(next_lsn_ - 1) {
+    fd_ = open(file_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    if (fd_ < 0) {
+        throw runtime_error("Cannot open write-ahead log " + file_path.string());
+    }
+
+    committer_ = thread(&write_ahead_log::commit_loop, this);
+}
+
+write_ahead_log::~write_ahead_log() {
+    {
+        std::lock_guard lock(mutex_);
+
+        stopping_ = true;
+    }
+
+    appended_cv_.notify_all();
+    committer_.join();
+    close(fd_);
+}
+
+uint64_t write_ahead_log::append_add(const document& doc, const term_frequencies& terms) {
+    return append(WAL_ADD, doc, &terms);
+}
+
+uint64_t write_ahead_log::append_remove(const document& doc) {
+    return append(WAL_REMOVE, doc, nullptr);
+}
+
+// Frame: payload size, payload checksum, payload (lsn, type, document and for
+// adds the terms as UTF-8 with their counts).
+uint64_t write_ahead_log::append(wal_record_type type, const document& doc, const term_frequencies* terms) {
+    string payload;
+
+    put_u64(payload, 0);
+    put_u8(payload, type);
+    put_string(payload, doc);
+
+    if (terms != nullptr) {
+        put_u32(payload, static_cast<uint32_t>(terms->size()));
+
+        for (const auto& [term, count] : *terms) {
+            put_string(payload, wstring_convert<codecvt_utf8<wchar_t>>().to_bytes(term));
+            put_u32(payload, count);
+        }
+    }
+
+    uint64_t lsn;
+
+    {
+        std::lock_guard lock(mutex_);
+
+        lsn = next_lsn_++;
+        std::memcpy(payload.data(), &lsn, sizeof(lsn));
+        put_u32(pending_, static_cast<uint32_t>(payload.size()));
+        put_u32(pending_, checksum(payload));
+        pending_ += payload;
+    }
+
+    appended_cv_.notify_one();
+
+    return lsn;
+}
+
+void write_ahead_log::wait_durable(uint64_t lsn) {
+    std::unique_lock lock(mutex_);
+
+    durable_cv_.wait(lock, [this, lsn] {
+        return durable_lsn_ >= lsn || failed_;
+    });
+
+    if (durable_lsn_ < lsn) {
+        throw runtime_error("Write-ahead log write failed");
+    }
+}
+
+void write_ahead_log::truncate() {
+    wait_durable(last_lsn());
+
+    std::lock_guard lock(mutex_);
+
+    if (ftruncate(fd_, 0) != 0 || (config_.sync && fdatasync(fd_) != 0)) {
+        throw runtime_error("Cannot truncate write-ahead log");
+    }
+}
+
+uint64_t write_ahead_log::last_lsn() const {
+    std::lock_guard lock(mutex_);
+
+    return next_lsn_ - 1;
+}
+
+uint64_t write_ahead_log::syncs() const {
+    return syncs_;
+}
+
+vector<wal_record> write_ahead_log::read(const fs::path& file_path, uint64_t& valid_size) {
+    vector<wal_record> records;
+    auto data = read_whole_file(file_path.string());
+
+    valid_size = 0;
+
+    if (!data) {
+        return records;
+    }
+
+    byte_reader frames(*data);
+
+    while (!frames.at_end()) {
+        uint32_t size;
+        uint32_t sum;
+        string_view payload;
+
+        if (!frames.u32(size) || !frames.u32(sum) || !frames.bytes(size, payload) || checksum(payload) != sum) {
+            break;
+        }
+
+        byte_reader reader(payload);
+        wal_record record;
+        uint8_t type;
+
+        if (!reader.u64(record.lsn) || !reader.u8(type) || !reader.str(record.doc)) {
+            break;
+        }
+
+        record.type = static_cast<wal_record_type>(type);
+
+        if (record.type == WAL_ADD) {
+            uint32_t terms_num;
+            bool complete = reader.u32(terms_num);
+
+            for (uint32_t t = 0; complete && t < terms_num; ++t) {
+                string term;
+                uint32_t count;
+
+                complete = reader.str(term) && reader.u32(count);
+
+                if (complete) {
+                    record.terms.emplace_back(wstring_convert<codecvt_utf8<wchar_t>>().from_bytes(term), count);
+                }
+            }
+
+            if (!complete) {
+                break;
+            }
+        }
+
+        records.push_back(std::move(record));
+        valid_size = frames.position();
+    }
+
+    return records;
+}
+
+void write_ahead_log::commit_loop() {
+    std::unique_lock lock(mutex_);
+
+    while (true) {
+        appended_cv_.wait(lock, [this] {
+            return stopping_ || !pending_.empty();
+        });
+
+        if (pending_.empty()) {
+            break;
+        }
+
+        // let more appends join the batch, the sync is paid once for all of them
+        if (config_.commit_interval_us > 0 && !stopping_) {
+            lock.unlock();
+            std::this_thread::sleep_for(std::chrono::microseconds(config_.commit_interval_us));
+            lock.lock();
+        }
+
+        string batch;
+        uint64_t lsn = next_lsn_ - 1;
+
+        batch.swap(pending_);
+        lock.unlock();
+
+        string_view left = batch;
+        bool written = true;
+
+        while (written && !left.empty()) {
+            ssize_t result = write(fd_, left.data(), left.size());
+
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+
+            written = result > 0;
+
+            if (written) {
+                left.remove_prefix(result);
+            }
+        }
+
+        if (written && config_.sync) {
+            written = fdatasync(fd_) == 0;
+            ++syncs_;
+        }
+
+        lock.lock();
+
+        if (written) {
+            durable_lsn_ = lsn;
+        } else {
+            failed_ = true;
+        }
+
+        durable_cv_.notify_all();
+    }
+}
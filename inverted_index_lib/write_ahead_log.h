@@ -0,0 +1,87 @@
+#ifndef INVERTED_INDEX_LIB_WRITE_AHEAD_LOG_H
+#define INVERTED_INDEX_LIB_WRITE_AHEAD_LOG_H
+
+#include "inverted_index.h"
+#include "../enums_lib/wal_record_type.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using std::atomic;
+using std::condition_variable;
+using std::string;
+using std::thread;
+using std::vector;
+
+struct wal_config {
+    // how long the committer collects appends before one write and fdatasync,
+    // 0 commits as soon as the previous sync is done
+    uint32_t commit_interval_us = 1000;
+    // without it records are written but never synced, for comparison only
+    bool sync = true;
+    // operations between automatic checkpoints of a durable_index, 0 for none
+    size_t checkpoint_every = 0;
+};
+
+struct wal_record {
+    uint64_t lsn = 0;
+    wal_record_type type = WAL_ADD;
+    document doc;
+    term_frequencies terms;
+};
+
+// Append-only log of index operations with group commit: appends only encode
+// into an in-memory batch, a committer thread writes the batch and syncs it
+// once for everyone waiting on it. Every record is framed with its length
+// and a checksum, so a torn write at the tail is detected and dropped on
+// recovery.
+class write_ahead_log {
+public:
+    write_ahead_log(const fs::path& file_path, uint64_t next_lsn, const wal_config& config = {});
+    ~write_ahead_log();
+
+    write_ahead_log(const write_ahead_log&) = delete;
+    write_ahead_log& operator=(const write_ahead_log&) = delete;
+
+    uint64_t append_add(const document& doc, const term_frequencies& terms);
+    uint64_t append_remove(const document& doc);
+    // Blocks until the record with lsn is on disk.
+    void wait_durable(uint64_t lsn);
+    // Drops every record, for after a checkpoint that covers all of them.
+    void truncate();
+
+    [[nodiscard]] uint64_t last_lsn() const;
+    [[nodiscard]] uint64_t syncs() const;
+
+    // The records up to the first torn or corrupt one; valid_size is where it starts.
+    static vector<wal_record> read(const fs::path& file_path, uint64_t& valid_size);
+
+private:
+    int fd_ = -1;
+    wal_config config_;
+
+    string pending_;
+    uint64_t next_lsn_ = 1;
+    uint64_t durable_lsn_ = 0;
+    bool stopping_ = false;
+    bool failed_ = false;
+    mutable std::mutex mutex_;
+    condition_variable appended_cv_;
+    condition_variable durable_cv_;
+
+    atomic<uint64_t> syncs_ = 0;
+    thread committer_;
+
+    uint64_t append(wal_record_type type, const document& doc, const term_frequencies* terms);
+    void commit_loop();
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "directory_crawler.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <queue>
+#include <stdexcept>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using std::cerr;
+using std::endl;
+using std::runtime_error;
+
+struct linux_dirent64 {
+    ino64_t d_ino;
+    off64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+directory_crawler::directory_crawler(thread_pool* pool) : pool_(pool) {}
+
+vector<crawled_file> directory_crawler::crawl(const fs::path& root) {
+    vector<crawled_file> files;
+    vector<fs::path> subdirs;
+
+    scan(root, files, subdirs);
+
+    files_ = std::move(files);
+    pending_ = subdirs.size();
+
+    for (const auto& dir : subdirs) {
+        pool_->add_task([this, dir] {
+            crawl_task(dir);
+
+            return true;
+        });
+    }
+
+    {
+        write_lock_m lock(pending_mutex_);
+
+        pending_cv_.wait(lock, [this] {
+            return pending_ == 0;
+        });
+    }
+
+    std::sort(files_.begin(), files_.end(), [](const crawled_file& lhs, const crawled_file& rhs) {
+        return lhs.path < rhs.path;
+    });
+
+    return std::move(files_);
+}
+
+vector<work_unit> directory_crawler::partition(const vector<crawled_file>& files, size_t units_num) {
+    vector<uint32_t> order(files.size());
+
+    for (uint32_t i = 0; i < files.size(); ++i) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&files](uint32_t lhs, uint32_t rhs) {
+        return files[lhs].size > files[rhs].size;
+    });
+
+    using load = std::pair<uint64_t, size_t>;
+    std::priority_queue<load, vector<load>, std::greater<>> loads;
+    vector<work_unit> units(std::min(std::max<size_t>(units_num, 1), std::max<size_t>(files.size(), 1)));
+
+    for (size_t u = 0; u < units.size(); ++u) {
+        loads.emplace(0, u);
+    }
+
+    for (auto file : order) {
+        auto [bytes, u] = loads.top();
+
+        loads.pop();
+        units[u].files.push_back(file);
+        units[u].bytes += files[file].size;
+        loads.emplace(units[u].bytes, u);
+    }
+
+    return units;
+}
+
+void directory_crawler::crawl_task(const fs::path& dir) {
+    vector<crawled_file> files;
+    vector<fs::path> subdirs;
+
+    try {
+        scan(dir, files, subdirs);
+    } catch (runtime_error& e) {
+        cerr << e.what() << endl;
+    }
+
+    if (!files.empty()) {
+        write_lock_m lock(files_mutex_);
+
+        files_.insert(files_.end(), std::make_move_iterator(files.begin()), std::make_move_iterator(files.end()));
+    }
+
+    {
+        write_lock_m lock(pending_mutex_);
+
+        pending_ += subdirs.size();
+    }
+
+    for (const auto& subdir : subdirs) {
+        pool_->add_task([this, subdir] {
+            crawl_task(subdir);
+
+            return true;
+        });
+    }
+
+    write_lock_m lock(pending_mutex_);
+
+    if (--pending_ == 0) {
+        pending_cv_.notify_all();
+    }
+}
+
+void directory_crawler::scan(const fs::path& dir, vector<crawled_file>& files, vector<fs::path>& subdirs) {
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0) {
+        throw runtime_error("Cannot open directory " + dir.string());
+    }
+
+    alignas(linux_dirent64) char buffer[64 * 1024];
+    long read;
+
+    while ((read = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0) {
+        for (long offset = 0; offset < read;) {
+            auto* entry = reinterpret_cast<linux_dirent64*>(buffer + offset);
+            const char* name = entry->d_name;
+            unsigned char type = entry->d_type;
+            struct stat st{};
+
+            offset += entry->d_reclen;
+
+            if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) {
+                continue;
+            }
+
+            if (type == DT_DIR) {
+                subdirs.push_back(dir / name);
+
+                continue;
+            }
+
+            if (type != DT_REG && type != DT_LNK && type != DT_UNKNOWN) {
+                continue;
+            }
+
+            bool resolved = false;
+
+            if (type == DT_UNKNOWN) {
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    continue;
+                }
+
+                if (S_ISDIR(st.st_mode)) {
+                    subdirs.push_back(dir / name);
+
+                    continue;
+                }
+
+                resolved = !S_ISLNK(st.st_mode);
+            }
+
+            // symlinks are only followed to files, linked directories may form loops
+            if (!resolved && fstatat(fd, name, &st, 0) != 0) {
+                continue;
+            }
+
+            if (S_ISREG(st.st_mode)) {
+                files.push_back({
+                    dir / name,
+                    static_cast<uint64_t>(st.st_size),
+                    static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec
+                });
+            }
+        }
+    }
+
+    close(fd);
+
+    if (read < 0) {
+        throw runtime_error("Cannot read directory " + dir.string());
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef INVERTED_INDEX_LIB_DIRECTORY_CRAWLER_H
+#define INVERTED_INDEX_LIB_DIRECTORY_CRAWLER_H
+
+#include "thread_pool.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using std::condition_variable;
+using std::mutex;
+using std::vector;
+
+struct crawled_file {
+    fs::path path;
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+};
+
+struct work_unit {
+    vector<uint32_t> files;
+    uint64_t bytes = 0;
+};
+
+// Lists every regular file under a directory, one pool task per directory.
+// Entries are read with getdents64 and classified by d_type, so only files
+// are stat'ed (for their size, relative to the open directory) and
+// directories never are. Symlinks to files are followed, symlinks to
+// directories are not. The result is sorted by path.
+class directory_crawler {
+public:
+    explicit directory_crawler(thread_pool* pool);
+
+    vector<crawled_file> crawl(const fs::path& root);
+
+    // Splits files into units_num units of about equal bytes, largest files
+    // first into the currently lightest unit. Units hold indexes into files.
+    static vector<work_unit> partition(const vector<crawled_file>& files, size_t units_num);
+
+private:
+    thread_pool* pool_ = nullptr;
+
+    vector<crawled_file> files_;
+    mutex files_mutex_;
+
+    size_t pending_ = 0;
+    mutex pending_mutex_;
+    condition_variable pending_cv_;
+
+    void crawl_task(const fs::path& dir);
+    void scan(const fs::path& dir, vector<crawled_file>& files, vector<fs::path>& subdirs);
+};
+
+#endif
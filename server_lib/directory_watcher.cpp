@@ -0,0 +1,155 @@
+#include "directory_watcher.h"
+#include <cerrno>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using std::cerr;
+using std::endl;
+using std::runtime_error;
+
+static constexpr uint32_t watch_mask =
+        IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR;
+
+directory_watcher::directory_watcher(const fs::path& root) {
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (fd_ < 0 || wake_fd_ < 0) {
+        close_fds();
+
+        throw runtime_error("Cannot initialize inotify");
+    }
+
+    // the files already in the tree are the caller's to index, only changes are reported
+    vector<file_event> existing;
+
+    add_watch(root, existing);
+
+    if (dirs_.empty()) {
+        close_fds();
+
+        throw runtime_error("Cannot watch directory " + root.string());
+    }
+}
+
+directory_watcher::~directory_watcher() {
+    close_fds();
+}
+
+vector<file_event> directory_watcher::poll(int timeout_ms) {
+    vector<file_event> events;
+    pollfd fds[] = {{fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+
+    if (::poll(fds, 2, timeout_ms) <= 0) {
+        return events;
+    }
+
+    if (fds[1].revents & POLLIN) {
+        uint64_t value;
+
+        (void) ::read(wake_fd_, &value, sizeof(value));
+    }
+
+    alignas(inotify_event) char buffer[64 * 1024];
+    ssize_t read;
+
+    while ((read = ::read(fd_, buffer, sizeof(buffer))) > 0) {
+        auto now = ch::system_clock::now();
+
+        for (ssize_t offset = 0; offset < read;) {
+            auto* event = reinterpret_cast<inotify_event*>(buffer + offset);
+
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                cerr << "inotify queue overflow, events were lost" << endl;
+
+                continue;
+            }
+
+            if (event->mask & IN_IGNORED) {
+                dirs_.erase(event->wd);
+
+                continue;
+            }
+
+            auto dir = dirs_.find(event->wd);
+
+            if (dir == dirs_.end() || event->len == 0) {
+                continue;
+            }
+
+            fs::path path = dir->second / event->name;
+
+            if (event->mask & IN_ISDIR) {
+                // removed directories lose their watch through IN_IGNORED, the
+                // files in them are reported one by one as they are deleted
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    add_watch(path, events);
+                }
+
+                continue;
+            }
+
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                events.push_back({path, FILE_WRITTEN, now});
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                events.push_back({path, FILE_REMOVED, now});
+            }
+        }
+    }
+
+    if (read < 0 && errno != EAGAIN && errno != EINTR) {
+        cerr << "Cannot read inotify events" << endl;
+    }
+
+    return events;
+}
+
+void directory_watcher::wake() {
+    uint64_t value = 1;
+
+    (void) ::write(wake_fd_, &value, sizeof(value));
+}
+
+void directory_watcher::close_fds() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+        wake_fd_ = -1;
+    }
+}
+
+// Files can land in a new directory before its watch exists, so whatever it
+// already holds is reported as written.
+void directory_watcher::add_watch(const fs::path& dir, vector<file_event>& existing) {
+    int wd = inotify_add_watch(fd_, dir.c_str(), watch_mask);
+
+    if (wd < 0) {
+        cerr << "Cannot watch directory " << dir << endl;
+
+        return;
+    }
+
+    dirs_[wd] = dir;
+
+    std::error_code error;
+    auto now = ch::system_clock::now();
+
+    for (const auto& entry : fs::directory_iterator(dir, error)) {
+        if (entry.is_directory(error) && !entry.is_symlink(error)) {
+            add_watch(entry.path(), existing);
+        } else if (entry.is_regular_file(error)) {
+            existing.push_back({entry.path(), FILE_WRITTEN, now});
+        }
+    }
+}
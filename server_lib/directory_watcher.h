@@ -0,0 +1,49 @@
+#ifndef INVERTED_INDEX_LIB_DIRECTORY_WATCHER_H
+#define INVERTED_INDEX_LIB_DIRECTORY_WATCHER_H
+
+#include "../enums_lib/file_event_type.h"
+
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+namespace ch = std::chrono;
+
+using std::unordered_map;
+using std::vector;
+
+struct file_event {
+    fs::path path;
+    file_event_type type = FILE_WRITTEN;
+    ch::system_clock::time_point detected_at;
+};
+
+// Watches a directory tree with inotify. A file counts as written when it is
+// closed after writing or moved into the tree, and as removed when it is
+// deleted or moved out. Directories created later are watched as they
+// appear, and the files they already hold are reported as written.
+class directory_watcher {
+public:
+    explicit directory_watcher(const fs::path& root);
+    ~directory_watcher();
+
+    directory_watcher(const directory_watcher&) = delete;
+    directory_watcher& operator=(const directory_watcher&) = delete;
+
+    // Waits up to timeout_ms (-1 for no limit) for events and returns the
+    // ones that arrived, empty on timeout or after wake.
+    vector<file_event> poll(int timeout_ms);
+    void wake();
+
+private:
+    int fd_ = -1;
+    int wake_fd_ = -1;
+    unordered_map<int, fs::path> dirs_;
+
+    void add_watch(const fs::path& dir, vector<file_event>& existing);
+    void close_fds();
+};
+
+#endif
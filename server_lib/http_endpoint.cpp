@@ -0,0 +1,586 @@
+#include "http_endpoint.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using std::runtime_error;
+
+static constexpr uint64_t listen_tag = 0;
+static constexpr uint64_t wake_tag = std::numeric_limits<uint64_t>::max();
+static constexpr size_t max_iovecs = 64;
+
+http_endpoint::http_endpoint(thread_pool* pool, const http_config& config) : pool_(pool), config_(config) {}
+
+http_endpoint::~http_endpoint() {
+    stop();
+}
+
+void http_endpoint::route(const string& method, const string& path, handler h) {
+    routes_[method + " " + path] = std::move(h);
+}
+
+void http_endpoint::start() {
+    if (running_) {
+        return;
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (listen_fd_ < 0) {
+        throw runtime_error("Cannot create socket");
+    }
+
+    int enable = 1;
+    sockaddr_in address{};
+
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config_.port);
+
+    if (inet_pton(AF_INET, config_.host.c_str(), &address.sin_addr) != 1 ||
+        bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listen_fd_, SOMAXCONN) != 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+
+        throw runtime_error("Cannot listen on " + config_.host + ":" + std::to_string(config_.port));
+    }
+
+    socklen_t length = sizeof(address);
+
+    getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length);
+    port_ = ntohs(address.sin_port);
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    epoll_event listen_event{EPOLLIN, {.u64 = listen_tag}};
+    epoll_event wake_event{EPOLLIN, {.u64 = wake_tag}};
+
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &listen_event);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake_event);
+
+    running_ = true;
+    loop_thread_ = thread(&http_endpoint::loop, this);
+}
+
+// Handlers still running on the pool report back to this object, so it
+// waits for them before closing anything.
+void http_endpoint::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    uint64_t value = 1;
+
+    (void) write(wake_fd_, &value, sizeof(value));
+    loop_thread_.join();
+
+    {
+        std::unique_lock lock(in_flight_mutex_);
+
+        in_flight_cv_.wait(lock, [this] {
+            return in_flight_ == 0;
+        });
+    }
+
+    for (auto& [id, conn] : connections_) {
+        close(conn->fd);
+    }
+
+    connections_.clear();
+    completions_.clear();
+    close(listen_fd_);
+    close(epoll_fd_);
+    close(wake_fd_);
+    listen_fd_ = epoll_fd_ = wake_fd_ = -1;
+}
+
+uint16_t http_endpoint::port() const {
+    return port_;
+}
+
+string http_endpoint::url_decode(const string& value) {
+    string decoded;
+
+    decoded.reserve(value.size());
+
+    for (size_t i = 0; i < value.size(); ++i) {
+        if (value[i] == '+') {
+            decoded.push_back(' ');
+        } else if (value[i] == '%' && i + 2 < value.size() &&
+                   std::isxdigit(static_cast<unsigned char>(value[i + 1])) &&
+                   std::isxdigit(static_cast<unsigned char>(value[i + 2]))) {
+            decoded.push_back(static_cast<char>(std::stoi(value.substr(i + 1, 2), nullptr, 16)));
+            i += 2;
+        } else {
+            decoded.push_back(value[i]);
+        }
+    }
+
+    return decoded;
+}
+
+void http_endpoint::loop() {
+    epoll_event events[256];
+
+    while (running_) {
+        int ready = epoll_wait(epoll_fd_, events, 256, -1);
+
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < ready; ++i) {
+            uint64_t tag = events[i].data.u64;
+
+            if (tag == listen_tag) {
+                accept_connections();
+            } else if (tag == wake_tag) {
+                uint64_t value;
+
+                (void) read(wake_fd_, &value, sizeof(value));
+                drain_completions();
+            } else {
+                auto it = connections_.find(tag);
+
+                if (it == connections_.end()) {
+                    continue;
+                }
+
+                if (events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN)) {
+                    close_connection(tag);
+
+                    continue;
+                }
+
+                if (events[i].events & EPOLLIN) {
+                    read_connection(tag);
+                }
+
+                if (events[i].events & EPOLLOUT && (it = connections_.find(tag)) != connections_.end()) {
+                    flush(tag, *it->second);
+                }
+            }
+        }
+    }
+}
+
+void http_endpoint::accept_connections() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (fd < 0) {
+            return;
+        }
+
+        int enable = 1;
+        uint64_t id = next_connection_id_++;
+        auto conn = std::make_unique<connection>();
+
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        conn->id = id;
+        conn->fd = fd;
+
+        epoll_event event{EPOLLIN, {.u64 = id}};
+
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+        connections_[id] = std::move(conn);
+    }
+}
+
+void http_endpoint::read_connection(uint64_t id) {
+    connection& conn = *connections_[id];
+    char buffer[64 * 1024];
+
+    while (true) {
+        ssize_t received = read(conn.fd, buffer, sizeof(buffer));
+
+        if (received > 0) {
+            conn.input.append(buffer, received);
+
+            // past the limit the complete requests come off now, what is still
+            // left is a request too large and is answered before reading more
+            if (conn.input.size() > config_.max_request_size) {
+                parse_requests(id, conn);
+            }
+
+            if (conn.closing) {
+                break;
+            }
+
+            continue;
+        }
+
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+
+        if (received < 0) {
+            close_connection(id);
+
+            return;
+        }
+
+        // still answer what was sent before the EOF, but stop polling for input
+        epoll_event event{conn.wants_write ? EPOLLOUT : 0u, {.u64 = id}};
+
+        conn.input_closed = true;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &event);
+
+        break;
+    }
+
+    if (!conn.closing) {
+        parse_requests(id, conn);
+    }
+
+    // a closing connection takes no more input, what the client still sends is dropped
+    if (conn.closing && !conn.input_closed) {
+        epoll_event event{conn.wants_write ? EPOLLOUT : 0u, {.u64 = id}};
+
+        conn.input_closed = true;
+        conn.input.clear();
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &event);
+    }
+
+    flush(id, conn);
+}
+
+// Takes every complete request off the input, each one gets its response
+// slot in arrival order before its handler runs.
+void http_endpoint::parse_requests(uint64_t id, connection& conn) {
+    while (!conn.closing) {
+        size_t header_end = conn.input.find("\r\n\r\n");
+
+        if (header_end == string::npos) {
+            if (conn.input.size() > config_.max_request_size) {
+                conn.closing = true;
+                conn.responses.push_back({});
+                complete({id, conn.next_seq++, {413, "application/json", R"({"error":"request too large"})"}, false});
+            }
+
+            return;
+        }
+
+        http_request request;
+        size_t line_end = conn.input.find("\r\n");
+        string line = conn.input.substr(0, line_end);
+        size_t first_space = line.find(' ');
+        size_t second_space = line.find(' ', first_space + 1);
+        size_t content_length = 0;
+        string connection_header;
+
+        if (first_space != string::npos && second_space != string::npos) {
+            string target = line.substr(first_space + 1, second_space - first_space - 1);
+            string version = line.substr(second_space + 1);
+            size_t query_start = target.find('?');
+
+            request.method = line.substr(0, first_space);
+            request.path = target.substr(0, query_start);
+            request.keep_alive = version == "HTTP/1.1";
+
+            if (query_start != string::npos) {
+                string query = target.substr(query_start + 1);
+
+                for (size_t begin = 0; begin <= query.size();) {
+                    size_t end = std::min(query.find('&', begin), query.size());
+                    string pair = query.substr(begin, end - begin);
+                    size_t equals = pair.find('=');
+
+                    if (!pair.empty()) {
+                        request.query[url_decode(pair.substr(0, equals))] =
+                                equals != string::npos ? url_decode(pair.substr(equals + 1)) : "";
+                    }
+
+                    begin = end + 1;
+                }
+            }
+        }
+
+        for (size_t begin = line_end + 2; begin < header_end;) {
+            size_t end = conn.input.find("\r\n", begin);
+            string header = conn.input.substr(begin, end - begin);
+            size_t colon = header.find(':');
+
+            begin = end + 2;
+
+            if (colon == string::npos) {
+                continue;
+            }
+
+            string name = header.substr(0, colon);
+            string value = header.substr(header.find_first_not_of(' ', colon + 1) != string::npos
+                                         ? header.find_first_not_of(' ', colon + 1) : header.size());
+
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+
+            if (name == "content-length") {
+                content_length = std::strtoull(value.c_str(), nullptr, 10);
+            } else if (name == "connection") {
+                connection_header = value;
+            }
+        }
+
+        if (header_end + 4 + content_length > config_.max_request_size) {
+            conn.closing = true;
+            conn.responses.push_back({});
+            complete({id, conn.next_seq++, {413, "application/json", R"({"error":"request too large"})"}, false});
+
+            return;
+        }
+
+        if (conn.input.size() < header_end + 4 + content_length) {
+            return;
+        }
+
+        request.body = conn.input.substr(header_end + 4, content_length);
+        conn.input.erase(0, header_end + 4 + content_length);
+
+        if (connection_header == "close") {
+            request.keep_alive = false;
+        } else if (connection_header == "keep-alive") {
+            request.keep_alive = true;
+        }
+
+        conn.closing = !request.keep_alive;
+        conn.responses.push_back({});
+        dispatch(id, conn.next_seq++, std::move(request));
+    }
+}
+
+void http_endpoint::dispatch(uint64_t id, uint64_t seq, http_request request) {
+    auto route = routes_.find(request.method + " " + request.path);
+    bool keep_alive = request.keep_alive;
+
+    if (request.method.empty()) {
+        complete({id, seq, {400, "application/json", R"({"error":"bad request"})"}, false});
+
+        return;
+    }
+
+    if (route == routes_.end()) {
+        complete({id, seq, {404, "application/json", R"({"error":"not found"})"}, keep_alive});
+
+        return;
+    }
+
+    {
+        std::lock_guard lock(in_flight_mutex_);
+
+        ++in_flight_;
+    }
+
+    // nobody waits for a handler by id, so the pool keeps nothing per request
+    pool_->add_detached_task([this, id, seq, keep_alive, h = route->second, request = std::move(request)] {
+        http_response response;
+
+        try {
+            response = h(request);
+        } catch (std::exception& e) {
+            response = {500, "application/json", R"({"error":"internal error"})"};
+        }
+
+        complete({id, seq, std::move(response), keep_alive});
+
+        std::lock_guard lock(in_flight_mutex_);
+
+        if (--in_flight_ == 0) {
+            in_flight_cv_.notify_all();
+        }
+
+        return true;
+    });
+}
+
+// Hands a response to the event loop, from any thread.
+void http_endpoint::complete(completion done) {
+    {
+        std::lock_guard lock(completions_mutex_);
+
+        completions_.push_back(std::move(done));
+    }
+
+    uint64_t value = 1;
+
+    (void) write(wake_fd_, &value, sizeof(value));
+}
+
+void http_endpoint::drain_completions() {
+    vector<completion> completed;
+
+    {
+        std::lock_guard lock(completions_mutex_);
+
+        completed.swap(completions_);
+    }
+
+    vector<uint64_t> touched;
+
+    for (auto& done : completed) {
+        auto it = connections_.find(done.connection_id);
+
+        // the client went away meanwhile
+        if (it == connections_.end()) {
+            continue;
+        }
+
+        connection& conn = *it->second;
+        response_slot& slot = conn.responses[done.seq - conn.first_seq];
+
+        slot.header = "HTTP/1.1 " + std::to_string(done.response.status) + " " + status_text(done.response.status) +
+                      "\r\nContent-Type: " + done.response.content_type +
+                      "\r\nContent-Length: " + std::to_string(done.response.body.size()) +
+                      (done.keep_alive ? "\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+        slot.body = std::move(done.response.body);
+        slot.close_after = !done.keep_alive;
+        slot.ready = true;
+        touched.push_back(done.connection_id);
+    }
+
+    for (auto id : touched) {
+        if (auto it = connections_.find(id); it != connections_.end()) {
+            flush(id, *it->second);
+        }
+    }
+}
+
+// Writes the ready responses at the head of the queue; one that is not ready
+// yet holds back everything after it.
+void http_endpoint::flush(uint64_t id, connection& conn) {
+    while (!conn.responses.empty() && conn.responses.front().ready) {
+        iovec iovecs[max_iovecs];
+        size_t count = 0;
+
+        for (auto& slot : conn.responses) {
+            if (!slot.ready || count + 2 > max_iovecs) {
+                break;
+            }
+
+            size_t offset = slot.written;
+
+            if (offset < slot.header.size()) {
+                iovecs[count++] = {slot.header.data() + offset, slot.header.size() - offset};
+                offset = 0;
+            } else {
+                offset -= slot.header.size();
+            }
+
+            if (offset < slot.body.size()) {
+                iovecs[count++] = {slot.body.data() + offset, slot.body.size() - offset};
+            }
+        }
+
+        msghdr message{};
+
+        message.msg_iov = iovecs;
+        message.msg_iovlen = count;
+
+        // a client that already closed must not raise SIGPIPE
+        ssize_t written = sendmsg(conn.fd, &message, MSG_NOSIGNAL);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                update_events(conn, true);
+
+                return;
+            }
+
+            close_connection(id);
+
+            return;
+        }
+
+        auto left = static_cast<size_t>(written);
+
+        while (!conn.responses.empty() && conn.responses.front().ready) {
+            response_slot& slot = conn.responses.front();
+            size_t remaining = slot.header.size() + slot.body.size() - slot.written;
+
+            if (left < remaining) {
+                slot.written += left;
+
+                break;
+            }
+
+            left -= remaining;
+
+            if (slot.close_after) {
+                close_connection(id);
+
+                return;
+            }
+
+            conn.responses.pop_front();
+            ++conn.first_seq;
+        }
+    }
+
+    if (conn.input_closed && conn.responses.empty()) {
+        close_connection(id);
+
+        return;
+    }
+
+    update_events(conn, false);
+}
+
+void http_endpoint::close_connection(uint64_t id) {
+    auto it = connections_.find(id);
+
+    if (it == connections_.end()) {
+        return;
+    }
+
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second->fd, nullptr);
+    close(it->second->fd);
+    connections_.erase(it);
+}
+
+void http_endpoint::update_events(connection& conn, bool want_write) {
+    if (conn.wants_write == want_write) {
+        return;
+    }
+
+    epoll_event event{(conn.input_closed ? 0u : EPOLLIN) | (want_write ? EPOLLOUT : 0u), {.u64 = conn.id}};
+
+    conn.wants_write = want_write;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &event);
+}
+
+const char* http_endpoint::status_text(int status) {
+    switch (status) {
+        case 200:
+            return "OK";
+        case 400:
+            return "Bad Request";
+        case 404:
+            return "Not Found";
+        case 413:
+            return "Payload Too Large";
+        case 500:
+            return "Internal Server Error";
+        default:
+            return "Unknown";
+    }
+}
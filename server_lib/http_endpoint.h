@@ -0,0 +1,138 @@
+#ifndef INVERTED_INDEX_LIB_HTTP_ENDPOINT_H
+#define INVERTED_INDEX_LIB_HTTP_ENDPOINT_H
+
+#include "thread_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using std::atomic;
+using std::condition_variable;
+using std::deque;
+using std::function;
+using std::mutex;
+using std::string;
+using std::thread;
+using std::unique_ptr;
+using std::unordered_map;
+using std::vector;
+
+struct http_config {
+    string host = "127.0.0.1";
+    // 0 picks a free port, see http_endpoint::port
+    uint16_t port = 0;
+    size_t max_request_size = 64 * 1024;
+};
+
+struct http_request {
+    string method;
+    string path;
+    unordered_map<string, string> query;
+    string body;
+    bool keep_alive = true;
+};
+
+struct http_response {
+    int status = 200;
+    string content_type = "application/json";
+    string body;
+};
+
+// A small HTTP/1.1 server on one epoll thread. Connections are kept alive
+// and may pipeline requests; every request runs its handler on the thread
+// pool and the responses go back in request order, header and body handed
+// to writev as they are instead of being copied into one buffer.
+class http_endpoint {
+public:
+    using handler = function<http_response(const http_request&)>;
+
+    explicit http_endpoint(thread_pool* pool, const http_config& config = {});
+    ~http_endpoint();
+
+    http_endpoint(const http_endpoint&) = delete;
+    http_endpoint& operator=(const http_endpoint&) = delete;
+
+    // Routes match the request path exactly; add them before start.
+    void route(const string& method, const string& path, handler h);
+    void start();
+    void stop();
+
+    [[nodiscard]] uint16_t port() const;
+
+    static string url_decode(const string& value);
+
+private:
+    struct response_slot {
+        bool ready = false;
+        bool close_after = false;
+        string header;
+        string body;
+        size_t written = 0;
+    };
+
+    struct connection {
+        uint64_t id = 0;
+        int fd = -1;
+        string input;
+        deque<response_slot> responses;
+        uint64_t first_seq = 0;
+        uint64_t next_seq = 0;
+        bool closing = false;
+        bool wants_write = false;
+        // the client shut down its side, close once the queued responses are written
+        bool input_closed = false;
+    };
+
+    struct completion {
+        uint64_t connection_id;
+        uint64_t seq;
+        http_response response;
+        bool keep_alive;
+    };
+
+    thread_pool* pool_ = nullptr;
+    http_config config_;
+    unordered_map<string, handler> routes_;
+
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    uint16_t port_ = 0;
+
+    unordered_map<uint64_t, unique_ptr<connection>> connections_;
+    uint64_t next_connection_id_ = 1;
+
+    vector<completion> completions_;
+    mutex completions_mutex_;
+
+    size_t in_flight_ = 0;
+    mutex in_flight_mutex_;
+    condition_variable in_flight_cv_;
+
+    atomic<bool> running_ = false;
+    thread loop_thread_;
+
+    void loop();
+    void accept_connections();
+    void read_connection(uint64_t id);
+    void parse_requests(uint64_t id, connection& conn);
+    void dispatch(uint64_t id, uint64_t seq, http_request request);
+    void complete(completion done);
+    void drain_completions();
+    void flush(uint64_t id, connection& conn);
+    void close_connection(uint64_t id);
+    void update_events(connection& conn, bool want_write);
+
+    static const char* status_text(int status);
+};
+
+#endif
@@ -0,0 +1,116 @@
+#include "index_manifest.h"
+#include "byte_source.h"
+#include "json.hpp"
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using json = nlohmann::json;
+using std::ifstream;
+using std::ofstream;
+using std::cerr;
+using std::endl;
+
+static constexpr uint64_t fnv_offset_basis = 14695981039346656037ull;
+
+static uint64_t fnv_1a(uint64_t hash, string_view bytes) {
+    for (char c : bytes) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+bool index_manifest::load(const fs::path& file_path) {
+    ifstream file(file_path);
+
+    if (!file.is_open()) {
+        return false;
+    }
+
+    json j = json::parse(file, nullptr, false);
+
+    if (j.is_discarded() || !j.is_object()) {
+        cerr << "Malformed manifest " << file_path << endl;
+
+        return false;
+    }
+
+    entries_.clear();
+
+    for (const auto& [path, entry] : j.items()) {
+        entries_[path] = {
+            entry.at("size").get<uint64_t>(),
+            entry.at("mtime_ns").get<int64_t>(),
+            entry.at("hash").get<uint64_t>()
+        };
+    }
+
+    return true;
+}
+
+void index_manifest::save(const fs::path& file_path) const {
+    json j = json::object();
+
+    for (const auto& [path, entry] : entries_) {
+        j[path] = {{"size", entry.size}, {"mtime_ns", entry.mtime_ns}, {"hash", entry.hash}};
+    }
+
+    ofstream file(file_path);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write manifest " + file_path.string());
+    }
+
+    file << j.dump(4);
+}
+
+const manifest_entry* index_manifest::find(const string& path) const {
+    auto it = entries_.find(path);
+
+    return it != entries_.end() ? &it->second : nullptr;
+}
+
+void index_manifest::set(const string& path, const manifest_entry& entry) {
+    entries_[path] = entry;
+}
+
+void index_manifest::erase(const string& path) {
+    entries_.erase(path);
+}
+
+void index_manifest::clear() {
+    entries_.clear();
+}
+
+const unordered_map<string, manifest_entry>& index_manifest::entries() const {
+    return entries_;
+}
+
+optional<uint64_t> index_manifest::hash_file(const fs::path& file_path) {
+    try {
+        auto source = open_byte_source(file_path.string());
+
+        if (source == nullptr) {
+            return std::nullopt;
+        }
+
+        uint64_t hash = fnv_offset_basis;
+        char buffer[64 * 1024];
+
+        while (size_t read = source->read(buffer, sizeof(buffer))) {
+            hash = fnv_1a(hash, string_view(buffer, read));
+        }
+
+        return hash;
+    } catch (std::runtime_error& e) {
+        cerr << e.what() << endl;
+
+        return std::nullopt;
+    }
+}
+
+uint64_t index_manifest::hash_bytes(string_view bytes) {
+    return fnv_1a(fnv_offset_basis, bytes);
+}
@@ -0,0 +1,47 @@
+#ifndef INVERTED_INDEX_LIB_INDEX_MANIFEST_H
+#define INVERTED_INDEX_LIB_INDEX_MANIFEST_H
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+using std::optional;
+using std::string;
+using std::string_view;
+using std::unordered_map;
+
+struct manifest_entry {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    uint64_t hash = 0;
+};
+
+// The files an index was built from, keyed by the document name the index
+// uses for them. Saved next to the index so a later run can tell which files
+// were added, changed or deleted since.
+class index_manifest {
+public:
+    bool load(const fs::path& file_path);
+    void save(const fs::path& file_path) const;
+
+    [[nodiscard]] const manifest_entry* find(const string& path) const;
+    void set(const string& path, const manifest_entry& entry);
+    void erase(const string& path);
+    void clear();
+    [[nodiscard]] const unordered_map<string, manifest_entry>& entries() const;
+
+    // FNV-1a over a document's content as it is parsed, compressed files
+    // decompressed. std::nullopt when it cannot be read.
+    static optional<uint64_t> hash_file(const fs::path& file_path);
+    static uint64_t hash_bytes(string_view bytes);
+
+private:
+    unordered_map<string, manifest_entry> entries_;
+};
+
+#endif
@@ -0,0 +1,235 @@
+#include "ingest_pipeline.h"
+#include "byte_source.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace ch = std::chrono;
+
+using std::cerr;
+using std::endl;
+using std::thread;
+
+static uint64_t elapsed_ns(ch::steady_clock::time_point start) {
+    return ch::duration_cast<ch::nanoseconds>(ch::steady_clock::now() - start).count();
+}
+
+double stage_metrics::items_per_second() const {
+    return wall_ms > 0 ? static_cast<double>(items) * 1000.0 / wall_ms : 0;
+}
+
+double stage_metrics::megabytes_per_second() const {
+    return wall_ms > 0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) * 1000.0 / wall_ms : 0;
+}
+
+void ingest_pipeline::stage_counters::sample_depth(size_t depth) {
+    depth_sum += depth;
+    ++depth_samples;
+
+    size_t max = max_depth.load(std::memory_order_relaxed);
+
+    while (depth > max && !max_depth.compare_exchange_weak(max, depth, std::memory_order_relaxed)) {}
+}
+
+ingest_pipeline::ingest_pipeline(
+        document_parser* parser,
+        inverted_index* index,
+        const pipeline_config& config,
+        durable_index* durable
+) : parser_(parser), index_(index), durable_(durable), config_(config) {
+    config_.readers = std::max(1u, config_.readers);
+    config_.parsers = std::max(1u, config_.parsers);
+    config_.writers = std::max(1u, config_.writers);
+    config_.queue_capacity = std::max<size_t>(2, config_.queue_capacity);
+    config_.read_batch = std::max(1u, config_.read_batch);
+}
+
+void ingest_pipeline::run(const vector<fs::path>& input_files) {
+    bounded_queue<raw_document> raw(config_.queue_capacity);
+    bounded_queue<parsed_document> parsed(config_.queue_capacity);
+    atomic<size_t> next_file = 0;
+    atomic<unsigned int> readers_left = config_.readers;
+    atomic<unsigned int> parsers_left = config_.parsers;
+    vector<thread> threads;
+    auto start = ch::steady_clock::now();
+
+    threads.reserve(config_.readers + config_.parsers + config_.writers);
+
+    for (unsigned int i = 0; i < config_.readers; ++i) {
+        threads.emplace_back([&] {
+            read_stage(input_files, next_file, raw);
+
+            if (--readers_left == 0) {
+                raw.close();
+            }
+        });
+    }
+
+    for (unsigned int i = 0; i < config_.parsers; ++i) {
+        threads.emplace_back([&] {
+            parse_stage(raw, parsed);
+
+            if (--parsers_left == 0) {
+                parsed.close();
+            }
+        });
+    }
+
+    for (unsigned int i = 0; i < config_.writers; ++i) {
+        threads.emplace_back([&] {
+            write_stage(parsed);
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    wall_ms_ = static_cast<double>(elapsed_ns(start)) / 1e6;
+}
+
+vector<stage_metrics> ingest_pipeline::metrics() const {
+    return {
+        snapshot("read", config_.readers, readers_),
+        snapshot("parse", config_.parsers, parsers_),
+        snapshot("write", config_.writers, writers_),
+    };
+}
+
+void ingest_pipeline::read_stage(
+        const vector<fs::path>& input_files,
+        atomic<size_t>& next_file,
+        bounded_queue<raw_document>& output
+) {
+    batch_file_reader reader(config_.read_batch);
+    size_t batch = config_.read_batch;
+
+    for (size_t begin = next_file.fetch_add(batch); begin < input_files.size(); begin = next_file.fetch_add(batch)) {
+        auto start = ch::steady_clock::now();
+        size_t end = std::min(begin + batch, input_files.size());
+        vector<raw_document> documents;
+        vector<optional<string>> contents(end - begin);
+        vector<string> plain_paths;
+        vector<size_t> plain_indexes;
+
+        for (size_t i = begin; i < end; ++i) {
+            documents.push_back({input_files[i].string(), {}});
+
+            if (is_compressed(input_files[i])) {
+                contents[i - begin] = read_compressed(documents.back().path);
+            } else {
+                plain_paths.push_back(documents.back().path);
+                plain_indexes.push_back(i - begin);
+            }
+        }
+
+        auto plain_contents = reader.read(plain_paths);
+
+        for (size_t i = 0; i < plain_indexes.size(); ++i) {
+            contents[plain_indexes[i]] = std::move(plain_contents[i]);
+        }
+
+        readers_.busy_ns += elapsed_ns(start);
+
+        for (size_t i = 0; i < documents.size(); ++i) {
+            if (!contents[i].has_value()) {
+                cerr << "Cannot open file" << documents[i].path << endl;
+
+                continue;
+            }
+
+            documents[i].bytes = std::move(*contents[i]);
+            readers_.bytes += documents[i].bytes.size();
+            ++readers_.items;
+
+            if (!output.push(std::move(documents[i]))) {
+                return;
+            }
+
+            readers_.sample_depth(output.size());
+        }
+    }
+}
+
+optional<string> ingest_pipeline::read_compressed(const string& path) {
+    try {
+        return read_document(path);
+    } catch (std::runtime_error& e) {
+        cerr << e.what() << endl;
+
+        return std::nullopt;
+    }
+}
+
+void ingest_pipeline::parse_stage(bounded_queue<raw_document>& input, bounded_queue<parsed_document>& output) {
+    raw_document document;
+
+    while (input.pop(document)) {
+        auto start = ch::steady_clock::now();
+        parsed_document result{std::move(document.path), parser_->parse_bytes_term_ids(document.bytes)};
+
+        parsers_.bytes += document.bytes.size();
+        ++parsers_.items;
+        parsers_.busy_ns += elapsed_ns(start);
+
+        if (!output.push(std::move(result))) {
+            return;
+        }
+
+        parsers_.sample_depth(output.size());
+    }
+}
+
+void ingest_pipeline::write_stage(bounded_queue<parsed_document>& input) {
+    parsed_document document;
+
+    if (durable_) {
+        document_terms batch;
+
+        while (input.pop(document)) {
+            auto start = ch::steady_clock::now();
+            uint64_t bytes = 0;
+
+            do {
+                bytes += document.terms.size() * (sizeof(term_id) + sizeof(uint32_t));
+                batch.emplace_back(std::move(document.path), std::move(document.terms));
+            } while (batch.size() < config_.queue_capacity && input.try_pop(document));
+
+            durable_->add_batch(batch);
+
+            writers_.bytes += bytes;
+            writers_.items += batch.size();
+            writers_.busy_ns += elapsed_ns(start);
+            batch.clear();
+        }
+
+        return;
+    }
+
+    while (input.pop(document)) {
+        auto start = ch::steady_clock::now();
+
+        index_->add(document.path, document.terms);
+
+        writers_.bytes += document.terms.size() * (sizeof(term_id) + sizeof(uint32_t));
+        ++writers_.items;
+        writers_.busy_ns += elapsed_ns(start);
+    }
+}
+
+stage_metrics ingest_pipeline::snapshot(const string& name, unsigned int threads, const stage_counters& counters) const {
+    uint64_t samples = counters.depth_samples;
+
+    return {
+        name,
+        threads,
+        counters.items,
+        counters.bytes,
+        static_cast<double>(counters.busy_ns) / 1e6,
+        wall_ms_,
+        counters.max_depth,
+        samples > 0 ? static_cast<double>(counters.depth_sum) / static_cast<double>(samples) : 0,
+    };
+}
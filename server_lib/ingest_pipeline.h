@@ -0,0 +1,106 @@
+#ifndef INVERTED_INDEX_LIB_INGEST_PIPELINE_H
+#define INVERTED_INDEX_LIB_INGEST_PIPELINE_H
+
+#include "bounded_queue.h"
+#include "inverted_index.h"
+#include "durable_index.h"
+#include "document_parser.h"
+#include "batch_file_reader.h"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using std::atomic;
+using std::string;
+using std::vector;
+
+struct pipeline_config {
+    unsigned int readers = 1;
+    unsigned int parsers = 4;
+    unsigned int writers = 1;
+    size_t queue_capacity = 64;
+    unsigned int read_batch = batch_file_reader::default_depth;
+};
+
+// Snapshot of one stage after a run. busy_ms is the time the stage's threads
+// spent working (not waiting on a queue), summed over threads. Queue depth is
+// sampled on every push into the stage's output queue.
+struct stage_metrics {
+    string name;
+    unsigned int threads = 0;
+    uint64_t items = 0;
+    uint64_t bytes = 0;
+    double busy_ms = 0;
+    double wall_ms = 0;
+    size_t max_queue_depth = 0;
+    double avg_queue_depth = 0;
+
+    [[nodiscard]] double items_per_second() const;
+    [[nodiscard]] double megabytes_per_second() const;
+};
+
+// Ingests files in three stages, each on its own threads: readers load raw
+// bytes read_batch files at a time (see batch_file_reader; compressed files
+// are decompressed one by one), parsers turn them into term frequencies
+// and writers add them to the index. Stages are connected by bounded queues,
+// so a slow stage holds the ones before it back instead of letting documents
+// pile up in memory. With a durable_index, writers log whatever documents
+// are waiting in their queue as one batch before adding them.
+class ingest_pipeline {
+public:
+    ingest_pipeline(
+            document_parser* parser,
+            inverted_index* index,
+            const pipeline_config& config,
+            durable_index* durable = nullptr
+    );
+
+    void run(const vector<fs::path>& input_files);
+    [[nodiscard]] vector<stage_metrics> metrics() const;
+
+private:
+    struct raw_document {
+        string path;
+        string bytes;
+    };
+
+    struct parsed_document {
+        string path;
+        term_id_frequencies terms;
+    };
+
+    struct stage_counters {
+        atomic<uint64_t> items = 0;
+        atomic<uint64_t> bytes = 0;
+        atomic<uint64_t> busy_ns = 0;
+        atomic<uint64_t> depth_sum = 0;
+        atomic<uint64_t> depth_samples = 0;
+        atomic<size_t> max_depth = 0;
+
+        void sample_depth(size_t depth);
+    };
+
+    document_parser* parser_ = nullptr;
+    inverted_index* index_ = nullptr;
+    durable_index* durable_ = nullptr;
+    pipeline_config config_;
+
+    stage_counters readers_;
+    stage_counters parsers_;
+    stage_counters writers_;
+    double wall_ms_ = 0;
+
+    void read_stage(const vector<fs::path>& input_files, atomic<size_t>& next_file, bounded_queue<raw_document>& output);
+    static optional<string> read_compressed(const string& path);
+    void parse_stage(bounded_queue<raw_document>& input, bounded_queue<parsed_document>& output);
+    void write_stage(bounded_queue<parsed_document>& input);
+
+    [[nodiscard]] stage_metrics snapshot(const string& name, unsigned int threads, const stage_counters& counters) const;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "load_generator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ch = std::chrono;
+
+load_generator::load_generator(string host, uint16_t port) : host_(std::move(host)), port_(port) {}
+
+load_report load_generator::run(
+        const vector<string>& targets,
+        unsigned int connections,
+        size_t requests_per_connection,
+        unsigned int pipeline_depth
+) const {
+    vector<double> latencies;
+    uint64_t errors = 0;
+    std::mutex results_mutex;
+    vector<std::thread> clients;
+
+    pipeline_depth = std::max(pipeline_depth, 1u);
+
+    auto start = ch::steady_clock::now();
+
+    for (unsigned int c = 0; c < connections; ++c) {
+        clients.emplace_back([&, c] {
+            vector<double> local_latencies;
+            uint64_t local_errors = 0;
+            int fd = connect_socket();
+            string buffer;
+            char chunk[16 * 1024];
+            size_t next = c;
+
+            for (size_t sent = 0; fd >= 0 && sent < requests_per_connection;) {
+                unsigned int batch = std::min<size_t>(pipeline_depth, requests_per_connection - sent);
+                string requests;
+
+                for (unsigned int i = 0; i < batch; ++i) {
+                    requests += "GET " + targets[next++ % targets.size()] + " HTTP/1.1\r\nHost: " + host_ + "\r\n\r\n";
+                }
+
+                auto sent_at = ch::steady_clock::now();
+
+                if (send(fd, requests.data(), requests.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(requests.size())) {
+                    local_errors += requests_per_connection - sent;
+
+                    break;
+                }
+
+                bool broken = false;
+                unsigned int answered = 0;
+
+                for (; answered < batch; ++answered) {
+                    size_t header_end;
+                    size_t body_size = 0;
+                    bool complete = false;
+
+                    while (!complete) {
+                        header_end = buffer.find("\r\n\r\n");
+
+                        if (header_end != string::npos) {
+                            auto length = buffer.find("Content-Length: ");
+
+                            body_size = length != string::npos && length < header_end
+                                        ? std::strtoull(buffer.c_str() + length + 16, nullptr, 10) : 0;
+                            complete = buffer.size() >= header_end + 4 + body_size;
+                        }
+
+                        if (complete) {
+                            break;
+                        }
+
+                        ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+
+                        if (received <= 0) {
+                            broken = true;
+
+                            break;
+                        }
+
+                        buffer.append(chunk, received);
+                    }
+
+                    if (broken) {
+                        break;
+                    }
+
+                    if (buffer.compare(0, 12, "HTTP/1.1 200") != 0) {
+                        ++local_errors;
+                    }
+
+                    buffer.erase(0, header_end + 4 + body_size);
+                    local_latencies.push_back(ch::duration<double, std::milli>(ch::steady_clock::now() - sent_at).count());
+                }
+
+                // the answered part of the batch was already counted
+                if (broken) {
+                    local_errors += requests_per_connection - sent - answered;
+
+                    break;
+                }
+
+                sent += batch;
+            }
+
+            if (fd < 0) {
+                local_errors += requests_per_connection;
+            } else {
+                close(fd);
+            }
+
+            std::lock_guard lock(results_mutex);
+
+            latencies.insert(latencies.end(), local_latencies.begin(), local_latencies.end());
+            errors += local_errors;
+        });
+    }
+
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    load_report report;
+
+    report.connections = connections;
+    report.seconds = ch::duration<double>(ch::steady_clock::now() - start).count();
+    report.requests = latencies.size();
+    report.errors = errors;
+    report.qps = report.seconds > 0 ? static_cast<double>(report.requests) / report.seconds : 0;
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+
+        auto percentile = [&latencies](double p) {
+            return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+        };
+
+        report.p50_ms = percentile(0.5);
+        report.p99_ms = percentile(0.99);
+        report.p999_ms = percentile(0.999);
+        report.max_ms = latencies.back();
+    }
+
+    return report;
+}
+
+int load_generator::connect_socket() const {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    int enable = 1;
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port_);
+
+    if (fd < 0 || inet_pton(AF_INET, host_.c_str(), &address.sin_addr) != 1 ||
+        connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        return -1;
+    }
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    return fd;
+}
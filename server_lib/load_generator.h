@@ -0,0 +1,45 @@
+#ifndef INVERTED_INDEX_LIB_LOAD_GENERATOR_H
+#define INVERTED_INDEX_LIB_LOAD_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+struct load_report {
+    unsigned int connections = 0;
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    double seconds = 0;
+    double qps = 0;
+    double p50_ms = 0;
+    double p99_ms = 0;
+    double p999_ms = 0;
+    double max_ms = 0;
+};
+
+// Closed-loop HTTP load: every connection is a thread with one keep-alive
+// socket that sends pipeline_depth GET requests at a time and waits for their
+// responses before sending more. Latency counts from sending a request to
+// reading its whole response.
+class load_generator {
+public:
+    load_generator(string host, uint16_t port);
+
+    load_report run(
+            const vector<string>& targets,
+            unsigned int connections,
+            size_t requests_per_connection,
+            unsigned int pipeline_depth = 1
+    ) const;
+
+private:
+    string host_;
+    uint16_t port_;
+
+    int connect_socket() const;
+};
+
+#endif
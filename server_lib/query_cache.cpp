@@ -0,0 +1,134 @@
+#include "query_cache.h"
+#include <algorithm>
+#include <functional>
+
+double query_cache_stats::hit_rate() const {
+    auto lookups = hits + misses;
+
+    return lookups > 0 ? static_cast<double>(hits) / lookups : 0;
+}
+
+query_cache::query_cache(size_t capacity) {
+    size_t per_shard = std::max<size_t>(capacity / shards_num, 1);
+
+    for (size_t i = 0; i < shards_num; ++i) {
+        shards_.push_back(std::make_unique<shard>(per_shard));
+    }
+}
+
+optional<string> query_cache::find(const wstring& key, uint64_t generation) {
+    size_t hash = std::hash<wstring>{}(key);
+    auto& s = shard_of(hash);
+    std::lock_guard lock(s.shard_mutex);
+
+    s.sketch.record(hash);
+
+    auto it = s.entries.find(key);
+
+    if (it == s.entries.end()) {
+        ++s.stats.misses;
+
+        return std::nullopt;
+    }
+
+    if (it->second->generation != generation) {
+        s.lru.erase(it->second);
+        s.entries.erase(it);
+        ++s.stats.stale;
+        ++s.stats.misses;
+
+        return std::nullopt;
+    }
+
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    ++s.stats.hits;
+
+    return it->second->result;
+}
+
+void query_cache::insert(const wstring& key, uint64_t generation, const string& result) {
+    size_t hash = std::hash<wstring>{}(key);
+    auto& s = shard_of(hash);
+    std::lock_guard lock(s.shard_mutex);
+
+    if (auto it = s.entries.find(key); it != s.entries.end()) {
+        // a result computed against a newer index replaces the old one, never the other way round
+        if (it->second->generation <= generation) {
+            it->second->generation = generation;
+            it->second->result = result;
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+        }
+
+        return;
+    }
+
+    if (s.entries.size() >= s.capacity) {
+        auto& victim = s.lru.back();
+
+        if (s.sketch.estimate(hash) <= s.sketch.estimate(std::hash<wstring>{}(victim.key))) {
+            ++s.stats.rejected;
+
+            return;
+        }
+
+        s.entries.erase(victim.key);
+        s.lru.pop_back();
+        ++s.stats.evictions;
+    }
+
+    s.lru.push_front({key, generation, result});
+    s.entries.emplace(key, s.lru.begin());
+}
+
+void query_cache::clear() {
+    for (auto& s : shards_) {
+        std::lock_guard lock(s->shard_mutex);
+
+        s->lru.clear();
+        s->entries.clear();
+    }
+}
+
+query_cache_stats query_cache::stats() const {
+    query_cache_stats total;
+
+    for (const auto& s : shards_) {
+        std::lock_guard lock(s->shard_mutex);
+
+        total.hits += s->stats.hits;
+        total.misses += s->stats.misses;
+        total.stale += s->stats.stale;
+        total.evictions += s->stats.evictions;
+        total.rejected += s->stats.rejected;
+    }
+
+    return total;
+}
+
+// Terms sorted and joined, so the same set gives the same key whatever the
+// order the parser produced it in.
+wstring query_cache::make_key(const unordered_set<wstring>& terms) {
+    vector<const wstring*> sorted;
+    wstring key;
+
+    sorted.reserve(terms.size());
+
+    for (const auto& term : terms) {
+        sorted.push_back(&term);
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [](const wstring* lhs, const wstring* rhs) {
+        return *lhs < *rhs;
+    });
+
+    for (const auto* term : sorted) {
+        key += *term;
+        key += L'\0';
+    }
+
+    return key;
+}
+
+query_cache::shard& query_cache::shard_of(size_t hash) {
+    return *shards_[hash % shards_num];
+}
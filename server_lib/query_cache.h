@@ -0,0 +1,79 @@
+#ifndef INVERTED_INDEX_LIB_QUERY_CACHE_H
+#define INVERTED_INDEX_LIB_QUERY_CACHE_H
+
+#include "frequency_sketch.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using std::list;
+using std::mutex;
+using std::unique_ptr;
+using std::optional;
+using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+using std::wstring;
+
+struct query_cache_stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // entries found but computed before the last index change
+    uint64_t stale = 0;
+    uint64_t evictions = 0;
+    // misses the admission filter kept out to protect hotter entries
+    uint64_t rejected = 0;
+
+    [[nodiscard]] double hit_rate() const;
+};
+
+// Query results keyed by the normalized term set. The cache is split into
+// shards, each an LRU list behind its own mutex with a TinyLFU admission
+// filter: once a shard is full a new result only gets in if its key has been
+// asked for more often than the LRU victim's. Every result carries the index
+// generation it was computed at and is not served once the index moves on.
+class query_cache {
+public:
+    explicit query_cache(size_t capacity);
+
+    optional<string> find(const wstring& key, uint64_t generation);
+    void insert(const wstring& key, uint64_t generation, const string& result);
+    void clear();
+    [[nodiscard]] query_cache_stats stats() const;
+
+    static wstring make_key(const unordered_set<wstring>& terms);
+
+private:
+    struct entry {
+        wstring key;
+        uint64_t generation;
+        string result;
+    };
+
+    struct shard {
+        explicit shard(size_t capacity) : capacity(capacity), sketch(capacity) {}
+
+        mutable mutex shard_mutex;
+        size_t capacity;
+        list<entry> lru;
+        unordered_map<wstring, list<entry>::iterator> entries;
+        frequency_sketch sketch;
+        query_cache_stats stats;
+    };
+
+    static constexpr size_t shards_num = 16;
+
+    vector<unique_ptr<shard>> shards_;
+
+    shard& shard_of(size_t hash);
+};
+
+#endif
@@ -1,10 +1,20 @@
 #include "server.h"
+#include "byte_source.h"
+#include "binary_io.h"
+#include "json.hpp"
 #include <fstream>
 #include <iostream>
+#include <algorithm>
+#include <cwctype>
+#include <iterator>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
 
 using std::ifstream;
 using std::cout;
 using std::endl;
+using json = nlohmann::json;
 
 server::server(
         thread_pool *pool,
@@ -16,9 +26,15 @@ server::server(
     index_ = index;
     parser_ = parser;
     type_ = type;
+
+    parser_->set_dictionary(index_->dictionary());
 }
 
 server::~server() {
+    stop_serving();
+    stop_watch();
+    // merges run on the pool
+    segments_.reset();
     delete pool_;
     delete index_;
     delete parser_;
@@ -29,116 +45,1116 @@ long int server::run(const fs::path &input_dir, const fs::path& output_file) {
         throw std::runtime_error("Input directory does not exist");
     }
 
+    if (shards_ && !output_file.empty()) {
+        throw std::invalid_argument("Sharded runs keep the index in the shards and write no output file");
+    }
+
+    if (segments_ && !output_file.empty()) {
+        throw std::invalid_argument("Segmented runs keep the index in segments and write no output file");
+    }
+
+    auto start = ch::high_resolution_clock::now();
+
+    if (shards_) {
+        directory_crawler crawler(pool_);
+
+        shards_->index_files(crawler.crawl(input_dir));
+    } else if (checkpoint_dir_.empty()) {
+        process_dir(input_dir);
+        pool_->wait_all();
+
+        // what is left in the buffer goes to a segment, to be served like the rest
+        if (segments_) {
+            segments_->flush();
+        }
+    } else {
+        directory_crawler crawler(pool_);
+
+        open_checkpoints(true);
+        process_with_checkpoints(crawler.crawl(input_dir), {});
+    }
+
+    auto end = ch::high_resolution_clock::now();
+    auto duration = ch::duration_cast<ch::milliseconds>(end - start);
+
+    // the shards keep their parts to themselves and segments are not saved,
+    // either way there is no local index to save
+    if (!shards_ && !segments_) {
+        save_to_json(output_file);
+    }
+
+    if (durable_) {
+        durable_->checkpoint();
+    }
+
+    return duration.count();
+}
+
+// Continues a run from the checkpoints in the checkpoint directory: the
+// index comes back from the write-ahead log and the files the checkpoints
+// cover are skipped. Without a checkpoint it is a plain run.
+long int server::resume(const fs::path &input_dir, const fs::path& output_file) {
+    if (checkpoint_dir_.empty()) {
+        throw std::runtime_error("Checkpoints are not enabled");
+    }
+
+    if (!fs::exists(input_dir)) {
+        throw std::runtime_error("Input directory does not exist");
+    }
+
     auto start = ch::high_resolution_clock::now();
+    unordered_set<string> done;
+
+    open_checkpoints(false);
+    load_checkpoints(done);
 
-    process_dir(input_dir);
-    pool_->wait_all();
+    directory_crawler crawler(pool_);
+
+    process_with_checkpoints(crawler.crawl(input_dir), std::move(done));
 
     auto end = ch::high_resolution_clock::now();
     auto duration = ch::duration_cast<ch::milliseconds>(end - start);
 
     save_to_json(output_file);
+    durable_->checkpoint();
 
     return duration.count();
 }
 
-void server::process_dir(const fs::path &input_dir) {
-    vector<fs::path> input_files;
+// Every files_between files run and resume stop at a barrier and write a
+// checkpoint. Postings reach the disk through the write-ahead log (the one
+// enable_wal set up, or one of their own in dir), so a checkpoint only
+// records the files indexed since the previous one.
+void server::set_checkpoints(const fs::path& dir, size_t files_between) {
+    fs::create_directories(dir);
+    checkpoint_dir_ = dir;
+    checkpoint_files_ = std::max<size_t>(files_between, 1);
+}
+
+size_t server::skipped_files() const {
+    return skipped_files_;
+}
+
+// A fresh run drops whatever an earlier run left in the checkpoint directory,
+// a resume keeps it and recovers the index from it.
+void server::open_checkpoints(bool fresh) {
+    if (segments_) {
+        throw std::runtime_error("Checkpoints need the inverted index, not segments");
+    }
+
+    if (fresh) {
+        if (checkpoint_wal_) {
+            durable_.reset();
+        }
+
+        for (const auto& entry : fs::directory_iterator(checkpoint_dir_)) {
+            if (entry.path().filename().string().starts_with("checkpoint-")) {
+                fs::remove(entry.path());
+            }
+        }
+
+        fs::remove_all(checkpoint_dir_ / "wal");
+        checkpoint_seq_ = 0;
+    }
+
+    if (!durable_) {
+        durable_ = std::make_unique<durable_index>(index_, checkpoint_dir_ / "wal");
+        checkpoint_wal_ = true;
+    }
+}
+
+void server::process_with_checkpoints(const vector<crawled_file>& files, unordered_set<string> done) {
+    vector<crawled_file> remaining;
+
+    for (const auto& file : files) {
+        string path = file.path.string();
+
+        if (done.contains(path)) {
+            continue;
+        }
+
+        // logged in a round that crashed before its checkpoint, adding it
+        // again on top would count its terms twice
+        if (index_->contains_document(path)) {
+            remove_document(path);
+        }
+
+        remaining.push_back(file);
+    }
+
+    skipped_files_ = files.size() - remaining.size();
+
+    for (size_t begin = 0; begin < remaining.size(); begin += checkpoint_files_) {
+        vector<crawled_file> round(
+                remaining.begin() + static_cast<ptrdiff_t>(begin),
+                remaining.begin() + static_cast<ptrdiff_t>(std::min(begin + checkpoint_files_, remaining.size()))
+        );
+
+        process_files(round);
+        pool_->wait_all();
+        write_checkpoint(round);
+    }
+}
+
+static constexpr string_view progress_magic = "IIP1";
+
+// Written once the round's postings are durable in the log, atomically, so a
+// round either counts as done as a whole or not at all.
+void server::write_checkpoint(const vector<crawled_file>& round) {
+    uint64_t seq = ++checkpoint_seq_;
+    string progress(progress_magic);
+
+    put_u64(progress, round.size());
+
+    for (const auto& file : round) {
+        put_string(progress, file.path.string());
+    }
+
+    if (!write_file_atomically(checkpoint_path(seq).string(), progress)) {
+        throw std::runtime_error("Cannot write checkpoint to " + checkpoint_dir_.string());
+    }
+}
+
+// A progress file that cannot be read only costs its files being indexed
+// again, process_with_checkpoints drops what the log already holds of them.
+void server::load_checkpoints(unordered_set<string>& done) {
+    for (const auto& entry : fs::directory_iterator(checkpoint_dir_)) {
+        string name = entry.path().filename().string();
+        uint64_t seq;
+
+        if (!name.starts_with("checkpoint-") || !name.ends_with(".progress")) {
+            continue;
+        }
+
+        try {
+            seq = std::stoull(name.substr(11));
+        } catch (std::exception&) {
+            continue;
+        }
+
+        checkpoint_seq_ = std::max(checkpoint_seq_, seq);
+
+        auto progress = read_whole_file(entry.path().string());
+        uint64_t files_num;
+        vector<string> paths;
+
+        if (!progress || !progress->starts_with(progress_magic)) {
+            continue;
+        }
+
+        byte_reader reader(string_view(*progress).substr(progress_magic.size()));
+
+        if (!reader.u64(files_num)) {
+            continue;
+        }
+
+        for (uint64_t i = 0; i < files_num; ++i) {
+            string path;
+
+            if (!reader.str(path)) {
+                break;
+            }
+
+            paths.push_back(std::move(path));
+        }
+
+        if (paths.size() == files_num) {
+            done.insert(paths.begin(), paths.end());
+        }
+    }
+}
+
+fs::path server::checkpoint_path(uint64_t seq) const {
+    return checkpoint_dir_ / ("checkpoint-" + std::to_string(seq) + ".progress");
+}
+
+// Brings the index saved at output_file up to date with input_dir: deleted
+// files are removed, only added files and files whose content hash changed
+// are parsed. Size and mtime decide which files get hashed at all. Without a
+// manifest from an earlier run everything counts as added.
+long int server::run_incremental(const fs::path &input_dir, const fs::path& output_file) {
+    if (!fs::exists(input_dir)) {
+        throw std::runtime_error("Input directory does not exist");
+    }
+
+    if (segments_) {
+        throw std::runtime_error("Incremental runs need the inverted index, not segments");
+    }
+
+    auto start = ch::high_resolution_clock::now();
+
+    // the snapshot keeps frequencies and document lengths, the JSON output does not
+    if (manifest_.entries().empty() && manifest_.load(manifest_path(output_file))) {
+        index_->clear();
+
+        if (!index_->load_snapshot(snapshot_path(output_file).string())) {
+            index_->clear();
+            manifest_.clear();
+        }
+    }
+
+    directory_crawler crawler(pool_);
+    auto files = crawler.crawl(input_dir);
+    unordered_set<string> present;
+    vector<crawled_file> to_index;
+    vector<string> to_remove;
+
+    last_delta_ = {};
+
+    for (const auto& file : files) {
+        string path = file.path.string();
+        const manifest_entry* entry = manifest_.find(path);
+
+        present.insert(path);
+
+        if (entry == nullptr) {
+            ++last_delta_.added;
+            to_index.push_back(file);
+        } else if (entry->size == file.size && entry->mtime_ns == file.mtime_ns) {
+            ++last_delta_.unchanged;
+        } else if (file.size == entry->size && index_manifest::hash_file(file.path) == entry->hash) {
+            ++last_delta_.unchanged;
+            manifest_.set(path, {file.size, file.mtime_ns, entry->hash});
+        } else {
+            ++last_delta_.changed;
+            to_remove.push_back(path);
+            to_index.push_back(file);
+        }
+    }
+
+    for (const auto& [path, entry] : manifest_.entries()) {
+        if (!present.contains(path)) {
+            ++last_delta_.removed;
+            to_remove.push_back(path);
+        }
+    }
+
+    for (const auto& path : to_remove) {
+        remove_document(path);
+        manifest_.erase(path);
+    }
+
+    index_incrementally(to_index);
+
+    // changed files dropped their old postings on re-add, this purges the deleted ones
+    index_->compact();
+
+    auto end = ch::high_resolution_clock::now();
+    auto duration = ch::duration_cast<ch::milliseconds>(end - start);
+
+    save_to_json(output_file);
+    index_->save_snapshot(snapshot_path(output_file).string());
+    manifest_.save(manifest_path(output_file));
+
+    return duration.count();
+}
+
+const index_delta& server::last_delta() const {
+    return last_delta_;
+}
+
+fs::path server::manifest_path(const fs::path& output_file) {
+    fs::path path = output_file;
+
+    return path += ".manifest.json";
+}
+
+fs::path server::snapshot_path(const fs::path& output_file) {
+    fs::path path = output_file;
+
+    return path += ".snapshot";
+}
+
+// Each file is read once: the manifest hash is taken over the same bytes the
+// parser sees, so a file rewritten mid-run is recorded as what got indexed.
+void server::index_incrementally(const vector<crawled_file>& files) {
+    vector<optional<uint64_t>> hashes(files.size());
+    size_t chunks = std::min<size_t>(files.size(), pool_->size() * units_per_worker);
+    vector<task_id_t> tasks;
+
+    for (size_t c = 0; c < chunks; ++c) {
+        tasks.push_back(pool_->add_task([this, &files, &hashes, c, chunks] {
+            for (size_t f = files.size() * c / chunks; f < files.size() * (c + 1) / chunks; ++f) {
+                auto content = read_document(files[f].path.string());
+
+                if (!content) {
+                    continue;
+                }
+
+                hashes[f] = index_manifest::hash_bytes(*content);
+                add_document(files[f].path, parser_->parse_bytes_term_ids(*content));
+            }
+
+            return true;
+        }));
+    }
+
+    for (auto task : tasks) {
+        pool_->wait(task);
+    }
+
+    for (size_t f = 0; f < files.size(); ++f) {
+        if (hashes[f]) {
+            manifest_.set(files[f].path.string(), {files[f].size, files[f].mtime_ns, *hashes[f]});
+        }
+    }
+}
+
+// Starts indexing changes under input_dir on a background thread while read
+// keeps serving. Events are collected for up to batch_window_ms after the
+// first one (or until max_batch) and applied together.
+void server::watch(const fs::path &input_dir, const watch_config& config) {
+    if (watching_) {
+        throw std::runtime_error("Already watching a directory");
+    }
+
+    watcher_ = std::make_unique<directory_watcher>(input_dir);
+    watch_config_ = config;
+    watching_ = true;
+    watch_thread_ = thread(&server::watch_loop, this);
+    index_->start_compaction(ch::seconds(1));
+}
+
+void server::stop_watch() {
+    if (!watching_) {
+        return;
+    }
+
+    watching_ = false;
+    watcher_->wake();
+    watch_thread_.join();
+    watcher_.reset();
+    index_->stop_compaction();
+}
 
-    for (const auto& entry : fs::directory_iterator(input_dir)) {
-        if (fs::is_directory(entry)) {
-            parse_dir_task(entry);
-        } else if (fs::is_regular_file(entry)) {
-            switch (type_) {
-                case WORD_FILE:
-                    word_file_task(entry);
-                    break;
-
-                case WORD_FILES:
-                case INDEX:
-                    input_files.push_back(entry);
-                    break;
+watch_metrics server::watch_stats() const {
+    write_lock_m lock(watch_metrics_mutex_);
+
+    return watch_metrics_;
+}
+
+void server::watch_loop() {
+    while (watching_) {
+        auto events = watcher_->poll(-1);
+
+        if (events.empty()) {
+            continue;
+        }
+
+        auto deadline = ch::steady_clock::now() + ch::milliseconds(watch_config_.batch_window_ms);
+
+        while (watching_ && events.size() < watch_config_.max_batch) {
+            auto left = ch::duration_cast<ch::milliseconds>(deadline - ch::steady_clock::now()).count();
+
+            if (left <= 0) {
+                break;
             }
+
+            auto more = watcher_->poll(static_cast<int>(left));
+
+            events.insert(events.end(), std::make_move_iterator(more.begin()), std::make_move_iterator(more.end()));
+        }
+
+        apply_events(events);
+    }
+}
+
+// Only the last event per file counts. A written file may have been indexed
+// before, so its old postings go first.
+void server::apply_events(const vector<file_event>& events) {
+    unordered_map<string, const file_event*> latest;
+
+    for (const auto& event : events) {
+        latest[event.path.string()] = &event;
+    }
+
+    vector<pair<string, ch::system_clock::time_point>> landed;
+    vector<task_id_t> tasks;
+    uint64_t removed = 0;
+
+    // rewritten files drop their old postings on re-add, deletes are left to background compaction
+    for (const auto& [path, event] : latest) {
+        remove_document(path);
+    }
+
+    for (const auto& [path, event] : latest) {
+        if (event->type == FILE_REMOVED) {
+            landed.emplace_back(path, event->detected_at);
+            ++removed;
+
+            continue;
+        }
+
+        std::error_code error;
+        auto mtime = fs::last_write_time(event->path, error);
+
+        if (error) {
+            continue;
         }
+
+        landed.emplace_back(path, ch::file_clock::to_sys(mtime));
+        tasks.push_back(pool_->add_task([this, path = event->path] {
+            auto terms = parser_->parse_document_term_ids(path);
+
+            add_document(path, terms);
+
+            return true;
+        }));
+    }
+
+    for (auto task : tasks) {
+        pool_->wait(task);
+    }
+
+    auto applied_at = ch::system_clock::now();
+    write_lock_m lock(watch_metrics_mutex_);
+
+    watch_metrics_.events += events.size();
+    ++watch_metrics_.batches;
+    watch_metrics_.documents_indexed += tasks.size();
+    watch_metrics_.documents_removed += removed;
+
+    for (const auto& [path, at] : landed) {
+        double freshness = std::max(0.0, ch::duration<double, std::milli>(applied_at - at).count());
+
+        watch_metrics_.last_freshness_ms = freshness;
+        watch_metrics_.max_freshness_ms = std::max(watch_metrics_.max_freshness_ms, freshness);
+        freshness_sum_ms_ += freshness;
+    }
+
+    uint64_t samples = watch_metrics_.documents_indexed + watch_metrics_.documents_removed;
+
+    if (samples > 0) {
+        watch_metrics_.avg_freshness_ms = freshness_sum_ms_ / static_cast<double>(samples);
+    }
+}
+
+// Logs every document added or removed from now on to a write-ahead log in
+// dir, after first recovering the index from what dir already holds. Only
+// the per-document paths (WORD_FILE, watch and incremental runs) are logged.
+void server::enable_wal(const fs::path& dir, const wal_config& config) {
+    if (segments_) {
+        throw std::runtime_error("The write-ahead log only covers the inverted index, not segments");
     }
 
-    if (type_ == WORD_FILES) {
-        word_files_task(input_files);
-    } else if (type_ == INDEX) {
-        index_task(input_files);
+    durable_ = std::make_unique<durable_index>(index_, dir, config);
+    checkpoint_wal_ = false;
+}
+
+void server::add_document(const fs::path& path, const term_id_frequencies& terms) {
+    if (segments_) {
+        segments_->add(path.string(), terms);
+    } else if (durable_) {
+        durable_->add(path.string(), terms);
+    } else {
+        index_->add(path.string(), terms);
+    }
+}
+
+// Bulk loads put documents into the index their own way, with a write-ahead
+// log they are logged as one batch first.
+void server::add_documents(const document_terms& docs, const function<void()>& apply) {
+    if (durable_) {
+        durable_->add_batch(docs, apply);
+    } else {
+        apply();
     }
 }
 
+void server::remove_document(const string& path) {
+    if (segments_) {
+        segments_->remove(path);
+    } else if (durable_) {
+        durable_->remove(path);
+    } else {
+        index_->remove_document_from_all_records(path);
+    }
+}
+
+void server::process_dir(const fs::path &input_dir) {
+    directory_crawler crawler(pool_);
+
+    process_files(crawler.crawl(input_dir));
+}
+
+void server::process_files(const vector<crawled_file>& files) {
+    // segments take whole documents, the bulk shapes of the other modes do not fit them
+    if (segments_) {
+        for (const auto& file : files) {
+            pool_->add_task([this, path = file.path] {
+                add_document(path, parser_->parse_document_term_ids(path));
+
+                return true;
+            });
+        }
+
+        return;
+    }
+
+    switch (type_) {
+        case WORD_FILE:
+            for (const auto& file : files) {
+                word_file_task(file.path, file.size);
+            }
+
+            break;
+
+        case WORD_FILES:
+        case INDEX:
+            for (const auto& unit : directory_crawler::partition(files, pool_->size() * units_per_worker)) {
+                vector<fs::path> input_files;
+
+                for (auto file : unit.files) {
+                    input_files.push_back(files[file].path);
+                }
+
+                if (type_ == WORD_FILES) {
+                    word_files_task(input_files);
+                } else {
+                    index_task(input_files);
+                }
+            }
+
+            break;
+
+        case MAP_REDUCE:
+            map_reduce(files);
+            break;
+
+        case PIPELINE:
+            run_pipeline(files);
+            break;
+    }
+}
+
+// Handlers run on the pool, so a query never blocks the connection loop.
+void server::serve(const http_config& config) {
+    if (endpoint_) {
+        return;
+    }
+
+    endpoint_ = std::make_unique<http_endpoint>(pool_, config);
+
+    endpoint_->route("GET", "/search", [this](const http_request& request) {
+        auto q = request.query.find("q");
+
+        if (q == request.query.end() || q->second.empty()) {
+            return http_response{400, "application/json", R"({"error":"missing q"})"};
+        }
+
+        json body = {{"query", q->second}, {"document", read(q->second)}};
+
+        return http_response{200, "application/json", body.dump()};
+    });
+
+    endpoint_->route("GET", "/stats", [this](const http_request&) {
+        auto watched = watch_stats();
+        auto cached = cache_stats();
+        json body = {
+            {"terms", index_->dictionary()->size()},
+            {"tombstones", index_->tombstones_num()},
+            {"cache", {
+                {"hits", cached.hits},
+                {"misses", cached.misses},
+                {"stale", cached.stale}
+            }},
+            {"watch", {
+                {"events", watched.events},
+                {"documents_indexed", watched.documents_indexed},
+                {"documents_removed", watched.documents_removed},
+                {"avg_freshness_ms", watched.avg_freshness_ms}
+            }}
+        };
+
+        return http_response{200, "application/json", body.dump()};
+    });
+
+    endpoint_->route("GET", "/health", [](const http_request&) {
+        return http_response{200, "application/json", R"({"status":"ok"})"};
+    });
+
+    endpoint_->start();
+}
+
+void server::stop_serving() {
+    if (endpoint_) {
+        endpoint_->stop();
+        endpoint_.reset();
+    }
+}
+
+uint16_t server::serving_port() const {
+    return endpoint_ ? endpoint_->port() : 0;
+}
+
 void server::save_to_json(const fs::path &output_dir) {
     index_->save_as_json(output_dir);
 }
 
+// The generation is taken before the index is read, so a result that raced
+// with a change is stored as already stale.
 document server::read(const string& content) const {
+    if (shards_) {
+        auto top = shards_->search(content, 1);
+
+        return top.empty() ? document() : top.front().name;
+    }
+
+    auto words = parse_query(content);
+
+    if (segments_) {
+        return segments_->read(words);
+    }
+
+    if (!cache_) {
+        return index_->read(words);
+    }
+
+    auto key = query_cache::make_key(words);
+    auto generation = index_->generation();
+
+    if (auto cached = cache_->find(key, generation)) {
+        return *cached;
+    }
+
+    auto result = index_->read(words);
+
+    cache_->insert(key, generation, result);
+
+    return result;
+}
+
+// Queries are parsed in parallel, then evaluated together so terms shared
+// across the batch are looked up once. Not to be called from a pool task.
+vector<document> server::read_batch(const vector<string>& contents) const {
+    if (shards_) {
+        vector<document> results;
+
+        for (const auto& top : shards_->search_batch(contents, 1)) {
+            results.push_back(top.empty() ? document() : top.front().name);
+        }
+
+        return results;
+    }
+
+    vector<unordered_set<word>> queries(contents.size());
+    size_t chunks = std::min<size_t>(contents.size(), pool_->size() * units_per_worker);
+    vector<task_id_t> tasks;
+
+    for (size_t c = 0; c < chunks; ++c) {
+        tasks.push_back(pool_->add_task([this, &contents, &queries, c, chunks] {
+            for (size_t q = contents.size() * c / chunks; q < contents.size() * (c + 1) / chunks; ++q) {
+                queries[q] = parse_query(contents[q]);
+            }
+
+            return true;
+        }));
+    }
+
+    for (auto task : tasks) {
+        pool_->wait(task);
+    }
+
+    if (segments_) {
+        vector<document> results;
+
+        results.reserve(queries.size());
+
+        for (const auto& query : queries) {
+            results.push_back(segments_->read(query));
+        }
+
+        return results;
+    }
+
+    return index_->read_batch(queries, pool_);
+}
+
+void server::enable_query_cache(size_t capacity) {
+    cache_ = std::make_unique<query_cache>(capacity);
+}
+
+// From then on run hands the files to the shard processes instead of the
+// local index and writes no output file, and read and read_batch ask the
+// shards. The shards parse queries themselves, without wildcards or fuzzy
+// matching.
+void server::enable_shards(const shard_config& config) {
+    shards_ = std::make_unique<shard_coordinator>(config);
+}
+
+// From then on documents go into a segmented_index sharing the inverted
+// index's dictionary, which run, watch, read and read_batch use instead of
+// the inverted index. Segments are not saved as an output file and do not
+// go through the write-ahead log.
+void server::enable_segments(const segment_config& config) {
+    if (durable_ || !checkpoint_dir_.empty()) {
+        throw std::runtime_error("The write-ahead log only covers the inverted index, not segments");
+    }
+
+    segments_ = std::make_unique<segmented_index>(index_->dictionary(), pool_, config);
+}
+
+segment_stats server::segments_stats() const {
+    return segments_ ? segments_->stats() : segment_stats{};
+}
+
+// With a segment directory reads decode mapped postings through this cache.
+posting_cache_stats server::postings_cache_stats() const {
+    return segments_ ? segments_->cache_stats() : posting_cache_stats{};
+}
+
+query_cache_stats server::cache_stats() const {
+    return cache_ ? cache_->stats() : query_cache_stats{};
+}
+
+unordered_set<word> server::parse_query(const string& content) const {
     wstring wcontent = document_parser::string_to_wstring(content);
+    unordered_set<word> expanded = expand_wildcards(wcontent);
     unordered_set<word> words = parser_->parse_words(wcontent);
 
-    return index_->read(words);
+    if (fuzzy_distance_ > 0) {
+        words = correct_words(words);
+    }
+
+    words.insert(expanded.begin(), expanded.end());
+
+    return words;
 }
 
-void server::word_file_task(const fs::path &input_file) {
-    pool_->add_task([this, input_file] {
-        auto words = parser_->parse_document(input_file);
+void server::set_fuzzy_distance(uint32_t max_distance) {
+    fuzzy_distance_ = max_distance;
+
+    if (max_distance == 0 || trigrams_ != nullptr) {
+        return;
+    }
+
+    auto* dictionary = index_->dictionary();
+
+    trigrams_ = std::make_unique<trigram_index>(dictionary);
+    parser_->set_trigram_index(trigrams_.get());
+
+    for (term_id id = 0; id < dictionary->size(); ++id) {
+        trigrams_->add(id, dictionary->term(id));
+    }
+}
+
+// Cuts tokens like "film*" or "f?lm" out of the query and returns the indexed
+// terms they match. Patterns are lowercased but not stemmed.
+unordered_set<word> server::expand_wildcards(wstring& content) const {
+    unordered_set<word> result;
+    size_t begin = 0;
+    auto is_separator = [](wchar_t c) {
+        return c == L'\0' || iswspace(c);
+    };
+
+    while (begin < content.size()) {
+        if (is_separator(content[begin])) {
+            ++begin;
+
+            continue;
+        }
+
+        size_t end = begin;
 
-        for (const auto& word : words) {
-            index_->add(word, input_file);
+        while (end < content.size() && !is_separator(content[end])) {
+            ++end;
         }
 
+        wstring token = content.substr(begin, end - begin);
+
+        if (token.find_first_of(L"*?") != wstring::npos) {
+            std::transform(token.begin(), token.end(), token.begin(), towlower);
+
+            for (auto& term : index_->expand_wildcard(token)) {
+                result.insert(std::move(term));
+            }
+
+            std::fill(content.begin() + static_cast<long>(begin), content.begin() + static_cast<long>(end), L' ');
+        }
+
+        begin = end;
+    }
+
+    return result;
+}
+
+unordered_set<word> server::correct_words(const unordered_set<word>& words) const {
+    unordered_set<word> result;
+
+    for (const auto& w : words) {
+        if (index_->contains(w)) {
+            result.insert(w);
+
+            continue;
+        }
+
+        term_id id = trigrams_->best_match(w, fuzzy_distance_);
+
+        result.insert(id != term_dictionary::no_term ? index_->dictionary()->term(id) : w);
+    }
+
+    return result;
+}
+
+void server::set_split_size(uint64_t split_size) {
+    split_size_ = split_size;
+}
+
+void server::set_pipeline_config(const pipeline_config& config) {
+    pipeline_config_ = config;
+}
+
+const vector<stage_metrics>& server::pipeline_metrics() const {
+    return pipeline_metrics_;
+}
+
+void server::word_file_task(const fs::path &input_file, uint64_t size) {
+    if (split_size_ > 0 && size > split_size_ && !is_compressed(input_file)) {
+        for (uint64_t begin = 0; begin < size; begin += split_size_) {
+            word_file_range_task(input_file, begin, std::min(begin + split_size_, size));
+        }
+
+        return;
+    }
+
+    pool_->add_task([this, input_file] {
+        auto terms = parser_->parse_document_term_ids(input_file);
+
+        add_document(input_file, terms);
+
+        return true;
+    });
+}
+
+void server::word_file_range_task(const fs::path &input_file, uint64_t begin, uint64_t end) {
+    pool_->add_task([this, input_file, begin, end] {
+        auto terms = parser_->parse_document_term_ids(input_file, begin, end);
+
+        add_document(input_file, terms);
+
         return true;
     });
 }
 
 void server::word_files_task(const vector<fs::path> &input_files) {
     pool_->add_task([this, input_files] {
-        inv_index index;
+        unordered_map<term_id, document_frequencies> index;
+        document_terms logged;
 
         for (const auto& file : input_files) {
-            auto words = parser_->parse_document(file);
+            auto terms = parser_->parse_document_term_ids(file);
+            string path = file.string();
 
-            for (const auto& word : words) {
-                index[word].insert(file);
+            for (const auto& [id, count] : terms) {
+                index[id][path] += count;
             }
-        }
 
-        for (const auto& [word, docs] : index) {
-            index_->add(word, docs);
+            if (durable_) {
+                logged.emplace_back(path, std::move(terms));
+            }
         }
 
+        // one add per term, with the counts the log replays
+        add_documents(logged, [this, &index] {
+            for (auto& [id, docs] : index) {
+                index_->add(term_postings{{id, std::move(docs)}});
+            }
+        });
+
         return true;
     });
 }
 
 void server::index_task(const vector<fs::path> &input_files) {
     pool_->add_task([this, input_files] {
-        inv_index index;
+        unordered_map<term_id, document_frequencies> index;
+        document_terms logged;
 
         for (const auto& file : input_files) {
-            auto words = parser_->parse_document(file);
+            auto terms = parser_->parse_document_term_ids(file);
+            string path = file.string();
 
-            for (const auto& word : words) {
-                index[word].insert(file);
+            for (const auto& [id, count] : terms) {
+                index[id][path] += count;
+            }
+
+            if (durable_) {
+                logged.emplace_back(path, std::move(terms));
             }
         }
 
-        index_->add(index);
+        add_documents(logged, [this, &index] {
+            index_->add(term_postings(std::make_move_iterator(index.begin()), std::make_move_iterator(index.end())));
+        });
 
         return true;
     });
 }
 
-void server::parse_dir_task(const fs::path &input_dir) {
-    pool_->add_task([this, input_dir] {
-        try {
-            process_dir(input_dir);
-        } catch (std::runtime_error& e) {
-            return false;
+// Map: the files of the whole tree are split into one byte-balanced chunk per
+// worker and every chunk builds a private partial index sorted by term id.
+// Reduce: the term id space is cut into ranges, and each range k-way merges
+// its slice of every partial index into the shared index in one bulk add.
+void server::map_reduce(const vector<crawled_file>& files) {
+    vector<fs::path> input_files;
+    size_t workers_num = std::max(1u, pool_->size());
+    auto chunks = directory_crawler::partition(files, workers_num);
+
+    input_files.reserve(files.size());
+
+    for (const auto& file : files) {
+        input_files.push_back(file.path);
+    }
+    vector<partial_index> partials(chunks.size());
+    vector<document_terms> logged(chunks.size());
+    vector<task_id_t> tasks;
+
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        tasks.push_back(pool_->add_task([this, &input_files, &chunks, &partials, &logged, c] {
+            auto& partial = partials[c];
+            auto& chunk_logged = logged[c];
+
+            parse_files(input_files, chunks[c].files, [this, &input_files, &partial, &chunk_logged](uint32_t file, const term_id_frequencies& terms) {
+                for (const auto& [id, count] : terms) {
+                    partial.push_back({id, file, count});
+                }
+
+                if (durable_) {
+                    chunk_logged.emplace_back(input_files[file].string(), terms);
+                }
+            });
+
+            std::sort(partial.begin(), partial.end());
+
+            return true;
+        }));
+    }
+
+    for (auto task : tasks) {
+        pool_->wait(task);
+    }
+
+    tasks.clear();
+
+    document_terms all_logged;
+
+    for (auto& chunk_logged : logged) {
+        std::move(chunk_logged.begin(), chunk_logged.end(), std::back_inserter(all_logged));
+    }
+
+    // the whole tree is logged as one batch, the reduce ranges apply it
+    add_documents(all_logged, [this, &input_files, &partials, &tasks, workers_num] {
+        auto terms_num = static_cast<uint64_t>(index_->dictionary()->size());
+
+        for (size_t r = 0; r < workers_num; ++r) {
+            auto begin = static_cast<term_id>(terms_num * r / workers_num);
+            auto end = static_cast<term_id>(terms_num * (r + 1) / workers_num);
+
+            tasks.push_back(pool_->add_task([this, &input_files, &partials, begin, end] {
+                index_->add(merge_range(partials, input_files, begin, end));
+
+                return true;
+            }));
         }
 
-        return true;
+        for (auto task : tasks) {
+            pool_->wait(task);
+        }
     });
 }
 
+// Plain files are read batch_file_reader::default_depth at a time,
+// compressed ones are streamed through the parser.
+void server::parse_files(
+        const vector<fs::path>& input_files,
+        const vector<uint32_t>& files,
+        const function<void(uint32_t, const term_id_frequencies&)>& on_document
+) {
+    batch_file_reader reader;
+    size_t batch = batch_file_reader::default_depth;
+
+    for (size_t begin = 0; begin < files.size(); begin += batch) {
+        size_t end = std::min(begin + batch, files.size());
+        vector<string> paths;
+        vector<uint32_t> plain_files;
+
+        for (size_t i = begin; i < end; ++i) {
+            const auto& path = input_files[files[i]];
+
+            if (is_compressed(path)) {
+                on_document(files[i], parser_->parse_document_term_ids(path));
+            } else {
+                paths.push_back(path.string());
+                plain_files.push_back(files[i]);
+            }
+        }
+
+        auto contents = reader.read(paths);
+
+        for (size_t i = 0; i < contents.size(); ++i) {
+            if (!contents[i].has_value()) {
+                std::cerr << "Cannot open file" << paths[i] << endl;
+
+                continue;
+            }
+
+            on_document(plain_files[i], parser_->parse_bytes_term_ids(*contents[i]));
+        }
+    }
+}
+
+term_postings server::merge_range(
+        const vector<partial_index>& partials,
+        const vector<fs::path>& input_files,
+        term_id begin,
+        term_id end
+) const {
+    using cursor = std::tuple<posting, size_t, size_t>;
+    auto greater = [](const cursor& lhs, const cursor& rhs) {
+        return std::get<0>(rhs) < std::get<0>(lhs);
+    };
+    std::priority_queue<cursor, vector<cursor>, decltype(greater)> heap(greater);
+    term_postings result;
+
+    for (size_t p = 0; p < partials.size(); ++p) {
+        const auto& partial = partials[p];
+        auto it = std::lower_bound(partial.begin(), partial.end(), posting{begin, 0, 0});
+
+        if (it != partial.end() && it->id < end) {
+            heap.emplace(*it, p, it - partial.begin());
+        }
+    }
+
+    while (!heap.empty()) {
+        auto [current, p, i] = heap.top();
+
+        heap.pop();
+
+        if (result.empty() || result.back().first != current.id) {
+            result.emplace_back(current.id, document_frequencies());
+        }
+
+        result.back().second[input_files[current.document].string()] += current.count;
+
+        if (++i < partials[p].size() && partials[p][i].id < end) {
+            heap.emplace(partials[p][i], p, i);
+        }
+    }
+
+    return result;
+}
+
+// Runs on its own reader, parser and writer threads, the pool stays idle.
+void server::run_pipeline(const vector<crawled_file>& files) {
+    ingest_pipeline pipeline(parser_, index_, pipeline_config_, durable_.get());
+    vector<fs::path> input_files;
+
+    input_files.reserve(files.size());
+
+    for (const auto& file : files) {
+        input_files.push_back(file.path);
+    }
+
+    pipeline.run(input_files);
+    pipeline_metrics_ = pipeline.metrics();
+}
@@ -4,18 +4,62 @@
 #include "thread_pool.h"
 #include "inverted_index.h"
 #include "document_parser.h"
+#include "trigram_index.h"
+#include "ingest_pipeline.h"
+#include "directory_crawler.h"
+#include "index_manifest.h"
+#include "directory_watcher.h"
+#include "durable_index.h"
+#include "segmented_index.h"
+#include "http_endpoint.h"
+#include "query_cache.h"
+#include "shard_coordinator.h"
 #include "../enums_lib/processing_type.h"
 
 #include <string>
 #include <filesystem>
 #include <vector>
 #include <chrono>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 namespace fs = std::filesystem;
 namespace ch = std::chrono;
 
 using std::string;
 using std::vector;
+using std::unique_ptr;
+using std::function;
+using std::thread;
+using std::atomic;
+using std::mutex;
+
+struct index_delta {
+    size_t added = 0;
+    size_t changed = 0;
+    size_t removed = 0;
+    size_t unchanged = 0;
+};
+
+struct watch_config {
+    uint32_t batch_window_ms = 200;
+    size_t max_batch = 1024;
+};
+
+// Freshness is the time from a file landing on disk (its mtime, or the event
+// itself for deletes) until the change is searchable.
+struct watch_metrics {
+    uint64_t events = 0;
+    uint64_t batches = 0;
+    uint64_t documents_indexed = 0;
+    uint64_t documents_removed = 0;
+    double last_freshness_ms = 0;
+    double max_freshness_ms = 0;
+    double avg_freshness_ms = 0;
+};
 
 class server {
 public:
@@ -26,23 +70,123 @@ public:
             processing_type& type
     );
     ~server();
+    // Indexes input_dir and saves the index as JSON to output_file. With
+    // shards the index stays in the shard processes and with segments in the
+    // segments: output_file has to be empty, std::invalid_argument otherwise.
     long int run(const fs::path& input_dir, const fs::path& output_file);
+    long int run_incremental(const fs::path& input_dir, const fs::path& output_file);
+    [[nodiscard]] const index_delta& last_delta() const;
+    static fs::path manifest_path(const fs::path& output_file);
+    static fs::path snapshot_path(const fs::path& output_file);
+    void watch(const fs::path& input_dir, const watch_config& config = {});
+    void stop_watch();
+    [[nodiscard]] watch_metrics watch_stats() const;
+    void enable_wal(const fs::path& dir, const wal_config& config = {});
+    void set_checkpoints(const fs::path& dir, size_t files_between);
+    long int resume(const fs::path& input_dir, const fs::path& output_file);
+    [[nodiscard]] size_t skipped_files() const;
+    void serve(const http_config& config = {});
+    void stop_serving();
+    [[nodiscard]] uint16_t serving_port() const;
     void save_to_json(const fs::path& output_dir);
     [[nodiscard]] document read(const string& content) const;
+    [[nodiscard]] vector<document> read_batch(const vector<string>& contents) const;
+    void enable_query_cache(size_t capacity);
+    void enable_shards(const shard_config& config);
+    void enable_segments(const segment_config& config);
+    [[nodiscard]] segment_stats segments_stats() const;
+    [[nodiscard]] posting_cache_stats postings_cache_stats() const;
+    [[nodiscard]] query_cache_stats cache_stats() const;
+    void set_split_size(uint64_t split_size);
+    void set_fuzzy_distance(uint32_t max_distance);
+    void set_pipeline_config(const pipeline_config& config);
+    [[nodiscard]] const vector<stage_metrics>& pipeline_metrics() const;
 
 private:
     thread_pool *pool_ = nullptr;
     inverted_index *index_ = nullptr;
     document_parser *parser_ = nullptr;
     processing_type type_ = WORD_FILE;
+    uint64_t split_size_ = 0;
+    uint32_t fuzzy_distance_ = 0;
+    unique_ptr<trigram_index> trigrams_;
+    pipeline_config pipeline_config_;
+    vector<stage_metrics> pipeline_metrics_;
+    index_manifest manifest_;
+    index_delta last_delta_;
 
-    void process_dir(const fs::path& input_dir);
+    unique_ptr<directory_watcher> watcher_;
+    thread watch_thread_;
+    atomic<bool> watching_ = false;
+    watch_config watch_config_;
+    watch_metrics watch_metrics_;
+    double freshness_sum_ms_ = 0;
+    mutable mutex watch_metrics_mutex_;
+
+    unique_ptr<durable_index> durable_;
+
+    fs::path checkpoint_dir_;
+    size_t checkpoint_files_ = 0;
+    uint64_t checkpoint_seq_ = 0;
+    // durable_ was opened by the checkpoints, not by enable_wal
+    bool checkpoint_wal_ = false;
+    size_t skipped_files_ = 0;
 
-    void parse_dir_task(const fs::path& input_dir);
+    unique_ptr<http_endpoint> endpoint_;
+    unique_ptr<query_cache> cache_;
+    unique_ptr<shard_coordinator> shards_;
+    unique_ptr<segmented_index> segments_;
 
-    void word_file_task(const fs::path &input_dir);
+    struct posting {
+        term_id id;
+        uint32_t document;
+        uint32_t count;
+
+        bool operator<(const posting& other) const {
+            return id != other.id ? id < other.id : document < other.document;
+        }
+    };
+
+    using partial_index = vector<posting>;
+
+    // more work units than workers, so the pool queue evens out what the byte count misses
+    static constexpr size_t units_per_worker = 4;
+
+    void process_dir(const fs::path& input_dir);
+    void process_files(const vector<crawled_file>& files);
+    void index_incrementally(const vector<crawled_file>& files);
+    void open_checkpoints(bool fresh);
+    void process_with_checkpoints(const vector<crawled_file>& files, unordered_set<string> done);
+    void write_checkpoint(const vector<crawled_file>& round);
+    void load_checkpoints(unordered_set<string>& done);
+    [[nodiscard]] fs::path checkpoint_path(uint64_t seq) const;
+    void add_document(const fs::path& path, const term_id_frequencies& terms);
+    void add_documents(const document_terms& docs, const function<void()>& apply);
+    void remove_document(const string& path);
+    void watch_loop();
+    void apply_events(const vector<file_event>& events);
+    [[nodiscard]] unordered_set<word> parse_query(const string& content) const;
+    [[nodiscard]] unordered_set<word> correct_words(const unordered_set<word>& words) const;
+    [[nodiscard]] unordered_set<word> expand_wildcards(wstring& content) const;
+
+    void word_file_task(const fs::path &input_file, uint64_t size);
+    void word_file_range_task(const fs::path &input_file, uint64_t begin, uint64_t end);
     void word_files_task(const vector<fs::path> &input_files);
     void index_task(const vector<fs::path> &input_files);
+
+    void map_reduce(const vector<crawled_file>& files);
+    void parse_files(
+            const vector<fs::path>& input_files,
+            const vector<uint32_t>& files,
+            const function<void(uint32_t, const term_id_frequencies&)>& on_document
+    );
+    void run_pipeline(const vector<crawled_file>& files);
+    [[nodiscard]] term_postings merge_range(
+            const vector<partial_index>& partials,
+            const vector<fs::path>& input_files,
+            term_id begin,
+            term_id end
+    ) const;
 };
 
 #endif
@@ -0,0 +1,248 @@
+#include "shard_coordinator.h"
+#include "../enums_lib/shard_message_type.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using std::runtime_error;
+
+shard_coordinator::shard_coordinator(const shard_config& config)
+        : config_(config), worker_binary_(config.worker_binary.empty() ? fs::path(SHARD_WORKER_PATH) : config.worker_binary) {
+    config_.shards = std::max<size_t>(config_.shards, 1);
+    config_.batch_size = std::max<size_t>(config_.batch_size, 1);
+
+    if (!fs::exists(worker_binary_)) {
+        throw runtime_error("Shard worker binary not found: " + worker_binary_.string());
+    }
+
+    try {
+        for (size_t i = 0; i < config_.shards; ++i) {
+            spawn(i);
+        }
+    } catch (...) {
+        stop();
+
+        throw;
+    }
+}
+
+shard_coordinator::~shard_coordinator() {
+    stop();
+}
+
+size_t shard_coordinator::index_dir(const fs::path& input_dir, thread_pool* pool) {
+    if (!fs::exists(input_dir)) {
+        throw runtime_error("Input directory does not exist");
+    }
+
+    directory_crawler crawler(pool);
+
+    return index_files(crawler.crawl(input_dir));
+}
+
+// The paths are split by shard and every shard indexes its part at the same time.
+size_t shard_coordinator::index_files(const vector<crawled_file>& files) {
+    vector<vector<string>> paths(shards_.size());
+
+    for (const auto& file : files) {
+        auto path = file.path.string();
+
+        paths[shard_of(path, shards_.size())].push_back(path);
+    }
+
+    std::lock_guard lock(shards_mutex_);
+
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        string request;
+
+        put_u8(request, SHARD_INDEX);
+        put_u32(request, static_cast<uint32_t>(paths[i].size()));
+
+        for (const auto& path : paths[i]) {
+            put_string(request, path);
+        }
+
+        if (!shard_worker::send_frame(shards_[i].fd, request)) {
+            throw runtime_error("Shard " + std::to_string(i) + " is gone");
+        }
+    }
+
+    size_t indexed = 0;
+
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        auto reply = gather(i);
+        byte_reader reader(reply);
+        uint32_t count = 0;
+
+        reader.u32(count);
+        indexed += count;
+    }
+
+    return indexed;
+}
+
+vector<scored_document> shard_coordinator::search(const string& query, uint32_t k) {
+    std::lock_guard lock(shards_mutex_);
+
+    return query_all({query}, 0, 1, k)[0];
+}
+
+// Requests carry batch_size queries, so a batch costs a few round trips per
+// shard instead of one per query.
+vector<vector<scored_document>> shard_coordinator::search_batch(const vector<string>& queries, uint32_t k) {
+    vector<vector<scored_document>> results;
+    std::lock_guard lock(shards_mutex_);
+
+    results.reserve(queries.size());
+
+    for (size_t begin = 0; begin < queries.size(); begin += config_.batch_size) {
+        auto part = query_all(queries, begin, std::min(queries.size(), begin + config_.batch_size), k);
+
+        std::move(part.begin(), part.end(), std::back_inserter(results));
+    }
+
+    return results;
+}
+
+size_t shard_coordinator::shards_num() const {
+    return shards_.size();
+}
+
+size_t shard_coordinator::shard_of(const string& path, size_t shards) {
+    return std::hash<string>{}(path) % shards;
+}
+
+// The child execs the worker binary right away, so it never runs code that a
+// lock held by another thread of the parent at fork time could block. All it
+// needs is prepared before the fork; after it only fcntl and execv run.
+void shard_coordinator::spawn(size_t index) {
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        throw runtime_error("Cannot create socket for shard " + std::to_string(index));
+    }
+
+    string binary = worker_binary_.string();
+    string fd = std::to_string(fds[1]);
+    string stop_words = config_.stop_words_file.string();
+    char* argv[] = {binary.data(), fd.data(), stop_words.data(), nullptr};
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+
+        throw runtime_error("Cannot start shard " + std::to_string(index));
+    }
+
+    if (pid == 0) {
+        // only the worker's end of the socket survives the exec
+        fcntl(fds[1], F_SETFD, 0);
+        execv(argv[0], argv);
+        _exit(127);
+    }
+
+    close(fds[1]);
+    shards_.push_back({pid, fds[0]});
+}
+
+void shard_coordinator::stop() {
+    string request;
+
+    put_u8(request, SHARD_STOP);
+
+    for (auto& s : shards_) {
+        shard_worker::send_frame(s.fd, request);
+        close(s.fd);
+        waitpid(s.pid, nullptr, 0);
+    }
+
+    shards_.clear();
+}
+
+void shard_coordinator::scatter(const string& request) {
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!shard_worker::send_frame(shards_[i].fd, request)) {
+            throw runtime_error("Shard " + std::to_string(i) + " is gone");
+        }
+    }
+}
+
+string shard_coordinator::gather(size_t index) {
+    auto reply = shard_worker::receive_frame(shards_[index].fd);
+
+    if (!reply) {
+        throw runtime_error("Shard " + std::to_string(index) + " is gone");
+    }
+
+    return *reply;
+}
+
+// Every shard gets the queries before any reply is read, so they all work at once.
+vector<vector<scored_document>> shard_coordinator::query_all(
+        const vector<string>& queries,
+        size_t begin,
+        size_t end,
+        uint32_t k
+) {
+    string request;
+
+    put_u8(request, SHARD_QUERY);
+    put_u32(request, k);
+    put_u32(request, static_cast<uint32_t>(end - begin));
+
+    for (size_t q = begin; q < end; ++q) {
+        put_string(request, queries[q]);
+    }
+
+    scatter(request);
+
+    vector<vector<scored_document>> merged(end - begin);
+
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        auto results = parse_results(gather(i), end - begin);
+
+        for (size_t q = 0; q < results.size(); ++q) {
+            std::move(results[q].begin(), results[q].end(), std::back_inserter(merged[q]));
+        }
+    }
+
+    for (auto& results : merged) {
+        size_t kept = std::min<size_t>(k, results.size());
+
+        std::partial_sort(results.begin(), results.begin() + static_cast<ptrdiff_t>(kept), results.end(),
+                          shard_worker::ranks_before);
+        results.resize(kept);
+    }
+
+    return merged;
+}
+
+vector<vector<scored_document>> shard_coordinator::parse_results(const string& reply, size_t queries_num) {
+    vector<vector<scored_document>> results(queries_num);
+    byte_reader reader(reply);
+
+    for (auto& query_results : results) {
+        uint32_t results_num = 0;
+
+        if (!reader.u32(results_num)) {
+            throw runtime_error("Truncated shard reply");
+        }
+
+        for (uint32_t r = 0; r < results_num; ++r) {
+            scored_document result;
+
+            if (!reader.str(result.name) || !reader.u32(result.score)) {
+                throw runtime_error("Truncated shard reply");
+            }
+
+            query_results.push_back(std::move(result));
+        }
+    }
+
+    return results;
+}
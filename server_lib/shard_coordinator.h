@@ -0,0 +1,75 @@
+#ifndef INVERTED_INDEX_LIB_SHARD_COORDINATOR_H
+#define INVERTED_INDEX_LIB_SHARD_COORDINATOR_H
+
+#include "shard_worker.h"
+#include "directory_crawler.h"
+#include "thread_pool.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace fs = std::filesystem;
+
+using std::mutex;
+using std::string;
+using std::vector;
+
+struct shard_config {
+    size_t shards = 4;
+    // empty falls back to the parser's default stop words
+    fs::path stop_words_file;
+    // queries per request when search_batch scatters a batch
+    size_t batch_size = 256;
+    // empty runs the shard_worker binary built along with this library
+    fs::path worker_binary;
+};
+
+// Scatter-gather search over a document-partitioned index. Every shard is a
+// shard_worker process, forked and exec'd so the caller may already run
+// threads, holding the documents whose path hashes to it. The index is no
+// longer bound by one process. Queries go to all shards,
+// each answers with its local top k and the coordinator merges those.
+// Scores are per-document term matches, which need no global statistics,
+// so the merged ranking is the same for any number of shards.
+class shard_coordinator {
+public:
+    explicit shard_coordinator(const shard_config& config = {});
+    ~shard_coordinator();
+
+    shard_coordinator(const shard_coordinator&) = delete;
+    shard_coordinator& operator=(const shard_coordinator&) = delete;
+
+    size_t index_dir(const fs::path& input_dir, thread_pool* pool);
+    size_t index_files(const vector<crawled_file>& files);
+    vector<scored_document> search(const string& query, uint32_t k = 10);
+    vector<vector<scored_document>> search_batch(const vector<string>& queries, uint32_t k = 10);
+    [[nodiscard]] size_t shards_num() const;
+
+    static size_t shard_of(const string& path, size_t shards);
+
+private:
+    struct shard {
+        pid_t pid = -1;
+        int fd = -1;
+    };
+
+    shard_config config_;
+    fs::path worker_binary_;
+    vector<shard> shards_;
+    // one exchange at a time on the shard sockets
+    mutex shards_mutex_;
+
+    void spawn(size_t index);
+    void stop();
+    void scatter(const string& request);
+    string gather(size_t index);
+    vector<vector<scored_document>> query_all(const vector<string>& queries, size_t begin, size_t end, uint32_t k);
+
+    static vector<vector<scored_document>> parse_results(const string& reply, size_t queries_num);
+};
+
+#endif
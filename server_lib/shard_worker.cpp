@@ -0,0 +1,176 @@
+#include "shard_worker.h"
+#include "binary_io.h"
+#include "../enums_lib/shard_message_type.h"
+#include <algorithm>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+
+shard_worker::shard_worker(int fd, const fs::path& stop_words_file) : fd_(fd) {
+    if (stop_words_file.empty() || !parser_.add_stop_words(stop_words_file)) {
+        parser_.add_default_stop_words();
+    }
+
+    parser_.set_dictionary(index_.dictionary());
+}
+
+void shard_worker::run() {
+    while (auto request = receive_frame(fd_)) {
+        byte_reader reader(*request);
+        uint8_t type;
+        string reply;
+
+        if (!reader.u8(type) || type == SHARD_STOP) {
+            break;
+        }
+
+        if (type == SHARD_INDEX) {
+            reply = index_documents(reader);
+        } else if (type == SHARD_QUERY) {
+            reply = answer_queries(reader);
+        }
+
+        if (!send_frame(fd_, reply)) {
+            break;
+        }
+    }
+}
+
+bool shard_worker::send_frame(int fd, const string& payload) {
+    string frame;
+
+    frame.reserve(sizeof(uint32_t) + payload.size());
+    put_u32(frame, static_cast<uint32_t>(payload.size()));
+    frame += payload;
+
+    for (string_view left = frame; !left.empty();) {
+        ssize_t sent = send(fd, left.data(), left.size(), MSG_NOSIGNAL);
+
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (sent <= 0) {
+            return false;
+        }
+
+        left.remove_prefix(sent);
+    }
+
+    return true;
+}
+
+optional<string> shard_worker::receive_frame(int fd) {
+    auto receive_all = [fd](char* data, size_t size) {
+        while (size > 0) {
+            ssize_t received = recv(fd, data, size, 0);
+
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (received <= 0) {
+                return false;
+            }
+
+            data += received;
+            size -= received;
+        }
+
+        return true;
+    };
+
+    uint32_t size;
+
+    if (!receive_all(reinterpret_cast<char*>(&size), sizeof(size))) {
+        return std::nullopt;
+    }
+
+    string payload(size, '\0');
+
+    if (!receive_all(payload.data(), size)) {
+        return std::nullopt;
+    }
+
+    return payload;
+}
+
+bool shard_worker::ranks_before(const scored_document& lhs, const scored_document& rhs) {
+    return lhs.score != rhs.score ? lhs.score > rhs.score : lhs.name < rhs.name;
+}
+
+// Request: count, paths. Reply: documents indexed.
+string shard_worker::index_documents(byte_reader& reader) {
+    uint32_t paths_num = 0;
+    uint32_t indexed = 0;
+    string reply;
+
+    reader.u32(paths_num);
+
+    for (uint32_t p = 0; p < paths_num; ++p) {
+        string path;
+
+        if (!reader.str(path)) {
+            break;
+        }
+
+        index_.add(path, parser_.parse_document_term_ids(path));
+        ++indexed;
+    }
+
+    put_u32(reply, indexed);
+
+    return reply;
+}
+
+// Request: k, count, queries. Reply: per query the result count and then
+// (document, score) pairs.
+string shard_worker::answer_queries(byte_reader& reader) {
+    uint32_t k = 0;
+    uint32_t queries_num = 0;
+    string reply;
+
+    reader.u32(k);
+    reader.u32(queries_num);
+
+    for (uint32_t q = 0; q < queries_num; ++q) {
+        string query;
+
+        reader.str(query);
+
+        auto results = top_k(query, k);
+
+        put_u32(reply, static_cast<uint32_t>(results.size()));
+
+        for (const auto& result : results) {
+            put_string(reply, result.name);
+            put_u32(reply, result.score);
+        }
+    }
+
+    return reply;
+}
+
+vector<scored_document> shard_worker::top_k(const string& query, uint32_t k) {
+    unordered_map<document, uint32_t> scores;
+    vector<scored_document> results;
+
+    for (const auto& w : parser_.parse_words(document_parser::string_to_wstring(query))) {
+        for (const auto& doc : index_.find(w)) {
+            ++scores[doc];
+        }
+    }
+
+    results.reserve(scores.size());
+
+    for (auto& [doc, score] : scores) {
+        results.push_back({doc, score});
+    }
+
+    size_t kept = std::min<size_t>(k, results.size());
+
+    std::partial_sort(results.begin(), results.begin() + static_cast<ptrdiff_t>(kept), results.end(), ranks_before);
+    results.resize(kept);
+
+    return results;
+}
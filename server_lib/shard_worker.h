@@ -0,0 +1,54 @@
+#ifndef INVERTED_INDEX_LIB_SHARD_WORKER_H
+#define INVERTED_INDEX_LIB_SHARD_WORKER_H
+
+#include "inverted_index.h"
+#include "document_parser.h"
+#include "binary_io.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using std::optional;
+using std::string;
+using std::vector;
+
+struct scored_document {
+    document name;
+    // query terms the document contains, what inverted_index::read ranks by
+    uint32_t score = 0;
+
+    bool operator==(const scored_document& other) const = default;
+};
+
+// One shard of a document-partitioned index, run in its own process by
+// shard_coordinator. It owns an inverted_index over its share of the
+// documents and answers framed requests on a Unix domain socket until it is
+// told to stop or the socket closes.
+class shard_worker {
+public:
+    shard_worker(int fd, const fs::path& stop_words_file);
+
+    void run();
+
+    // Frames are a 32-bit payload size followed by the payload.
+    static bool send_frame(int fd, const string& payload);
+    static optional<string> receive_frame(int fd);
+    // Highest score first, ties by name so every shard layout ranks alike.
+    static bool ranks_before(const scored_document& lhs, const scored_document& rhs);
+
+private:
+    int fd_;
+    inverted_index index_;
+    document_parser parser_;
+
+    string index_documents(byte_reader& reader);
+    string answer_queries(byte_reader& reader);
+    [[nodiscard]] vector<scored_document> top_k(const string& query, uint32_t k);
+};
+
+#endif
@@ -0,0 +1,17 @@
+#include "shard_worker.h"
+#include <cstdlib>
+
+// A shard process as shard_coordinator execs it: argv[1] is its end of the
+// socket to the coordinator, argv[2] the stop words file, empty for the
+// parser's defaults.
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        return 1;
+    }
+
+    shard_worker worker(std::atoi(argv[1]), argv[2]);
+
+    worker.run();
+
+    return 0;
+}
@@ -0,0 +1,291 @@
+#include "front_coded_dictionary.h"
+#include <algorithm>
+
+static void put_varint(vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static uint32_t get_varint(const uint8_t*& it) {
+    uint32_t value = 0;
+    int shift = 0;
+
+    while (*it & 0x80) {
+        value |= static_cast<uint32_t>(*it++ & 0x7F) << shift;
+        shift += 7;
+    }
+
+    value |= static_cast<uint32_t>(*it++) << shift;
+
+    return value;
+}
+
+static string to_utf8(wstring_view term) {
+    string result;
+
+    result.reserve(term.size());
+
+    for (auto wc : term) {
+        auto c = static_cast<uint32_t>(wc);
+
+        if (c < 0x80) {
+            result += static_cast<char>(c);
+        } else if (c < 0x800) {
+            result += static_cast<char>(0xC0 | (c >> 6));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            result += static_cast<char>(0xE0 | (c >> 12));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            result += static_cast<char>(0xF0 | (c >> 18));
+            result += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+
+    return result;
+}
+
+static wstring from_utf8(const string& term) {
+    wstring result;
+
+    result.reserve(term.size());
+
+    for (size_t i = 0; i < term.size();) {
+        auto c = static_cast<uint8_t>(term[i]);
+        int extra = c < 0x80 ? 0 : c < 0xE0 ? 1 : c < 0xF0 ? 2 : 3;
+        uint32_t code = extra == 0 ? c : c & (0x3F >> extra);
+
+        for (int k = 1; k <= extra && i + k < term.size(); ++k) {
+            code = code << 6 | (static_cast<uint8_t>(term[i + k]) & 0x3F);
+        }
+
+        result += static_cast<wchar_t>(code);
+        i += extra + 1;
+    }
+
+    return result;
+}
+
+front_coded_dictionary::front_coded_dictionary() = default;
+
+front_coded_dictionary::front_coded_dictionary(sorted_terms terms) {
+    vector<pair<string, term_id>> encoded;
+
+    encoded.reserve(terms.size());
+
+    for (auto& [term, id] : terms) {
+        encoded.emplace_back(to_utf8(term), id);
+    }
+
+    std::sort(encoded.begin(), encoded.end());
+    encoded.erase(std::unique(encoded.begin(), encoded.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first == rhs.first;
+    }), encoded.end());
+
+    string previous;
+
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        const auto& [term, id] = encoded[i];
+        size_t shared = 0;
+
+        if (i % block_size == 0) {
+            block_offsets_.push_back(static_cast<uint32_t>(data_.size()));
+        } else {
+            size_t limit = std::min(term.size(), previous.size());
+
+            while (shared < limit && term[shared] == previous[shared]) {
+                ++shared;
+            }
+        }
+
+        put_varint(data_, static_cast<uint32_t>(shared));
+        put_varint(data_, static_cast<uint32_t>(term.size() - shared));
+        data_.insert(data_.end(), term.begin() + static_cast<long>(shared), term.end());
+        put_varint(data_, id);
+
+        previous = term;
+    }
+
+    size_ = encoded.size();
+    data_.shrink_to_fit();
+    block_offsets_.shrink_to_fit();
+}
+
+term_id front_coded_dictionary::find(wstring_view term) const {
+    string key = to_utf8(term);
+    term_id result = term_dictionary::no_term;
+
+    scan_from(key, [&](const string& current, term_id id) {
+        if (current == key) {
+            result = id;
+        }
+
+        return false;
+    });
+
+    return result;
+}
+
+sorted_terms front_coded_dictionary::prefix(wstring_view prefix) const {
+    string key = to_utf8(prefix);
+    sorted_terms result;
+
+    scan_from(key, [&](const string& current, term_id id) {
+        if (current.compare(0, key.size(), key) != 0) {
+            return false;
+        }
+
+        result.emplace_back(from_utf8(current), id);
+
+        return true;
+    });
+
+    return result;
+}
+
+sorted_terms front_coded_dictionary::range(wstring_view from, wstring_view to) const {
+    string end = to_utf8(to);
+    sorted_terms result;
+
+    scan_from(to_utf8(from), [&](const string& current, term_id id) {
+        if (current >= end) {
+            return false;
+        }
+
+        result.emplace_back(from_utf8(current), id);
+
+        return true;
+    });
+
+    return result;
+}
+
+sorted_terms front_coded_dictionary::wildcard(wstring_view pattern) const {
+    auto literal_end = pattern.find_first_of(L"*?");
+
+    if (literal_end == wstring_view::npos) {
+        term_id id = find(pattern);
+
+        return id == term_dictionary::no_term ? sorted_terms{} : sorted_terms{{wstring(pattern), id}};
+    }
+
+    string key = to_utf8(pattern.substr(0, literal_end));
+    sorted_terms result;
+
+    scan_from(key, [&](const string& current, term_id id) {
+        if (current.compare(0, key.size(), key) != 0) {
+            return false;
+        }
+
+        wstring term = from_utf8(current);
+
+        if (matches_wildcard(term, pattern)) {
+            result.emplace_back(std::move(term), id);
+        }
+
+        return true;
+    });
+
+    return result;
+}
+
+size_t front_coded_dictionary::size() const {
+    return size_;
+}
+
+size_t front_coded_dictionary::memory_usage() const {
+    return data_.capacity() + block_offsets_.capacity() * sizeof(uint32_t);
+}
+
+bool front_coded_dictionary::matches_wildcard(wstring_view term, wstring_view pattern) {
+    size_t t = 0;
+    size_t p = 0;
+    size_t star = wstring_view::npos;
+    size_t star_t = 0;
+
+    while (t < term.size()) {
+        if (p < pattern.size() && (pattern[p] == L'?' || pattern[p] == term[t])) {
+            ++t;
+            ++p;
+        } else if (p < pattern.size() && pattern[p] == L'*') {
+            star = p++;
+            star_t = t;
+        } else if (star != wstring_view::npos) {
+            p = star + 1;
+            t = ++star_t;
+        } else {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == L'*') {
+        ++p;
+    }
+
+    return p == pattern.size();
+}
+
+void front_coded_dictionary::scan_from(const string& from, const function<bool(const string&, term_id)>& on_term) const {
+    if (size_ == 0) {
+        return;
+    }
+
+    size_t block = find_block(from);
+    size_t index = block * block_size;
+    const uint8_t* it = data_.data() + block_offsets_[block];
+    string current;
+
+    for (; index < size_; ++index) {
+        uint32_t shared = get_varint(it);
+        uint32_t suffix = get_varint(it);
+
+        current.resize(shared);
+        current.append(reinterpret_cast<const char*>(it), suffix);
+        it += suffix;
+
+        term_id id = get_varint(it);
+
+        if (current < from) {
+            continue;
+        }
+
+        if (!on_term(current, id)) {
+            return;
+        }
+    }
+}
+
+size_t front_coded_dictionary::find_block(const string& term) const {
+    size_t low = 0;
+    size_t high = block_offsets_.size();
+
+    // last block whose head is <= term
+    while (high - low > 1) {
+        size_t middle = (low + high) / 2;
+
+        if (block_head(middle) <= term) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+string front_coded_dictionary::block_head(size_t block) const {
+    const uint8_t* it = data_.data() + block_offsets_[block];
+
+    get_varint(it);
+
+    uint32_t length = get_varint(it);
+
+    return {reinterpret_cast<const char*>(it), length};
+}
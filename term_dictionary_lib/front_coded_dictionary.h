@@ -0,0 +1,58 @@
+#ifndef INVERTED_INDEX_LIB_FRONT_CODED_DICTIONARY_H
+#define INVERTED_INDEX_LIB_FRONT_CODED_DICTIONARY_H
+
+#include "term_dictionary.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using std::function;
+using std::pair;
+using std::string;
+using std::vector;
+using std::wstring;
+using std::wstring_view;
+
+using sorted_term = pair<wstring, term_id>;
+using sorted_terms = vector<sorted_term>;
+
+// Immutable sorted index over terms of a term_dictionary, for the lookups a
+// hash table cannot answer. It is built next to the dictionary, not instead
+// of it, so it adds memory_usage() bytes on top. Terms are stored as UTF-8 in
+// blocks of block_size: the first term of a block is stored in full and
+// every other term only as the length of the prefix it shares with its
+// predecessor plus the remaining suffix, which keeps that extra cost small.
+// Exact lookups binary search the block heads and scan one block; prefix,
+// range and wildcard lookups walk the terms in order.
+class front_coded_dictionary {
+public:
+    static constexpr size_t block_size = 16;
+
+    front_coded_dictionary();
+    explicit front_coded_dictionary(sorted_terms terms);
+
+    [[nodiscard]] term_id find(wstring_view term) const;
+    [[nodiscard]] sorted_terms prefix(wstring_view prefix) const;
+    [[nodiscard]] sorted_terms range(wstring_view from, wstring_view to) const;
+    [[nodiscard]] sorted_terms wildcard(wstring_view pattern) const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t memory_usage() const;
+
+    static bool matches_wildcard(wstring_view term, wstring_view pattern);
+
+private:
+    vector<uint8_t> data_;
+    vector<uint32_t> block_offsets_;
+    size_t size_ = 0;
+
+    // Calls on_term for every term >= from in order until it returns false.
+    void scan_from(const string& from, const function<bool(const string&, term_id)>& on_term) const;
+    [[nodiscard]] size_t find_block(const string& term) const;
+    [[nodiscard]] string block_head(size_t block) const;
+};
+
+#endif
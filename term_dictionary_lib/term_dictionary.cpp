@@ -0,0 +1,111 @@
+#include "term_dictionary.h"
+#include <functional>
+#include <stdexcept>
+
+using std::shared_lock;
+using std::unique_lock;
+using std::out_of_range;
+
+term_dictionary::term_dictionary() = default;
+
+term_dictionary::~term_dictionary() = default;
+
+term_id term_dictionary::intern(wstring_view term) {
+    bool inserted;
+
+    return intern(term, inserted);
+}
+
+term_id term_dictionary::intern(wstring_view term, bool& inserted) {
+    auto& s = shards_[shard_of(term)];
+
+    inserted = false;
+
+    {
+        shared_lock read_lock(s.mutex);
+        auto it = s.ids.find(term);
+
+        if (it != s.ids.end()) {
+            return it->second;
+        }
+    }
+
+    unique_lock write_lock(s.mutex);
+    auto it = s.ids.find(term);
+
+    if (it != s.ids.end()) {
+        return it->second;
+    }
+
+    inserted = true;
+
+    term_id id;
+    wstring_view stored;
+
+    {
+        unique_lock terms_lock(terms_mutex_);
+
+        id = static_cast<term_id>(terms_.size());
+        stored = terms_.emplace_back(term);
+    }
+
+    s.ids.emplace(stored, id);
+
+    return id;
+}
+
+term_id term_dictionary::find(wstring_view term) const {
+    const auto& s = shards_[shard_of(term)];
+    shared_lock read_lock(s.mutex);
+    auto it = s.ids.find(term);
+
+    return it != s.ids.end() ? it->second : no_term;
+}
+
+const wstring& term_dictionary::term(term_id id) const {
+    shared_lock read_lock(terms_mutex_);
+
+    if (id >= terms_.size()) {
+        throw out_of_range("Unknown term id " + std::to_string(id));
+    }
+
+    return terms_[id];
+}
+
+size_t term_dictionary::size() const {
+    shared_lock read_lock(terms_mutex_);
+
+    return terms_.size();
+}
+
+size_t term_dictionary::memory_usage() const {
+    // next pointer, the stored pair and the cached hash
+    constexpr size_t node_bytes = sizeof(void*) + sizeof(pair<const wstring_view, term_id>) + sizeof(size_t);
+    size_t bytes = 0;
+
+    for (const auto& s : shards_) {
+        shared_lock read_lock(s.mutex);
+
+        bytes += s.ids.bucket_count() * sizeof(void*) + s.ids.size() * node_bytes;
+    }
+
+    shared_lock read_lock(terms_mutex_);
+
+    for (const auto& stored : terms_) {
+        auto data = reinterpret_cast<const char*>(stored.data());
+        auto self = reinterpret_cast<const char*>(&stored);
+
+        bytes += sizeof(wstring);
+
+        // short terms live inside the string object itself
+        if (data < self || data >= self + sizeof(wstring)) {
+            bytes += (stored.capacity() + 1) * sizeof(wchar_t);
+        }
+    }
+
+    return bytes;
+}
+
+size_t term_dictionary::shard_of(wstring_view term) {
+    return std::hash<wstring_view>{}(term) % shards_num;
+}
@@ -0,0 +1,65 @@
+#ifndef INVERTED_INDEX_LIB_TERM_DICTIONARY_H
+#define INVERTED_INDEX_LIB_TERM_DICTIONARY_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using std::array;
+using std::deque;
+using std::pair;
+using std::shared_mutex;
+using std::unordered_map;
+using std::vector;
+using std::wstring;
+using std::wstring_view;
+
+using term_id = uint32_t;
+using term_ids = vector<term_id>;
+using term_id_frequency = pair<term_id, uint32_t>;
+using term_id_frequencies = vector<term_id_frequency>;
+
+// Concurrent string interning table shared by document_parser and
+// inverted_index. Every distinct term is stored exactly once and is
+// identified by a dense 32-bit id from then on.
+class term_dictionary {
+public:
+    static constexpr term_id no_term = std::numeric_limits<term_id>::max();
+
+    term_dictionary();
+    ~term_dictionary();
+
+    term_id intern(wstring_view term);
+    term_id intern(wstring_view term, bool& inserted);
+    [[nodiscard]] term_id find(wstring_view term) const;
+    [[nodiscard]] const wstring& term(term_id id) const;
+    [[nodiscard]] size_t size() const;
+    // Estimated heap footprint: the stored terms and the hash tables' nodes
+    // and buckets.
+    [[nodiscard]] size_t memory_usage() const;
+
+private:
+    static constexpr size_t shards_num = 64;
+
+    struct shard {
+        unordered_map<wstring_view, term_id> ids;
+        mutable shared_mutex mutex;
+    };
+
+    array<shard, shards_num> shards_;
+
+    deque<wstring> terms_;
+    mutable shared_mutex terms_mutex_;
+
+    static size_t shard_of(wstring_view term);
+};
+
+#endif
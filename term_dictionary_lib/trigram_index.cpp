@@ -0,0 +1,187 @@
+#include "trigram_index.h"
+#include <algorithm>
+#include <mutex>
+#include <string>
+
+using std::shared_lock;
+using std::unique_lock;
+using std::wstring;
+
+static constexpr uint32_t no_length = UINT32_MAX;
+
+trigram_index::trigram_index(const term_dictionary* dictionary) : dictionary_(dictionary) {}
+
+void trigram_index::add(term_id id, wstring_view term) {
+    auto grams = trigrams_of(term);
+    unique_lock write_lock(mutex_);
+
+    if (id >= lengths_.size()) {
+        lengths_.resize(std::max<size_t>(id + 1, lengths_.size() * 2), no_length);
+    }
+
+    if (lengths_[id] != no_length) {
+        return;
+    }
+
+    lengths_[id] = static_cast<uint32_t>(term.size());
+    ++size_;
+
+    for (auto gram : grams) {
+        auto& ids = postings_[gram];
+
+        ids.insert(std::upper_bound(ids.begin(), ids.end(), id), id);
+    }
+}
+
+term_id trigram_index::best_match(wstring_view term, uint32_t max_distance) const {
+    auto found = find_matches(term, max_distance);
+
+    return found.empty() ? term_dictionary::no_term : found.front().id;
+}
+
+vector<term_id> trigram_index::matches(wstring_view term, uint32_t max_distance) const {
+    vector<term_id> result;
+
+    for (const auto& m : find_matches(term, max_distance)) {
+        result.push_back(m.id);
+    }
+
+    return result;
+}
+
+size_t trigram_index::size() const {
+    shared_lock read_lock(mutex_);
+
+    return size_;
+}
+
+vector<trigram_index::match> trigram_index::find_matches(wstring_view term, uint32_t max_distance) const {
+    auto grams = trigrams_of(term);
+    auto query_length = static_cast<uint32_t>(term.size());
+    uint32_t min_shared = grams.size() > 3 * max_distance ? grams.size() - 3 * max_distance : 1;
+
+    vector<const vector<term_id>*> lists;
+
+    shared_lock read_lock(mutex_);
+
+    for (auto gram : grams) {
+        auto it = postings_.find(gram);
+
+        if (it != postings_.end()) {
+            lists.push_back(&it->second);
+        }
+    }
+
+    if (lists.size() < min_shared) {
+        return {};
+    }
+
+    // A term sharing at least min_shared trigrams with the query must occur in
+    // one of the (lists - min_shared + 1) shortest lists, so only those are
+    // scanned and the long lists are probed per candidate.
+    std::sort(lists.begin(), lists.end(), [](const auto* lhs, const auto* rhs) {
+        return lhs->size() < rhs->size();
+    });
+
+    size_t scanned = lists.size() - min_shared + 1;
+    unordered_map<term_id, uint32_t> shared;
+
+    for (size_t i = 0; i < scanned; ++i) {
+        for (auto id : *lists[i]) {
+            uint32_t length = lengths_[id];
+            uint32_t length_diff = length > query_length ? length - query_length : query_length - length;
+
+            if (length_diff <= max_distance) {
+                ++shared[id];
+            }
+        }
+    }
+
+    vector<match> result;
+
+    for (auto [id, count] : shared) {
+        for (size_t i = scanned; i < lists.size() && count < min_shared; ++i) {
+            if (std::binary_search(lists[i]->begin(), lists[i]->end(), id)) {
+                ++count;
+            }
+        }
+
+        if (count < min_shared) {
+            continue;
+        }
+
+        uint32_t distance = edit_distance(term, dictionary_->term(id), max_distance);
+
+        if (distance <= max_distance) {
+            result.push_back({id, distance, count});
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const match& lhs, const match& rhs) {
+        if (lhs.distance != rhs.distance) {
+            return lhs.distance < rhs.distance;
+        }
+
+        if (lhs.shared != rhs.shared) {
+            return lhs.shared > rhs.shared;
+        }
+
+        return lhs.id < rhs.id;
+    });
+
+    return result;
+}
+
+uint32_t trigram_index::edit_distance(wstring_view lhs, wstring_view rhs, uint32_t max_distance) {
+    size_t length_diff = lhs.size() > rhs.size() ? lhs.size() - rhs.size() : rhs.size() - lhs.size();
+
+    if (length_diff > max_distance) {
+        return max_distance + 1;
+    }
+
+    vector<uint32_t> previous(rhs.size() + 1);
+    vector<uint32_t> current(rhs.size() + 1);
+
+    for (size_t j = 0; j <= rhs.size(); ++j) {
+        previous[j] = static_cast<uint32_t>(j);
+    }
+
+    for (size_t i = 1; i <= lhs.size(); ++i) {
+        current[0] = static_cast<uint32_t>(i);
+
+        uint32_t row_min = current[0];
+
+        for (size_t j = 1; j <= rhs.size(); ++j) {
+            uint32_t substitution = previous[j - 1] + (lhs[i - 1] == rhs[j - 1] ? 0 : 1);
+
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, substitution});
+            row_min = std::min(row_min, current[j]);
+        }
+
+        if (row_min > max_distance) {
+            return max_distance + 1;
+        }
+
+        std::swap(previous, current);
+    }
+
+    return std::min(previous[rhs.size()], max_distance + 1);
+}
+
+vector<trigram_index::trigram> trigram_index::trigrams_of(wstring_view term) {
+    wstring padded = L"$" + wstring(term) + L"$";
+    vector<trigram> result;
+
+    for (size_t i = 0; i + 3 <= padded.size(); ++i) {
+        auto gram = static_cast<trigram>(static_cast<uint32_t>(padded[i])) << 42 |
+                    static_cast<trigram>(static_cast<uint32_t>(padded[i + 1])) << 21 |
+                    static_cast<trigram>(static_cast<uint32_t>(padded[i + 2]));
+
+        result.push_back(gram);
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
@@ -0,0 +1,52 @@
+#ifndef INVERTED_INDEX_LIB_TRIGRAM_INDEX_H
+#define INVERTED_INDEX_LIB_TRIGRAM_INDEX_H
+
+#include "term_dictionary.h"
+
+#include <cstdint>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using std::shared_mutex;
+using std::unordered_map;
+using std::vector;
+using std::wstring_view;
+
+// Character trigram index over the terms of a term_dictionary, used to find
+// dictionary terms within a small edit distance of a misspelled query term.
+// Terms are padded with '$' on both sides, so a term of length n has n
+// trigrams and one edit changes at most three of them.
+class trigram_index {
+public:
+    explicit trigram_index(const term_dictionary* dictionary);
+
+    void add(term_id id, wstring_view term);
+    [[nodiscard]] term_id best_match(wstring_view term, uint32_t max_distance) const;
+    [[nodiscard]] vector<term_id> matches(wstring_view term, uint32_t max_distance) const;
+    [[nodiscard]] size_t size() const;
+
+    static uint32_t edit_distance(wstring_view lhs, wstring_view rhs, uint32_t max_distance);
+
+private:
+    using trigram = uint64_t;
+
+    struct match {
+        term_id id;
+        uint32_t distance;
+        uint32_t shared;
+    };
+
+    const term_dictionary* dictionary_;
+
+    unordered_map<trigram, vector<term_id>> postings_;
+    vector<uint32_t> lengths_;
+    size_t size_ = 0;
+    mutable shared_mutex mutex_;
+
+    vector<match> find_matches(wstring_view term, uint32_t max_distance) const;
+    static vector<trigram> trigrams_of(wstring_view term);
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef INVERTED_INDEX_LIB_BOUNDED_QUEUE_H
+#define INVERTED_INDEX_LIB_BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+
+using std::atomic;
+using std::unique_ptr;
+
+// Bounded multi-producer multi-consumer queue (Vyukov's ring): every cell
+// carries a sequence number telling producers and consumers whose turn it
+// is, so push and pop are one CAS on a position counter and never take a
+// lock. push() and pop() wait with spin/yield/sleep backoff while the queue
+// is full or empty, which gives producers backpressure. After close(),
+// push() fails and pop() drains what is left before failing.
+template<typename T>
+class bounded_queue {
+public:
+    explicit bounded_queue(size_t capacity) {
+        size_t size = 2;
+
+        while (size < capacity) {
+            size *= 2;
+        }
+
+        cells_ = std::make_unique<cell[]>(size);
+        mask_ = size - 1;
+
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool try_push(T&& value) {
+        size_t position = enqueue_position_.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell& c = cells_[position & mask_];
+            size_t sequence = c.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+            if (diff == 0) {
+                if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    c.value = std::move(value);
+                    c.sequence.store(position + 1, std::memory_order_release);
+
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = enqueue_position_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& value) {
+        size_t position = dequeue_position_.load(std::memory_order_relaxed);
+
+        for (;;) {
+            cell& c = cells_[position & mask_];
+            size_t sequence = c.sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+
+            if (diff == 0) {
+                if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(c.value);
+                    c.sequence.store(position + mask_ + 1, std::memory_order_release);
+
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = dequeue_position_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool push(T value) {
+        for (unsigned attempt = 0; !closed_.load(std::memory_order_acquire); ++attempt) {
+            if (try_push(std::move(value))) {
+                return true;
+            }
+
+            backoff(attempt);
+        }
+
+        return false;
+    }
+
+    bool pop(T& value) {
+        for (unsigned attempt = 0;; ++attempt) {
+            if (try_pop(value)) {
+                return true;
+            }
+
+            if (closed_.load(std::memory_order_acquire)) {
+                return try_pop(value);
+            }
+
+            backoff(attempt);
+        }
+    }
+
+    void close() {
+        closed_.store(true, std::memory_order_release);
+    }
+
+    [[nodiscard]] bool is_closed() const {
+        return closed_.load(std::memory_order_acquire);
+    }
+
+    // Approximate while producers or consumers are running.
+    [[nodiscard]] size_t size() const {
+        size_t enqueued = enqueue_position_.load(std::memory_order_relaxed);
+        size_t dequeued = dequeue_position_.load(std::memory_order_relaxed);
+
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    [[nodiscard]] size_t capacity() const {
+        return mask_ + 1;
+    }
+
+private:
+    static constexpr size_t cache_line = 64;
+
+    struct cell {
+        atomic<size_t> sequence;
+        T value;
+    };
+
+    unique_ptr<cell[]> cells_;
+    size_t mask_ = 0;
+
+    alignas(cache_line) atomic<size_t> enqueue_position_ = 0;
+    alignas(cache_line) atomic<size_t> dequeue_position_ = 0;
+    alignas(cache_line) atomic<bool> closed_ = false;
+
+    static void backoff(unsigned attempt) {
+        if (attempt < 64) {
+            return;
+        }
+
+        if (attempt < 128) {
+            std::this_thread::yield();
+
+            return;
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+};
+
+#endif
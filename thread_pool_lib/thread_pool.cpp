@@ -36,7 +36,12 @@ void thread_pool::run() {
 
         write_lock_m lock(completed_tasks_mutex_);
 
-        completed_tasks_.insert(task.first);
+        if (task.first) {
+            completed_tasks_.insert(*task.first);
+        } else {
+            --detached_tasks_num_;
+        }
+
         completed_tasks_cv_.notify_all();
     }
 }
@@ -47,11 +52,15 @@ bool thread_pool::is_task_finished(task_id_t task_id) {
     return completed_tasks_.find(task_id) != completed_tasks_.end();
 }
 
+unsigned int thread_pool::size() const {
+    return threads_.size();
+}
+
 void thread_pool::wait_all() {
     write_lock_m lock(completed_tasks_mutex_);
 
     completed_tasks_cv_.wait(lock, [this]() {
-        return completed_tasks_.size() == tasks_num_ || is_shutdown_;
+        return (completed_tasks_.size() == tasks_num_ && detached_tasks_num_ == 0) || is_shutdown_;
     });
 }
 
@@ -16,6 +16,7 @@
 #include <shared_mutex>
 #include <condition_variable>
 #include <memory>
+#include <optional>
 
 using std::pair;
 using std::queue;
@@ -25,6 +26,7 @@ using std::vector;
 
 using std::function;
 using std::any;
+using std::optional;
 
 using std::thread;
 using std::future;
@@ -51,7 +53,8 @@ using write_lock_m = unique_lock<mutex>;
 
 using task_id_t = unsigned int;
 using task_func_t = packaged_task<any()>;
-using task_t = pair<task_id_t, task_func_t>;
+// detached tasks carry no id, nothing is kept for them once they run
+using task_t = pair<optional<task_id_t>, task_func_t>;
 using task_queue = queue<task_t>;
 using completed_tasks = unordered_set<task_id_t>;
 using threads = vector<thread>;
@@ -102,7 +105,43 @@ public:
         return task_id;
     }
 
+    // Runs a task nobody waits for by id: no future and no completion record
+    // is kept, so a long-lived caller submitting without end keeps the pool's
+    // bookkeeping flat. wait_all still waits for it.
+    template<typename F, typename ...Args>
+    void add_detached_task(F&& f, Args&&... args) {
+        if (is_shutdown_) {
+            throw runtime_error("thread pool is shutdown");
+        }
+
+        if (is_adding_task_blocked_) {
+            throw runtime_error("adding tasks is blocked");
+        }
+
+        auto task_func = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+        auto task_wrapper = [task_func]() mutable -> any {
+            task_func();
+
+            return {};
+        };
+
+        {
+            write_lock_m lock(completed_tasks_mutex_);
+
+            ++detached_tasks_num_;
+        }
+
+        {
+            write_lock_m lock(tasks_mutex_);
+
+            tasks_.emplace(std::nullopt, task_func_t(std::move(task_wrapper)));
+        }
+
+        tasks_cv_.notify_one();
+    }
+
     bool is_task_finished(task_id_t task_id);
+    [[nodiscard]] unsigned int size() const;
 
     void wait_all();
     void wait(task_id_t task_id);
@@ -127,6 +166,8 @@ private:
     atomic_bool is_shutdown_ = false;
     atomic_bool is_adding_task_blocked_ = false;
     unsigned int tasks_num_ = 0;
+    // detached tasks queued or running, guarded by completed_tasks_mutex_
+    size_t detached_tasks_num_ = 0;
 
     void run();
 };